@@ -0,0 +1,83 @@
+#pragma once
+// Bodies shared by the benchmarks.
+#include "Entity.h"
+#include "StateBuffer.h"
+#include <cstdint>
+
+enum BenchLayers : uint32_t {
+  BENCH_LAYER_STATIC = 1u << 0,
+  BENCH_LAYER_FALLING = 1u << 1,
+};
+
+// Platform-like: never moves, only collides.
+class BenchStatic : public Entity {
+private:
+  inline static bool layered = true;
+
+public:
+  BenchStatic(float x = 0, float y = 0, float w = 128, float h = 24)
+      : Entity(x, y, w, h) {
+    isStatic = true;
+    hasPhysics = false;
+    affectedByGravity = false;
+    force = {.x = 0.0f, .y = 0.0f};
+    if (layered) {
+      collisionLayer = BENCH_LAYER_STATIC;
+      collisionMask = BENCH_LAYER_FALLING;
+    }
+  }
+
+  static void SetLayered(bool enabled) { layered = enabled; }
+};
+
+// Collectible-like: falls, rests on what it lands on, and respawns above
+// the world after a while (or when it drops out), so the scene never
+// settles. SetTimedRespawn(false) only respawns bodies that drop out.
+class BenchFalling : public Entity {
+private:
+  inline static bool timedRespawn = true;
+  float worldWidth, worldHeight;
+  uint32_t rng;
+  int ticksLeft;
+
+  uint32_t Next() {
+    rng = rng * 1664525u + 1013904223u;
+    return rng >> 8;
+  }
+
+public:
+  BenchFalling(float x = 0, float y = 0, float worldW = 1, float worldH = 1,
+               uint32_t seed = 0)
+      : Entity(x, y, 24, 24), worldWidth(worldW), worldHeight(worldH),
+        rng(seed), ticksLeft(0) {
+    ticksLeft = 120 + (int)(Next() % 480);
+  }
+
+  static void SetTimedRespawn(bool enabled) { timedRespawn = enabled; }
+
+  void Update(float, InputManager *) override {
+    if ((timedRespawn && --ticksLeft <= 0) || position.y > worldHeight) {
+      Teleport({.x = (float)(Next() % (uint32_t)worldWidth), .y = -32.0f});
+      velocity = {.x = 0.0f, .y = 0.0f};
+      ticksLeft = 120 + (int)(Next() % 480);
+    }
+  }
+
+  void OnCollision(Entity *, CollisionData *data) override {
+    if (data->normal.y < 0.0f && velocity.y > 0.0f)
+      velocity.y = 0.0f;
+  }
+
+  void SaveState(StateWriter &out) const override {
+    out.Write(worldWidth);
+    out.Write(worldHeight);
+    out.Write(rng);
+    out.Write(ticksLeft);
+  }
+  void LoadState(StateReader &in) override {
+    in.Read(worldWidth);
+    in.Read(worldHeight);
+    in.Read(rng);
+    in.Read(ticksLeft);
+  }
+};
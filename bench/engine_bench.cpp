@@ -0,0 +1,755 @@
+// Headless macro-benchmark. Builds a scene of static platforms and falling
+// bodies, runs the engine for a fixed number of ticks on SDL's offscreen
+// video driver, and prints one JSON object to stdout.
+//
+//   engine_bench [--statics N] [--dynamics N] [--ticks N] [--warmup N]
+//                [--threads N] [--seed N] [--no-render] [--world]
+//                [--contact-list] [--brute-force] [--churn N]
+//                [--no-layers] [--settle] [--no-sleep] [--rollback N]
+//                [--run serial|double|triple] [--no-static-cache]
+//                [--static-textures N] [--tiles WxH] [--stream N]
+//                [--stream-budget MB] [--scene N]
+//
+// --churn N despawns N falling bodies and spawns N new ones every tick, to
+// measure entity turnover (pooled, so allocation-free once warm). When
+// rendering with the grid broadphase, a frame whose view query can't use
+// the grid or culls nothing counts as "unculled_churn_frames" and makes the
+// bench exit with status 1.
+// Platforms are put on a layer that ignores other platforms unless
+// --no-layers is given, which tests every overlapping pair. --settle stops
+// the timed respawns so the scene comes to rest; --no-sleep keeps resting
+// bodies awake.
+//
+// --rollback N snapshots every tick into a StateRing, then restores the
+// state from N ticks back and re-simulates up to the present, checking each
+// re-simulated tick's hash against the one saved the first time. Any
+// mismatch counts as a desync.
+//
+// --run drives GameEngine::Run in real time for --ticks frames, capped at
+// cfg::TARGET_FPS like vsync would, instead of calling Step and Render back
+// to back. It reports how many ticks were simulated, dropped and never
+// drawn with the given FramePipeline.
+//
+// --no-static-cache submits every platform each frame instead of
+// compositing the cached static layer chunks. --static-textures N gives the
+// platforms N different textures, like a level's many background tiles.
+//
+// --tiles WxH adds a tilemap of W by H 32-unit tiles: hilly solid ground
+// about three quarters of the way down the bench area, filled to the bottom
+// of the map, and scattered one-way ledges above it. The falling bodies
+// land on it like on the platforms.
+//
+// --stream N writes a strip of 64 by 4 regions of N platforms each (plus a
+// row of ground tiles when there's a tilemap) and pans the camera along it
+// at 4096 units a second, so LevelStreamer loads regions ahead and unloads
+// those behind once over --stream-budget (default cfg::STREAM_MEMORY_BUDGET).
+//
+// --scene N writes N untextured platforms as level text, compiles it into
+// engine_bench.scene, and times creating them from the binary scene, which
+// stays for the run, and from the text (then removes them).
+//
+// Allocation counts cover C++ operator new only (not SDL's malloc).
+#include "BenchEntities.h"
+#include "Config.h"
+#include "GameEngine.h"
+#include "Profiler.h"
+#include "StateRing.h"
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <malloc.h>
+#include <psapi.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "psapi.lib")
+#endif
+#else
+#include <sys/resource.h>
+#endif
+
+static std::atomic<uint64_t> allocCount{0};
+static std::atomic<uint64_t> allocBytes{0};
+
+// The whole replaceable family, so every new is counted and every delete
+// matches the allocator its new used. Frees stay out of line: where GCC
+// inlines a delete but not its new, it would pair free() with operator new
+// and warn (-Wmismatched-new-delete).
+#if defined(__GNUC__) || defined(__clang__)
+#define BENCH_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define BENCH_NOINLINE __declspec(noinline)
+#else
+#define BENCH_NOINLINE
+#endif
+
+static void *CountedAlloc(size_t size) noexcept {
+  allocCount.fetch_add(1, std::memory_order_relaxed);
+  allocBytes.fetch_add(size, std::memory_order_relaxed);
+  return std::malloc(size ? size : 1);
+}
+static void *CountedAlignedAlloc(size_t size, std::align_val_t align) noexcept {
+  allocCount.fetch_add(1, std::memory_order_relaxed);
+  allocBytes.fetch_add(size, std::memory_order_relaxed);
+  const size_t a = (size_t)align;
+  const size_t rounded = (std::max<size_t>(size, 1) + a - 1) / a * a;
+#ifdef _WIN32
+  return _aligned_malloc(rounded, a);
+#else
+  return std::aligned_alloc(a, rounded);
+#endif
+}
+BENCH_NOINLINE static void PlainFree(void *p) noexcept { std::free(p); }
+BENCH_NOINLINE static void AlignedFree(void *p) noexcept {
+#ifdef _WIN32
+  _aligned_free(p);
+#else
+  std::free(p);
+#endif
+}
+
+void *operator new(size_t size) {
+  if (void *p = CountedAlloc(size))
+    return p;
+  throw std::bad_alloc();
+}
+void *operator new[](size_t size) {
+  if (void *p = CountedAlloc(size))
+    return p;
+  throw std::bad_alloc();
+}
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  return CountedAlloc(size);
+}
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return CountedAlloc(size);
+}
+void *operator new(size_t size, std::align_val_t align) {
+  if (void *p = CountedAlignedAlloc(size, align))
+    return p;
+  throw std::bad_alloc();
+}
+void *operator new[](size_t size, std::align_val_t align) {
+  if (void *p = CountedAlignedAlloc(size, align))
+    return p;
+  throw std::bad_alloc();
+}
+void *operator new(size_t size, std::align_val_t align,
+                   const std::nothrow_t &) noexcept {
+  return CountedAlignedAlloc(size, align);
+}
+void *operator new[](size_t size, std::align_val_t align,
+                     const std::nothrow_t &) noexcept {
+  return CountedAlignedAlloc(size, align);
+}
+
+void operator delete(void *p) noexcept { PlainFree(p); }
+void operator delete[](void *p) noexcept { PlainFree(p); }
+void operator delete(void *p, size_t) noexcept { PlainFree(p); }
+void operator delete[](void *p, size_t) noexcept { PlainFree(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+  PlainFree(p);
+}
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+  PlainFree(p);
+}
+void operator delete(void *p, std::align_val_t) noexcept { AlignedFree(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { AlignedFree(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept {
+  AlignedFree(p);
+}
+void operator delete[](void *p, size_t, std::align_val_t) noexcept {
+  AlignedFree(p);
+}
+void operator delete(void *p, std::align_val_t,
+                     const std::nothrow_t &) noexcept {
+  AlignedFree(p);
+}
+void operator delete[](void *p, std::align_val_t,
+                       const std::nothrow_t &) noexcept {
+  AlignedFree(p);
+}
+
+struct Options {
+  size_t statics = 1000;
+  size_t dynamics = 10000;
+  int ticks = 600;
+  int warmup = 60;
+  int threads = -1; // -1 = engine default
+  unsigned seed = 1;
+  bool render = true;
+  bool world = false;
+  bool contactList = false;
+  bool bruteForce = false;
+  size_t churn = 0; // falling bodies replaced per tick
+  bool layers = true;
+  bool settle = false;
+  bool sleep = true;
+  int rollback = 0; // ticks re-simulated after every tick; 0 = off
+  bool run = false;  // real-time GameEngine::Run instead of the tick loop
+  FramePipeline pipeline = FramePipeline::SERIAL;
+  bool staticCache = true;
+  int staticTextures = 1; // platforms spread over this many textures
+  uint32_t tilesX = 0, tilesY = 0; // tilemap size; 0 = none
+  size_t streamEntities = 0;       // per region; 0 = no streaming
+  size_t streamBudget = cfg::STREAM_MEMORY_BUDGET;
+  size_t sceneEntities = 0; // 0 = no scene
+};
+
+struct Summary {
+  double mean = 0.0, p50 = 0.0, p99 = 0.0, max = 0.0;
+};
+
+static Summary Summarize(std::vector<double> v) {
+  Summary s;
+  if (v.empty())
+    return s;
+  std::sort(v.begin(), v.end());
+  double sum = 0.0;
+  for (double x : v)
+    sum += x;
+  s.mean = sum / (double)v.size();
+  s.p50 = v[v.size() / 2];
+  s.p99 = v[std::min(v.size() - 1, v.size() * 99 / 100)];
+  s.max = v.back();
+  return s;
+}
+
+static void PrintSummary(const char *key, const Summary &s, bool comma) {
+  printf("    \"%s\": {\"mean\": %.4f, \"p50\": %.4f, \"p99\": %.4f, "
+         "\"max\": %.4f}%s\n",
+         key, s.mean, s.p50, s.p99, s.max, comma ? "," : "");
+}
+
+static uint64_t PeakRssKB() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS pmc;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+    return (uint64_t)pmc.PeakWorkingSetSize / 1024;
+  return 0;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+#ifdef __APPLE__
+  return (uint64_t)usage.ru_maxrss / 1024; // bytes on macOS
+#else
+  return (uint64_t)usage.ru_maxrss; // kilobytes on Linux
+#endif
+#endif
+}
+
+static bool ParseOptions(int argc, char *argv[], Options &o) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "--statics" && hasValue) {
+      o.statics = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--dynamics" && hasValue) {
+      o.dynamics = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--ticks" && hasValue) {
+      o.ticks = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--warmup" && hasValue) {
+      o.warmup = std::max(0, std::atoi(argv[++i]));
+    } else if (arg == "--threads" && hasValue) {
+      o.threads = std::max(0, std::atoi(argv[++i]));
+    } else if (arg == "--seed" && hasValue) {
+      o.seed = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--no-render") {
+      o.render = false;
+    } else if (arg == "--world") {
+      o.world = true;
+    } else if (arg == "--contact-list") {
+      o.contactList = true;
+    } else if (arg == "--brute-force") {
+      o.bruteForce = true;
+    } else if (arg == "--settle") {
+      o.settle = true;
+    } else if (arg == "--no-sleep") {
+      o.sleep = false;
+    } else if (arg == "--no-layers") {
+      o.layers = false;
+    } else if (arg == "--churn" && hasValue) {
+      o.churn = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--rollback" && hasValue) {
+      o.rollback = std::max(0, std::atoi(argv[++i]));
+    } else if (arg == "--no-static-cache") {
+      o.staticCache = false;
+    } else if (arg == "--static-textures" && hasValue) {
+      o.staticTextures = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--tiles" && hasValue) {
+      unsigned w = 0, h = 0;
+      if (std::sscanf(argv[++i], "%ux%u", &w, &h) != 2 || !w || !h) {
+        fprintf(stderr, "--tiles takes WxH, e.g. 10000x1000\n");
+        return false;
+      }
+      o.tilesX = w;
+      o.tilesY = h;
+    } else if (arg == "--stream" && hasValue) {
+      o.streamEntities = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--stream-budget" && hasValue) {
+      o.streamBudget = std::strtoull(argv[++i], nullptr, 10) << 20;
+    } else if (arg == "--scene" && hasValue) {
+      o.sceneEntities = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--run" && hasValue) {
+      const std::string mode = argv[++i];
+      o.run = true;
+      if (mode == "serial") {
+        o.pipeline = FramePipeline::SERIAL;
+      } else if (mode == "double") {
+        o.pipeline = FramePipeline::DOUBLE_BUFFERED;
+      } else if (mode == "triple") {
+        o.pipeline = FramePipeline::TRIPLE_BUFFERED;
+      } else {
+        fprintf(stderr, "--run takes serial, double or triple\n");
+        return false;
+      }
+    } else {
+      fprintf(stderr, "unknown or incomplete option: %s\n", arg.c_str());
+      return false;
+    }
+  }
+  if (o.rollback >= (int)cfg::STATE_RING_TICKS) {
+    fprintf(stderr, "--rollback must be below %zu\n", cfg::STATE_RING_TICKS);
+    return false;
+  }
+  // Churn happens outside the simulation, so re-simulating can't replay it.
+  if (o.rollback > 0 && o.churn > 0) {
+    fprintf(stderr, "--rollback and --churn can't be combined\n");
+    return false;
+  }
+  // Nor streaming, which isn't part of the snapshots.
+  if (o.rollback > 0 && o.streamEntities > 0) {
+    fprintf(stderr, "--rollback and --stream can't be combined\n");
+    return false;
+  }
+  if (o.run && (o.rollback > 0 || o.churn > 0 || !o.render)) {
+    fprintf(stderr, "--run renders, and can't be combined with --rollback "
+                    "or --churn\n");
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  Options opts;
+  if (!ParseOptions(argc, argv, opts)) {
+    fprintf(stderr,
+            "usage: %s [--statics N] [--dynamics N] [--ticks N] [--warmup N]"
+            " [--threads N] [--seed N] [--no-render] [--world]"
+            " [--contact-list] [--brute-force] [--churn N] [--no-layers]"
+            " [--settle] [--no-sleep] [--rollback N]"
+            " [--run serial|double|triple] [--no-static-cache]"
+            " [--static-textures N] [--tiles WxH] [--stream N]"
+            " [--stream-budget MB] [--scene N]\n",
+            argv[0]);
+    return 2;
+  }
+
+  // No window system needed; "dummy" is the fallback on builds without the
+  // offscreen driver.
+  SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen,dummy");
+
+  GameEngine engine;
+  if (opts.threads >= 0)
+    engine.SetThreadCount((unsigned)opts.threads);
+  engine.SetTargetFrameRate(0);
+  if (!engine.Initialize("engine_bench", cfg::SCREEN_WIDTH,
+                         cfg::SCREEN_HEIGHT)) {
+    return 1;
+  }
+  CollisionSystem *collision = engine.GetCollision();
+  collision->SetBroadphaseMode(opts.bruteForce ? BroadphaseMode::BRUTE_FORCE
+                                               : BroadphaseMode::UNIFORM_GRID);
+  collision->SetNarrowphaseMode(opts.contactList
+                                    ? NarrowphaseMode::CONTACT_LIST
+                                    : NarrowphaseMode::SEQUENTIAL);
+  engine.EnableWorld(opts.world);
+  engine.SetStaticCaching(opts.staticCache);
+  engine.GetPhysics()->SetSleepEnabled(opts.sleep);
+  BenchFalling::SetTimedRespawn(!opts.settle);
+  BenchStatic::SetLayered(opts.layers);
+
+  // One shared sprite so rendering exercises batching and culling, and
+  // as many platform textures as asked for.
+  std::vector<uint32_t> pixels(16 * 16, 0xffffffffu);
+  auto makeTexture = [&]() {
+    SDL_Texture *texture = SDL_CreateTexture(
+        engine.GetRenderer(), SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_STATIC, 16, 16);
+    if (texture)
+      SDL_UpdateTexture(texture, nullptr, pixels.data(), 16 * 4);
+    return texture;
+  };
+  SDL_Texture *sprite = makeTexture();
+  std::vector<SDL_Texture *> staticTextures = {sprite};
+  while ((int)staticTextures.size() < opts.staticTextures)
+    staticTextures.push_back(makeTexture());
+
+  // Density stays constant as the population grows: roughly one body per
+  // 64x64 area, never smaller than the screen.
+  const double bodies = (double)(opts.statics + opts.dynamics);
+  const float side = (float)std::max(std::sqrt(bodies) * 64.0, 2048.0);
+  std::mt19937 rng(opts.seed);
+  std::uniform_real_distribution<float> coord(0.0f, side);
+  std::uniform_real_distribution<float> width(64.0f, 256.0f);
+
+  for (size_t i = 0; i < opts.statics; ++i) {
+    BenchStatic *e =
+        engine.Spawn<BenchStatic>(coord(rng), coord(rng), width(rng), 24.0f);
+    e->SetTexture(staticTextures[i % staticTextures.size()]);
+  }
+  if (opts.tilesX > 0) {
+    constexpr float tileSize = 32.0f;
+    Tilemap *tiles = engine.CreateTilemap(opts.tilesX, opts.tilesY, tileSize);
+    tiles->SetCollisionLayer(BENCH_LAYER_STATIC);
+    const uint16_t ground =
+        tiles->AddTileType({sprite, {0.0f, 0.0f, -1.0f, -1.0f}, TILE_SOLID});
+    const uint16_t ledge = tiles->AddTileType(
+        {staticTextures.back(), {0.0f, 0.0f, -1.0f, -1.0f}, TILE_ONE_WAY});
+    const int base = (int)std::min<float>((float)opts.tilesY - 1.0f,
+                                          0.75f * side / tileSize);
+    int surface = base;
+    for (uint32_t x = 0; x < opts.tilesX; ++x) {
+      surface = std::clamp(surface + (int)(rng() % 3) - 1, base - 8, base + 8);
+      surface = std::clamp(surface, 0, (int)opts.tilesY - 1);
+      tiles->Fill(x, (uint32_t)surface, 1, opts.tilesY, ground);
+      if (rng() % 16 == 0 && surface > 12)
+        tiles->Fill(x, (uint32_t)(surface - 6 - rng() % 6), 3 + rng() % 5, 1,
+                    ledge);
+    }
+  }
+
+  // Region files, written fresh every run.
+  constexpr float regionSize = 1024.0f;
+  constexpr int32_t regionsX = 64, regionsY = 4;
+  const char *streamDir = "engine_bench_regions";
+  if (opts.streamEntities > 0) {
+    engine.RegisterEntityType<BenchStatic>("platform");
+    std::filesystem::remove_all(streamDir);
+    std::filesystem::create_directories(streamDir);
+    const Tilemap *tiles = engine.GetTilemap();
+    std::uniform_real_distribution<float> local(0.0f, regionSize - 256.0f);
+    for (int32_t ry = 0; ry < regionsY; ++ry) {
+      for (int32_t rx = 0; rx < regionsX; ++rx) {
+        const std::string path = std::string(streamDir) + "/" +
+                                 std::to_string(rx) + "_" +
+                                 std::to_string(ry) + ".region";
+        FILE *file = std::fopen(path.c_str(), "w");
+        if (!file)
+          continue;
+        for (size_t i = 0; i < opts.streamEntities; ++i)
+          fprintf(file, "entity platform %.1f %.1f %.1f 24\n", local(rng),
+                  local(rng), width(rng));
+        if (tiles)
+          fprintf(file, "tiles 0 %u %u 1 1\n",
+                  (unsigned)(regionSize / tiles->GetTileSize()) - 1,
+                  (unsigned)(regionSize / tiles->GetTileSize()));
+        std::fclose(file);
+      }
+    }
+    LevelStreamer *streamer = engine.CreateStreamer(streamDir, regionSize);
+    streamer->SetMemoryBudget(opts.streamBudget);
+  }
+  // The same platforms from text and from the compiled scene.
+  Scene scene;
+  const char *sceneText = "engine_bench_scene.txt";
+  const char *sceneFile = "engine_bench.scene";
+  double sceneTextMs = 0.0, sceneBinaryMs = 0.0;
+  size_t sceneBytes = 0;
+  if (opts.sceneEntities > 0) {
+    engine.RegisterEntityType<BenchStatic>("platform");
+    LevelData data;
+    data.types.push_back("platform");
+    for (size_t i = 0; i < opts.sceneEntities; ++i)
+      data.entities.push_back({.type = 0,
+                               .texture = LEVEL_NO_TEXTURE,
+                               .position = {.x = coord(rng), .y = coord(rng)},
+                               .dimensions = {.x = width(rng), .y = 24.0f},
+                               .param = 0});
+    std::vector<uint8_t> bytes;
+    FILE *text = std::fopen(sceneText, "w");
+    FILE *binary = std::fopen(sceneFile, "wb");
+    if (text) {
+      for (const LevelEntity &e : data.entities)
+        fprintf(text, "entity platform %.2f %.2f %.2f %.2f\n", e.position.x,
+                e.position.y, e.dimensions.x, e.dimensions.y);
+      std::fclose(text);
+    }
+    if (binary) {
+      if (WriteScene(data, sceneFile, bytes))
+        std::fwrite(bytes.data(), 1, bytes.size(), binary);
+      std::fclose(binary);
+    }
+    sceneBytes = bytes.size();
+    // Binary first, so it's the one that pays for growing the pool.
+    if (scene.Load(engine, sceneFile))
+      sceneBinaryMs = scene.GetLoadMs();
+    Scene fromText;
+    if (fromText.LoadText(engine, sceneText))
+      sceneTextMs = fromText.GetLoadMs();
+    fromText.Unload(engine);
+  }
+
+  // Pans right along the region strip, wrapping at its end.
+  const SDL_FRect streamLimits = {0.0f, 0.0f, regionSize * regionsX,
+                                  regionSize * regionsY};
+  uint64_t streamFrame = 0;
+  auto stream = [&]() {
+    if (opts.streamEntities == 0)
+      return;
+    const float x = std::fmod(512.0f + 4096.0f / cfg::TICK_RATE *
+                                           (float)streamFrame++,
+                              streamLimits.w - 1024.0f);
+    engine.GetRenderSystem()->GetCamera().CenterOn(
+        {.x = x, .y = 0.5f * streamLimits.h}, streamLimits);
+    engine.UpdateStreaming();
+  };
+
+  std::vector<EntityHandle> falling;
+  falling.reserve(opts.dynamics);
+  auto spawnFalling = [&]() {
+    BenchFalling *e = engine.Spawn<BenchFalling>(coord(rng), coord(rng), side,
+                                                 side, (uint32_t)rng());
+    e->SetTexture(sprite);
+    if (opts.layers) {
+      e->collisionLayer = BENCH_LAYER_FALLING;
+      e->collisionMask = BENCH_LAYER_STATIC | BENCH_LAYER_FALLING;
+    }
+    return e->GetHandle();
+  };
+  for (size_t i = 0; i < opts.dynamics; ++i) {
+    falling.push_back(spawnFalling());
+  }
+  // Replaces random falling bodies. Recorded as commands, like gameplay
+  // would, so they're applied at the end of the tick, after collisions.
+  auto churn = [&]() {
+    CommandBuffer &commands = engine.Commands();
+    for (size_t i = 0; i < opts.churn && !falling.empty(); ++i) {
+      const size_t k = rng() % falling.size();
+      commands.Defer([&, k](GameEngine &) {
+        engine.Despawn(falling[k]);
+        falling[k] = spawnFalling();
+      });
+    }
+  };
+  engine.GetRenderSystem()->GetCamera().CenterOn(
+      {.x = 0.5f * side, .y = 0.5f * side}, {0.0f, 0.0f, side, side});
+
+  for (int i = 0; i < opts.warmup; ++i) {
+    stream();
+    churn();
+    engine.Step();
+    if (opts.render)
+      engine.Render();
+    Profiler::EndFrame();
+  }
+
+  if (opts.run) {
+    const FrameStats before = engine.GetFrameStats();
+    engine.SetFramePipeline(opts.pipeline);
+    engine.SetTargetFrameRate(cfg::TARGET_FPS);
+    engine.SetFrameLimit(before.frames + (uint64_t)opts.ticks);
+    const Uint64 runStart = SDL_GetTicksNS();
+    engine.Run();
+    const double wallMs =
+        (double)(SDL_GetTicksNS() - runStart) / SDL_NS_PER_MS;
+    const FrameStats &after = engine.GetFrameStats();
+    const uint64_t ticks = after.ticks - before.ticks;
+    const uint64_t frames = after.frames - before.frames;
+    printf("{\n");
+    printf("  \"config\": {\"statics\": %zu, \"dynamics\": %zu, "
+           "\"frames\": %d, \"threads\": %u, \"pipeline\": \"%s\"},\n",
+           opts.statics, opts.dynamics, opts.ticks,
+           engine.GetJobSystem()->GetThreadCount(),
+           opts.pipeline == FramePipeline::SERIAL            ? "serial"
+           : opts.pipeline == FramePipeline::DOUBLE_BUFFERED ? "double"
+                                                             : "triple");
+    printf("  \"wall_ms\": %.3f,\n", wallMs);
+    printf("  \"fps\": %.2f,\n", 1000.0 * (double)frames / wallMs);
+    printf("  \"ticks_per_second\": %.2f,\n", 1000.0 * (double)ticks / wallMs);
+    printf("  \"ticks\": %llu,\n", (unsigned long long)ticks);
+    printf("  \"late_frames\": %llu,\n",
+           (unsigned long long)(after.lateFrames - before.lateFrames));
+    printf("  \"dropped_ticks\": %llu,\n",
+           (unsigned long long)(after.droppedTicks - before.droppedTicks));
+    printf("  \"skipped_lists\": %llu\n",
+           (unsigned long long)(after.skippedLists - before.skippedLists));
+    printf("}\n");
+    engine.Shutdown();
+    return 0;
+  }
+
+  // Saves this tick, then goes back opts.rollback ticks and steps forward
+  // again, as if an input for that tick had just arrived.
+  StateRing ring;
+  std::vector<double> saveMs, restoreMs, resimMs, rollbackMs;
+  uint64_t desyncs = 0;
+  size_t snapshotBytes = 0;
+  auto rollback = [&]() {
+    Uint64 t0 = SDL_GetTicksNS();
+    ring.Save(engine);
+    saveMs.push_back((double)(SDL_GetTicksNS() - t0) / SDL_NS_PER_MS);
+    const uint64_t present = engine.GetTick();
+    snapshotBytes = ring.GetSize(present);
+    if (!ring.Has(present - (uint64_t)opts.rollback))
+      return; // not enough history yet
+
+    t0 = SDL_GetTicksNS();
+    if (!ring.Restore(engine, present - (uint64_t)opts.rollback))
+      ++desyncs;
+    const Uint64 t1 = SDL_GetTicksNS();
+    while (engine.GetTick() < present) {
+      engine.Step();
+      const uint64_t expected = ring.GetHash(engine.GetTick());
+      if (ring.Save(engine) != expected)
+        ++desyncs;
+    }
+    const Uint64 t2 = SDL_GetTicksNS();
+    restoreMs.push_back((double)(t1 - t0) / SDL_NS_PER_MS);
+    resimMs.push_back((double)(t2 - t1) / SDL_NS_PER_MS);
+    rollbackMs.push_back((double)(t2 - t0) / SDL_NS_PER_MS);
+  };
+
+  std::vector<double> frameMs, stepMs, renderMs, allocs, allocMB;
+  std::map<std::string, std::vector<double>> phases;
+  uint64_t staticRedraws = 0;
+  // Frames that churned but where the view query Render used culled
+  // nothing: the spawns and despawns cost the grid index, and every entity
+  // was tested against the view.
+  uint64_t unculledChurnFrames = 0;
+  const bool checkCulling = opts.churn > 0 && opts.render && !opts.bruteForce;
+  std::vector<uint32_t> visible;
+  const Uint64 runStart = SDL_GetTicksNS();
+  for (int i = 0; i < opts.ticks; ++i) {
+    const uint64_t countBefore = allocCount.load(std::memory_order_relaxed);
+    const uint64_t bytesBefore = allocBytes.load(std::memory_order_relaxed);
+    const Uint64 t0 = SDL_GetTicksNS();
+    stream();
+    churn();
+    engine.Step();
+    const Uint64 t1 = SDL_GetTicksNS();
+    if (opts.render)
+      engine.Render();
+    const Uint64 t2 = SDL_GetTicksNS();
+    staticRedraws += engine.GetRenderSystem()->GetStats().staticRedraws;
+
+    stepMs.push_back((double)(t1 - t0) / SDL_NS_PER_MS);
+    renderMs.push_back((double)(t2 - t1) / SDL_NS_PER_MS);
+    frameMs.push_back((double)(t2 - t0) / SDL_NS_PER_MS);
+    allocs.push_back(
+        (double)(allocCount.load(std::memory_order_relaxed) - countBefore));
+    allocMB.push_back(
+        (double)(allocBytes.load(std::memory_order_relaxed) - bytesBefore) /
+        (1024.0 * 1024.0));
+    if (checkCulling) {
+      visible.clear();
+      if (!collision->QueryRegion(engine.GetRenderSystem()->GetCullBounds(),
+                                  visible) ||
+          visible.size() == engine.GetEntities().size())
+        ++unculledChurnFrames;
+    }
+    // Timed on its own, outside the frame.
+    if (opts.rollback > 0)
+      rollback();
+
+    Profiler::EndFrame();
+    for (const std::string &marker : Profiler::GetMarkers())
+      phases[marker].push_back(Profiler::GetStats(marker.c_str()).lastMs);
+  }
+  const double wallMs =
+      (double)(SDL_GetTicksNS() - runStart) / SDL_NS_PER_MS;
+  const RenderStats render = engine.GetRenderSystem()->GetStats();
+  size_t sleeping = 0;
+  for (const Entity *e : engine.GetEntities())
+    sleeping += e->sleeping ? 1 : 0;
+
+  printf("{\n");
+  printf("  \"config\": {\"statics\": %zu, \"dynamics\": %zu, \"ticks\": %d, "
+         "\"warmup\": %d, \"threads\": %u, \"render\": %s, \"world\": %s, "
+         "\"narrowphase\": \"%s\", \"broadphase\": \"%s\", "
+         "\"churn\": %zu, \"layers\": %s, \"settle\": %s, "
+         "\"sleep\": %s, \"rollback\": %d, \"static_cache\": %s, "
+         "\"static_textures\": %d, \"world_size\": %.0f, "
+         "\"tiles\": \"%ux%u\", \"stream\": %zu},\n",
+         opts.statics, opts.dynamics, opts.ticks, opts.warmup,
+         engine.GetJobSystem()->GetThreadCount(),
+         opts.render ? "true" : "false", opts.world ? "true" : "false",
+         opts.contactList ? "contact_list" : "sequential",
+         opts.bruteForce ? "brute_force" : "uniform_grid", opts.churn,
+         opts.layers ? "true" : "false", opts.settle ? "true" : "false",
+         opts.sleep ? "true" : "false", opts.rollback,
+         opts.staticCache ? "true" : "false", opts.staticTextures, side,
+         opts.tilesX, opts.tilesY, opts.streamEntities);
+  printf("  \"wall_ms\": %.3f,\n", wallMs);
+  printf("  \"fps\": %.2f,\n", 1000.0 * opts.ticks / wallMs);
+  printf("  \"peak_rss_kb\": %llu,\n", (unsigned long long)PeakRssKB());
+  printf("  \"allocations_per_frame\": %.2f,\n", Summarize(allocs).mean);
+  printf("  \"allocated_mb_per_frame\": %.4f,\n", Summarize(allocMB).mean);
+  printf("  \"last_frame\": {\"draw_calls\": %u, \"sprites\": %u, "
+         "\"culled\": %u, \"static_chunks\": %u, \"pair_tests\": %zu, "
+         "\"sleeping\": %zu, \"tile_chunks\": %u, \"tile_tests\": %zu},\n",
+         render.drawCalls, render.sprites, render.culled, render.staticChunks,
+         collision->GetPairTestCount(), sleeping, render.tileChunks,
+         collision->GetTileTestCount());
+  if (const Tilemap *tiles = engine.GetTilemap())
+    printf("  \"tile_memory_kb\": %zu,\n", tiles->GetMemoryBytes() / 1024);
+  printf("  \"static_redraws\": %llu,\n", (unsigned long long)staticRedraws);
+  if (checkCulling)
+    printf("  \"unculled_churn_frames\": %llu,\n",
+           (unsigned long long)unculledChurnFrames);
+  if (LevelStreamer *streamer = engine.GetStreamer()) {
+    const StreamStats ss = streamer->GetStats();
+    printf("  \"stream\": {\"resident_regions\": %u, \"pending_regions\": %u, "
+           "\"resident_kb\": %zu, \"activations\": %llu, \"unloads\": %llu, "
+           "\"last_activation_ms\": %.3f, \"worst_stall_ms\": %.3f},\n",
+           ss.residentRegions, ss.pendingRegions, ss.residentBytes / 1024,
+           (unsigned long long)ss.activations,
+           (unsigned long long)ss.unloads, ss.lastActivationMs,
+           ss.worstStallMs);
+  }
+  if (opts.sceneEntities > 0)
+    printf("  \"scene\": {\"entities\": %zu, \"bytes\": %zu, "
+           "\"text_ms\": %.3f, \"binary_ms\": %.3f},\n",
+           scene.GetEntities().size(), sceneBytes, sceneTextMs, sceneBinaryMs);
+  if (opts.rollback > 0) {
+    printf("  \"rollback\": {\"snapshot_bytes\": %zu, \"desyncs\": %llu,\n",
+           snapshotBytes, (unsigned long long)desyncs);
+    PrintSummary("save", Summarize(saveMs), true);
+    PrintSummary("restore", Summarize(restoreMs), true);
+    PrintSummary("resim", Summarize(resimMs), true);
+    PrintSummary("restore_resim", Summarize(rollbackMs), false);
+    printf("  },\n");
+  }
+  printf("  \"timings_ms\": {\n");
+  PrintSummary("frame", Summarize(frameMs), true);
+  PrintSummary("step", Summarize(stepMs), true);
+  PrintSummary("render", Summarize(renderMs), false);
+  printf("  },\n");
+  printf("  \"phases_ms\": {\n");
+  size_t printed = 0;
+  for (const auto &kv : phases)
+    PrintSummary(kv.first.c_str(), Summarize(kv.second),
+                 ++printed < phases.size());
+  printf("  }\n");
+  printf("}\n");
+
+  engine.Shutdown();
+  if (unculledChurnFrames > 0) {
+    fprintf(stderr, "%llu churn frames culled nothing\n",
+            (unsigned long long)unculledChurnFrames);
+    return 1;
+  }
+  return 0;
+}
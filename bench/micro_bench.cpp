@@ -0,0 +1,276 @@
+// Microbenchmarks for the engine's per-body hot functions. Each benchmark
+// is calibrated so one sample takes about --sample-ms, warmed up, then
+// sampled --samples times; the report is ns per call.
+//
+//   engine_microbench [--filter TEXT] [--samples N] [--sample-ms N]
+//                     [--warmup-ms N] [--json]
+#include "Collisions.h"
+#include "Config.h"
+#include "Entity.h"
+#include "Input.h"
+#include "Physics.h"
+#include "Render.h"
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+// Keeps the compiler from discarding a result or hoisting work out of the
+// timed loop.
+template <typename T> inline void DoNotOptimize(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(value) : "memory");
+#else
+  const volatile char *p = reinterpret_cast<const volatile char *>(&value);
+  (void)*p;
+#endif
+}
+
+static constexpr size_t DATA = 1024; // inputs cycle through L1-sized arrays
+static constexpr size_t MASK = DATA - 1;
+
+struct Options {
+  std::string filter;
+  int samples = 30;
+  double sampleMs = 10.0;
+  double warmupMs = 200.0;
+  bool json = false;
+};
+
+struct Benchmark {
+  std::string name;
+  std::function<void(uint64_t)> run; // performs `iterations` calls
+};
+
+struct Result {
+  std::string name;
+  uint64_t iterations; // per sample
+  double min, median, mean, stddev, max;
+};
+
+static double TimeNs(const Benchmark &b, uint64_t iterations) {
+  const Uint64 start = SDL_GetTicksNS();
+  b.run(iterations);
+  return (double)(SDL_GetTicksNS() - start);
+}
+
+static Result Measure(const Benchmark &b, const Options &o) {
+  // Grow the batch until one run is long enough to time reliably, then
+  // scale it to the requested sample length.
+  uint64_t iterations = 1;
+  double ns = TimeNs(b, iterations);
+  while (ns < o.sampleMs * 1e5 && iterations < (1ull << 40)) {
+    iterations *= 2;
+    ns = TimeNs(b, iterations);
+  }
+  iterations = std::max<uint64_t>(
+      1, (uint64_t)((double)iterations * (o.sampleMs * 1e6) / std::max(ns, 1.0)));
+
+  const Uint64 warmupEnd = SDL_GetTicksNS() + (Uint64)(o.warmupMs * 1e6);
+  while (SDL_GetTicksNS() < warmupEnd)
+    b.run(iterations / 10 + 1);
+
+  std::vector<double> perOp;
+  for (int s = 0; s < o.samples; ++s)
+    perOp.push_back(TimeNs(b, iterations) / (double)iterations);
+  std::sort(perOp.begin(), perOp.end());
+
+  Result r{b.name, iterations, perOp.front(), perOp[perOp.size() / 2], 0.0,
+           0.0, perOp.back()};
+  for (double v : perOp)
+    r.mean += v;
+  r.mean /= (double)perOp.size();
+  for (double v : perOp)
+    r.stddev += (v - r.mean) * (v - r.mean);
+  r.stddev = std::sqrt(r.stddev / (double)perOp.size());
+  return r;
+}
+
+static bool ParseOptions(int argc, char *argv[], Options &o) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "--filter" && hasValue) {
+      o.filter = argv[++i];
+    } else if (arg == "--samples" && hasValue) {
+      o.samples = std::max(3, std::atoi(argv[++i]));
+    } else if (arg == "--sample-ms" && hasValue) {
+      o.sampleMs = std::max(0.1, std::atof(argv[++i]));
+    } else if (arg == "--warmup-ms" && hasValue) {
+      o.warmupMs = std::max(0.0, std::atof(argv[++i]));
+    } else if (arg == "--json") {
+      o.json = true;
+    } else {
+      fprintf(stderr, "unknown or incomplete option: %s\n", arg.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  Options opts;
+  if (!ParseOptions(argc, argv, opts)) {
+    fprintf(stderr,
+            "usage: %s [--filter TEXT] [--samples N] [--sample-ms N]"
+            " [--warmup-ms N] [--json]\n",
+            argv[0]);
+    return 2;
+  }
+
+  // Shared inputs, generated once with a fixed seed so runs are comparable.
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> coord(0.0f, 1920.0f);
+  std::uniform_real_distribution<float> extent(8.0f, 256.0f);
+  std::vector<vec2> va(DATA), vb(DATA);
+  std::vector<float> scalars(DATA);
+  std::vector<SDL_FRect> rects(DATA);
+  std::vector<Entity> bodies;
+  bodies.reserve(DATA);
+  for (size_t i = 0; i < DATA; ++i) {
+    va[i] = {.x = coord(rng), .y = coord(rng)};
+    vb[i] = {.x = coord(rng) + 1.0f, .y = coord(rng) + 1.0f};
+    scalars[i] = extent(rng) / 256.0f;
+    rects[i] = {coord(rng), coord(rng), extent(rng), extent(rng)};
+    bodies.emplace_back(rects[i].x, rects[i].y, rects[i].w, rects[i].h);
+  }
+
+  CollisionSystem collision;
+  PhysicsSystem physics;
+  RenderSystem render(nullptr, cfg::SCREEN_WIDTH, cfg::SCREEN_HEIGHT);
+  render.SetScalingMode(ScalingMode::PROPORTIONAL);
+  render.screenWidth = 1280.0f;
+  render.screenHeight = 720.0f;
+  render.BeginFrame();
+  InputManager input;
+  input.Update();
+  const SDL_Scancode keys[4] = {SDL_SCANCODE_A, SDL_SCANCODE_D,
+                                SDL_SCANCODE_SPACE, SDL_SCANCODE_LEFT};
+
+  // One dynamic body resting 4px into a static one, and a pair far apart.
+  Entity mover(100.0f, 96.0f, 32.0f, 32.0f);
+  Entity ground(0.0f, 124.0f, 400.0f, 20.0f);
+  ground.isStatic = true;
+  Entity away(1000.0f, 1000.0f, 32.0f, 32.0f);
+  const vec2 moverStart = mover.position;
+
+  std::vector<Benchmark> benchmarks = {
+      {"vec2/add",
+       [&](uint64_t n) {
+         for (uint64_t i = 0; i < n; ++i)
+           DoNotOptimize(add(va[i & MASK], vb[i & MASK]));
+       }},
+      {"vec2/sub",
+       [&](uint64_t n) {
+         for (uint64_t i = 0; i < n; ++i)
+           DoNotOptimize(sub(va[i & MASK], vb[i & MASK]));
+       }},
+      {"vec2/neg",
+       [&](uint64_t n) {
+         for (uint64_t i = 0; i < n; ++i)
+           DoNotOptimize(neg(va[i & MASK]));
+       }},
+      {"vec2/dot",
+       [&](uint64_t n) {
+         for (uint64_t i = 0; i < n; ++i)
+           DoNotOptimize(dot(va[i & MASK], vb[i & MASK]));
+       }},
+      {"vec2/mul",
+       [&](uint64_t n) {
+         for (uint64_t i = 0; i < n; ++i)
+           DoNotOptimize(mul(scalars[i & MASK], va[i & MASK]));
+       }},
+      {"vec2/mulv",
+       [&](uint64_t n) {
+         for (uint64_t i = 0; i < n; ++i)
+           DoNotOptimize(mulv(va[i & MASK], vb[i & MASK]));
+       }},
+      {"vec2/normalize",
+       [&](uint64_t n) {
+         for (uint64_t i = 0; i < n; ++i)
+           DoNotOptimize(normalize(vb[i & MASK]));
+       }},
+      {"CheckCollision/rects",
+       [&](uint64_t n) {
+         for (uint64_t i = 0; i < n; ++i)
+           DoNotOptimize(
+               collision.CheckCollision(rects[i & MASK], rects[(i + 1) & MASK]));
+       }},
+      {"CheckCollision/entities",
+       [&](uint64_t n) {
+         for (uint64_t i = 0; i < n; ++i)
+           DoNotOptimize(collision.CheckCollision(&bodies[i & MASK],
+                                                  &bodies[(i + 1) & MASK]));
+       }},
+      {"ResolvePair/overlapping",
+       [&](uint64_t n) {
+         for (uint64_t i = 0; i < n; ++i) {
+           mover.position = moverStart;
+           DoNotOptimize(collision.ResolvePair(&mover, &ground));
+         }
+       }},
+      {"ResolvePair/separate",
+       [&](uint64_t n) {
+         for (uint64_t i = 0; i < n; ++i)
+           DoNotOptimize(collision.ResolvePair(&away, &ground));
+       }},
+      {"ApplyPhysics",
+       [&](uint64_t n) {
+         for (uint64_t i = 0; i < n; ++i) {
+           Entity &e = bodies[i & MASK];
+           physics.ApplyPhysics(&e, 1.0f / 60.0f);
+           DoNotOptimize(e.position);
+           if ((i & MASK) == MASK) { // keep positions bounded
+             for (size_t k = 0; k < DATA; ++k) {
+               bodies[k].position = {.x = rects[k].x, .y = rects[k].y};
+               bodies[k].velocity = {.x = 0.0f, .y = 0.0f};
+             }
+           }
+         }
+       }},
+      {"CalculateRenderRect",
+       [&](uint64_t n) {
+         for (uint64_t i = 0; i < n; ++i)
+           DoNotOptimize(render.CalculateRenderRect(&bodies[i & MASK]));
+       }},
+      {"IsKeyJustPressed",
+       [&](uint64_t n) {
+         for (uint64_t i = 0; i < n; ++i)
+           DoNotOptimize(input.IsKeyJustPressed(keys[i & 3]));
+       }},
+  };
+
+  std::vector<Result> results;
+  for (const Benchmark &b : benchmarks) {
+    if (!opts.filter.empty() && b.name.find(opts.filter) == std::string::npos)
+      continue;
+    results.push_back(Measure(b, opts));
+    const Result &r = results.back();
+    if (!opts.json)
+      printf("%-26s %9.3f ns/op  (min %.3f, mean %.3f, max %.3f, "
+             "cv %.1f%%, %llu ops x %d)\n",
+             r.name.c_str(), r.median, r.min, r.mean, r.max,
+             r.mean > 0.0 ? 100.0 * r.stddev / r.mean : 0.0,
+             (unsigned long long)r.iterations, opts.samples);
+  }
+
+  if (opts.json) {
+    printf("[\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+      const Result &r = results[i];
+      printf("  {\"name\": \"%s\", \"median_ns\": %.4f, \"min_ns\": %.4f, "
+             "\"mean_ns\": %.4f, \"stddev_ns\": %.4f, \"max_ns\": %.4f, "
+             "\"iterations\": %llu, \"samples\": %d}%s\n",
+             r.name.c_str(), r.median, r.min, r.mean, r.stddev, r.max,
+             (unsigned long long)r.iterations, opts.samples,
+             i + 1 < results.size() ? "," : "");
+    }
+    printf("]\n");
+  }
+  return 0;
+}
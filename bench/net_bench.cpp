@@ -0,0 +1,344 @@
+// Replication benchmark. Runs a server and N clients in one process, talking
+// UDP over localhost through NetConditioner (loss / latency / jitter on both
+// directions), in real time at the engine's tick rate. Each client drives an
+// avatar on the server with random input. Prints one JSON object to stdout.
+//
+//   net_bench [--clients N] [--statics N] [--dynamics N] [--ticks N]
+//             [--loss PERCENT] [--latency MS] [--jitter MS] [--seed N]
+//             [--threads N] [--settle]
+//
+// Bandwidth counts UDP payload; "with_headers" adds 28 bytes of IPv4 + UDP
+// header per datagram. Server tick cost is receive + capture + encode + send,
+// separate from the simulation step.
+#include "BenchEntities.h"
+#include "Config.h"
+#include "GameEngine.h"
+#include "NetClient.h"
+#include "NetServer.h"
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+struct Options {
+  int clients = cfg::NET_MAX_CLIENTS;
+  size_t statics = 200;
+  size_t dynamics = 1000;
+  int ticks = 600;
+  NetConditions conditions = {
+      .lossPercent = 5.0f, .latencyMs = 50.0f, .jitterMs = 10.0f};
+  unsigned seed = 1;
+  int threads = -1; // -1 = engine default
+  bool settle = false;
+};
+
+enum BenchButtons : uint32_t {
+  BUTTON_LEFT = 1u << 0,
+  BUTTON_RIGHT = 1u << 1,
+  BUTTON_JUMP = 1u << 2,
+};
+
+// A client's body on the server, steered by that client's latest input.
+class BenchAvatar : public Entity {
+private:
+  const NetServer *server;
+  int client;
+  float worldHeight;
+
+public:
+  BenchAvatar(float x, float y, const NetServer *server, int client,
+              float worldH)
+      : Entity(x, y, 32, 48), server(server), client(client),
+        worldHeight(worldH) {
+    canSleep = false;
+  }
+
+  void Update(float, InputManager *) override {
+    const uint32_t buttons = server->GetInput(client).buttons;
+    velocity.x = 0.0f;
+    if (buttons & BUTTON_LEFT)
+      velocity.x -= cfg::PLAYER_SPEED_X;
+    if (buttons & BUTTON_RIGHT)
+      velocity.x += cfg::PLAYER_SPEED_X;
+    if ((buttons & BUTTON_JUMP) && grounded)
+      velocity.y = cfg::PLAYER_JUMP_IMPULSE;
+    grounded = false;
+    if (position.y > worldHeight)
+      Teleport({.x = position.x, .y = 0.0f});
+  }
+
+  void OnCollision(Entity *, CollisionData *data) override {
+    if (data->normal.y < 0.0f && velocity.y > 0.0f) {
+      velocity.y = 0.0f;
+      grounded = true;
+    }
+  }
+};
+
+struct Summary {
+  double mean = 0.0, p50 = 0.0, p99 = 0.0, max = 0.0;
+};
+
+static Summary Summarize(std::vector<double> v) {
+  Summary s;
+  if (v.empty())
+    return s;
+  std::sort(v.begin(), v.end());
+  double sum = 0.0;
+  for (double x : v)
+    sum += x;
+  s.mean = sum / (double)v.size();
+  s.p50 = v[v.size() / 2];
+  s.p99 = v[std::min(v.size() - 1, v.size() * 99 / 100)];
+  s.max = v.back();
+  return s;
+}
+
+static void PrintSummary(const char *key, const Summary &s, bool comma) {
+  printf("    \"%s\": {\"mean\": %.4f, \"p50\": %.4f, \"p99\": %.4f, "
+         "\"max\": %.4f}%s\n",
+         key, s.mean, s.p50, s.p99, s.max, comma ? "," : "");
+}
+
+static bool ParseOptions(int argc, char *argv[], Options &o) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "--clients" && hasValue) {
+      o.clients = std::clamp(std::atoi(argv[++i]), 1, cfg::NET_MAX_CLIENTS);
+    } else if (arg == "--statics" && hasValue) {
+      o.statics = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--dynamics" && hasValue) {
+      o.dynamics = std::strtoull(argv[++i], nullptr, 10);
+    } else if (arg == "--ticks" && hasValue) {
+      o.ticks = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--loss" && hasValue) {
+      o.conditions.lossPercent = (float)std::atof(argv[++i]);
+    } else if (arg == "--latency" && hasValue) {
+      o.conditions.latencyMs = (float)std::atof(argv[++i]);
+    } else if (arg == "--jitter" && hasValue) {
+      o.conditions.jitterMs = (float)std::atof(argv[++i]);
+    } else if (arg == "--seed" && hasValue) {
+      o.seed = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--threads" && hasValue) {
+      o.threads = std::max(0, std::atoi(argv[++i]));
+    } else if (arg == "--settle") {
+      o.settle = true;
+    } else {
+      fprintf(stderr, "unknown or incomplete option: %s\n", arg.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  Options opts;
+  if (!ParseOptions(argc, argv, opts)) {
+    fprintf(stderr,
+            "usage: %s [--clients N] [--statics N] [--dynamics N]"
+            " [--ticks N] [--loss PERCENT] [--latency MS] [--jitter MS]"
+            " [--seed N] [--threads N] [--settle]\n",
+            argv[0]);
+    return 2;
+  }
+
+  SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen,dummy");
+
+  GameEngine engine;
+  if (opts.threads >= 0)
+    engine.SetThreadCount((unsigned)opts.threads);
+  if (!engine.Initialize("net_bench", cfg::SCREEN_WIDTH, cfg::SCREEN_HEIGHT))
+    return 1;
+  BenchFalling::SetTimedRespawn(!opts.settle);
+  BenchStatic::SetLayered(false); // avatars collide with everything
+
+  const double bodies = (double)(opts.statics + opts.dynamics);
+  const float side = (float)std::max(std::sqrt(bodies) * 64.0, 2048.0);
+  std::mt19937 rng(opts.seed);
+  std::uniform_real_distribution<float> coord(0.0f, side);
+  std::uniform_real_distribution<float> width(64.0f, 256.0f);
+  for (size_t i = 0; i < opts.statics; ++i)
+    engine.Spawn<BenchStatic>(coord(rng), coord(rng), width(rng), 24.0f);
+  for (size_t i = 0; i < opts.dynamics; ++i)
+    engine.Spawn<BenchFalling>(coord(rng), coord(rng), side, side,
+                               (uint32_t)rng());
+
+  NetServer server(engine);
+  if (!server.Start(0))
+    return 1;
+  server.SetConditions(opts.conditions, opts.seed);
+  std::vector<EntityHandle> avatars(cfg::NET_MAX_CLIENTS);
+  server.SetClientCallback([&](int client, bool connected) {
+    if (connected) {
+      avatars[client] =
+          engine.Spawn<BenchAvatar>(coord(rng), 0.0f, &server, client, side)
+              ->GetHandle();
+    } else {
+      engine.Despawn(avatars[client]);
+    }
+  });
+
+  const NetAddress address = {.ip = NET_LOCALHOST, .port = server.GetPort()};
+  std::vector<std::unique_ptr<NetClient>> clients;
+  std::vector<uint32_t> buttons(opts.clients, 0);
+  for (int i = 0; i < opts.clients; ++i) {
+    clients.push_back(std::make_unique<NetClient>());
+    clients.back()->SetConditions(opts.conditions, opts.seed * 977u + i + 1);
+    if (!clients.back()->Connect(address, SDL_GetTicksNS()))
+      return 1;
+  }
+
+  std::vector<NetInterpolatedState> view;
+  std::vector<double> netMs, snapshotMs, stepMs;
+  const Uint64 tickNS = SDL_NS_PER_SECOND / engine.GetTickRate();
+  auto tick = [&](int t, bool measure) {
+    const Uint64 now = SDL_GetTicksNS();
+    for (int i = 0; i < opts.clients; ++i) {
+      NetClient &c = *clients[i];
+      c.ReceivePackets(now);
+      if (rng() % 30 == 0)
+        buttons[i] = rng() % 8;
+      c.SendInput((uint32_t)t, buttons[i], now);
+      c.Interpolate(now, view);
+    }
+
+    const Uint64 t0 = SDL_GetTicksNS();
+    server.ReceivePackets(t0);
+    const Uint64 t1 = SDL_GetTicksNS();
+    engine.Step();
+    const Uint64 t2 = SDL_GetTicksNS();
+    const bool sends = (server.GetTick() + 1) % cfg::NET_SNAPSHOT_INTERVAL == 0;
+    server.SendSnapshots(t2);
+    const Uint64 t3 = SDL_GetTicksNS();
+    if (measure) {
+      netMs.push_back((double)((t1 - t0) + (t3 - t2)) / SDL_NS_PER_MS);
+      stepMs.push_back((double)(t2 - t1) / SDL_NS_PER_MS);
+      if (sends)
+        snapshotMs.push_back((double)(t3 - t2) / SDL_NS_PER_MS);
+    }
+  };
+
+  // Connect everyone (retries cover lost handshakes), then let the
+  // interpolation buffers fill before measuring.
+  Uint64 next = SDL_GetTicksNS();
+  int t = 0;
+  const int connectLimit = engine.GetTickRate() * 10;
+  while (server.GetClientCount() < opts.clients && t < connectLimit) {
+    tick(t++, false);
+    next += tickNS;
+    SDL_DelayPrecise(next > SDL_GetTicksNS() ? next - SDL_GetTicksNS() : 0);
+  }
+  if (server.GetClientCount() < opts.clients) {
+    fprintf(stderr, "only %d of %d clients connected\n",
+            server.GetClientCount(), opts.clients);
+    return 1;
+  }
+  for (int i = 0; i < engine.GetTickRate(); ++i) {
+    tick(t++, false);
+    next += tickNS;
+    SDL_DelayPrecise(next > SDL_GetTicksNS() ? next - SDL_GetTicksNS() : 0);
+  }
+
+  std::vector<NetTrafficStats> before(opts.clients);
+  std::vector<NetTrafficStats> clientBefore(opts.clients);
+  std::vector<uint64_t> starvedBefore(opts.clients);
+  for (int i = 0; i < opts.clients; ++i) {
+    before[i] = server.GetStats(i);
+    clientBefore[i] = clients[i]->GetStats();
+    starvedBefore[i] = clients[i]->GetStarvedFrames();
+  }
+  const Uint64 runStart = SDL_GetTicksNS();
+  for (int i = 0; i < opts.ticks; ++i) {
+    tick(t++, true);
+    next += tickNS;
+    SDL_DelayPrecise(next > SDL_GetTicksNS() ? next - SDL_GetTicksNS() : 0);
+  }
+  const double seconds =
+      (double)(SDL_GetTicksNS() - runStart) / SDL_NS_PER_SECOND;
+
+  // Per client, over the measured ticks.
+  std::vector<double> down, downHeaders, up, snapshotBytes, fullShare,
+      delivered, starved;
+  uint64_t undecodable = 0;
+  for (int i = 0; i < opts.clients; ++i) {
+    const NetTrafficStats &s = server.GetStats(i);
+    const NetTrafficStats &c = clients[i]->GetStats();
+    const double sent = (double)(s.bytesSent - before[i].bytesSent);
+    const double packets = (double)(s.packetsSent - before[i].packetsSent);
+    const double snapshots = (double)(s.snapshots - before[i].snapshots);
+    down.push_back(sent / seconds);
+    downHeaders.push_back((sent + 28.0 * packets) / seconds);
+    up.push_back((double)(c.bytesSent - clientBefore[i].bytesSent) / seconds);
+    snapshotBytes.push_back(snapshots > 0 ? sent / snapshots : 0.0);
+    fullShare.push_back(
+        snapshots > 0
+            ? (double)(s.fullSnapshots - before[i].fullSnapshots) / snapshots
+            : 0.0);
+    delivered.push_back(
+        snapshots > 0
+            ? (double)(c.snapshots - clientBefore[i].snapshots) / snapshots
+            : 0.0);
+    starved.push_back((double)(clients[i]->GetStarvedFrames() -
+                               starvedBefore[i]) /
+                      opts.ticks);
+    undecodable += c.undecodable - clientBefore[i].undecodable;
+  }
+
+  // What a full (baseline-free) snapshot of the final state costs, for
+  // comparison with the deltas.
+  std::vector<NetEntityState> states;
+  for (const Entity *e : engine.GetEntities())
+    states.push_back(CaptureNetState(e));
+  std::sort(states.begin(), states.end(),
+            [](const NetEntityState &a, const NetEntityState &b) {
+              return a.index < b.index;
+            });
+  std::vector<uint8_t> full;
+  NetWriter fullWriter(full);
+  EncodeSnapshot(server.GetTick(), 0, nullptr, states, fullWriter);
+
+  printf("{\n");
+  printf("  \"config\": {\"clients\": %d, \"statics\": %zu, "
+         "\"dynamics\": %zu, \"ticks\": %d, \"tick_rate\": %d, "
+         "\"snapshot_interval\": %d, \"loss_percent\": %.1f, "
+         "\"latency_ms\": %.1f, \"jitter_ms\": %.1f, \"threads\": %u, "
+         "\"settle\": %s},\n",
+         opts.clients, opts.statics, opts.dynamics, opts.ticks,
+         engine.GetTickRate(), cfg::NET_SNAPSHOT_INTERVAL,
+         opts.conditions.lossPercent, opts.conditions.latencyMs,
+         opts.conditions.jitterMs, engine.GetJobSystem()->GetThreadCount(),
+         opts.settle ? "true" : "false");
+  printf("  \"entities\": %zu,\n", states.size());
+  printf("  \"full_snapshot_bytes\": %zu,\n", full.size());
+  printf("  \"raw_state_bytes\": %zu,\n",
+         states.size() * sizeof(NetEntityState));
+  printf("  \"undecodable_snapshots\": %llu,\n",
+         (unsigned long long)undecodable);
+  printf("  \"per_client\": {\n");
+  PrintSummary("down_bytes_per_s", Summarize(down), true);
+  PrintSummary("down_bytes_per_s_with_headers", Summarize(downHeaders), true);
+  PrintSummary("up_bytes_per_s", Summarize(up), true);
+  PrintSummary("snapshot_bytes", Summarize(snapshotBytes), true);
+  PrintSummary("full_snapshot_share", Summarize(fullShare), true);
+  PrintSummary("snapshots_delivered", Summarize(delivered), true);
+  PrintSummary("starved_frame_share", Summarize(starved), false);
+  printf("  },\n");
+  printf("  \"server_ms\": {\n");
+  PrintSummary("net_per_tick", Summarize(netMs), true);
+  PrintSummary("snapshot_send", Summarize(snapshotMs), true);
+  PrintSummary("step", Summarize(stepMs), false);
+  printf("  }\n");
+  printf("}\n");
+
+  for (auto &c : clients)
+    c->Disconnect();
+  server.Stop();
+  engine.Shutdown();
+  return 0;
+}
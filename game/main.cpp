@@ -1,107 +1,110 @@
 #include "GameEngine.h"
 #include "main.h"
+#include <ctime>
 
 float Platform::lastSpawnTime = 0.0f;
 int Platform::platformCount = 0;
 
-bool Collectible::randomInitialized = false;
+PlayerClips Player::clips;
+uint16_t Collectible::coinClips[3] = {ANIMATION_NONE, ANIMATION_NONE,
+                                      ANIMATION_NONE};
 
 int main(int argc, char *argv[]) {
-  (void)argc;
-  (void)argv;
+  // --no-pak loads the loose BMPs even when the archive is present, to
+  // compare startup times. --trace N writes a profile trace after N frames.
+  // --pipeline double|triple simulates on its own thread while rendering.
+  bool usePak = true;
+  Uint64 traceFrame = 0;
+  FramePipeline pipeline = FramePipeline::SERIAL;
+  for (int i = 1; i < argc; ++i) {
+    if (SDL_strcmp(argv[i], "--no-pak") == 0)
+      usePak = false;
+    else if (SDL_strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+      traceFrame = SDL_strtoull(argv[++i], nullptr, 10);
+    else if (SDL_strcmp(argv[i], "--pipeline") == 0 && i + 1 < argc)
+      pipeline = SDL_strcmp(argv[++i], "triple") == 0
+                     ? FramePipeline::TRIPLE_BUFFERED
+                     : FramePipeline::DOUBLE_BUFFERED;
+  }
 
   GameEngine engine;
   if (!engine.Initialize("Game Engine", 1200, 800)) {
     return 1;
   }
   engine.GetRenderSystem()->SetScalingMode(ScalingMode::PROPORTIONAL);
+  engine.SetTraceFrame(traceFrame);
+  engine.SetFramePipeline(pipeline);
+  engine.SeedRandom((uint64_t)time(nullptr));
+
+  // Created from the mapped archive when it's mounted, otherwise decoded in
+  // parallel on the job threads and uploaded here. The animation system
+  // holds the animated sheets, the handle the tiles' texture, until the
+  // end of main.
+  const Uint64 loadStart = SDL_GetTicksNS();
+  const bool packed = usePak && engine.MountArchive(cfg::ASSET_ARCHIVE);
+  AnimationSystem *animation = engine.GetAnimation();
+  // Without clips every animated entity would draw its whole sheet. Load
+  // has logged why.
+  if (!animation->Load("media/animations.txt", *engine.GetResources())) {
+    engine.Shutdown();
+    return 1;
+  }
+  TextureHandle platformSheet = engine.GetResources()->Load(
+      "media/cartooncrypteque_platform_basicground_idle.bmp");
+  engine.GetResources()->Finish();
+  SDL_Log("Loaded %zu clips in %.2f ms from %s", animation->GetClipCount(),
+          (double)(SDL_GetTicksNS() - loadStart) / SDL_NS_PER_MS,
+          packed ? cfg::ASSET_ARCHIVE : "BMP files");
+  SDL_Texture *platformTexture = platformSheet.Get();
+
+  Player::clips = {.idle = animation->FindClip("player_idle"),
+                   .walkLeft = animation->FindClip("player_walk_left"),
+                   .walkRight = animation->FindClip("player_walk_right"),
+                   .jumpLeft = animation->FindClip("player_jump_left"),
+                   .jumpRight = animation->FindClip("player_jump_right")};
+  for (int type = 0; type < 3; ++type) {
+    const std::string name = "coin_" + std::to_string(type);
+    Collectible::coinClips[type] = animation->FindClip(name.c_str());
+  }
 
-  SDL_Texture *entityIdleTexture =
-      LoadTexture(engine.GetRenderer(), "media/Idle_KG_1.bmp");
-  SDL_Texture *entityJumpRightTexture =
-      LoadTexture(engine.GetRenderer(), "media/Jump_Right.bmp");
-  SDL_Texture *entityWalkRightTexture =
-      LoadTexture(engine.GetRenderer(), "media/Walking_Right.bmp");
-  SDL_Texture *entityJumpLeftTexture =
-      LoadTexture(engine.GetRenderer(), "media/Jump_Left.bmp");
-  SDL_Texture *entityWalkLeftTexture =
-      LoadTexture(engine.GetRenderer(), "media/Walking_Left.bmp");
-  SDL_Texture *coinsTexture =
-      LoadTexture(engine.GetRenderer(), "media/coins.bmp");
-
-  // Create entities
-  Player *player = new Player(
-      100, 100, entityIdleTexture, entityWalkLeftTexture,
-      entityWalkRightTexture, entityJumpLeftTexture, entityJumpRightTexture);
+  // Create entities; the engine owns them and frees them on Shutdown
+  Player *player = engine.Spawn<Player>(100, 100);
   player->hasPhysics = true; // Enable physics for Player
 
-  // Create platforms with random spawning
-  Platform *platform1 = new Platform(0, 725, 400, 75, true); // Ground platform
-  platform1->hasPhysics = false;                             // no integration
-  platform1->affectedByGravity = false;                      // no gravity
-  platform1->isStatic = true;
-
-  Platform *platform2 = new Platform(600, 500, 200, 75);
-  platform2->hasPhysics = false; 
-  platform2->affectedByGravity = false; 
-  platform2->isStatic = true; 
-
-  Platform *platform3 = new Platform(1000, 600, 300, 75);
-  platform3->hasPhysics = false; 
-  platform3->affectedByGravity = false; 
-  platform3->isStatic = true; 
-
-  Platform *platform4 = new Platform(1500, 390, 200, 75);
-  platform4->hasPhysics = false; 
-  platform4->affectedByGravity = false; 
-  platform4->isStatic = true; 
-
-  Platform *platform5 = new Platform(1900, 550, 100, 75);
-  platform5->hasPhysics = false; 
-  platform5->affectedByGravity = false; 
-  platform5->isStatic = true; 
-
-  Collectible *coin1 = new Collectible(300, 650, coinsTexture, 0); 
-  Collectible *coin2 = new Collectible(450, 650, coinsTexture, 1); 
-  Collectible *coin3 = new Collectible(600, 650, coinsTexture, 2); 
-  Collectible *coin4 = new Collectible(750, 600, coinsTexture, 0); 
-  Collectible *coin5 = new Collectible(900, 600, coinsTexture, 1); 
-  Collectible *coin6 = new Collectible(1100, 600, coinsTexture, 2); 
-  Collectible *coin7 = new Collectible(1300, 600, coinsTexture, 0); 
-  Collectible *coin8 = new Collectible(1600, 550, coinsTexture, 1);
-  Collectible *coin9 = new Collectible(1800, 500, coinsTexture, 2); 
-
-  engine.AddEntity(player);
-  engine.AddEntity(platform1);
-  engine.AddEntity(platform2);
-  engine.AddEntity(platform3);
-  engine.AddEntity(platform4);
-  engine.AddEntity(platform5);
-  
-  engine.AddEntity(coin1);
-  engine.AddEntity(coin2);
-  engine.AddEntity(coin3);
-  engine.AddEntity(coin4);
-  engine.AddEntity(coin5);
-  engine.AddEntity(coin6);
-  engine.AddEntity(coin7);
-  engine.AddEntity(coin8);
-  engine.AddEntity(coin9);
-
-  if (entityIdleTexture) {
-    player->SetTexture(entityIdleTexture);
+  // Level geometry: solid ground on the left and a one-way ledge above it,
+  // cut from the platform texture's left end, middle and right end.
+  constexpr float tileSize = 75.0f;
+  Tilemap *tiles = engine.CreateTilemap(
+      (uint32_t)SDL_ceilf(cfg::WORLD_WIDTH / tileSize),
+      (uint32_t)SDL_ceilf(cfg::WORLD_HEIGHT / tileSize), tileSize);
+  tiles->SetCollisionLayer(LAYER_WORLD);
+  uint16_t ground[3], ledge[3];
+  for (int piece = 0; piece < 3; ++piece) {
+    const SDL_FRect source = {256.0f * piece, 0.0f, 256.0f, 256.0f};
+    ground[piece] = tiles->AddTileType({platformTexture, source, TILE_SOLID});
+    ledge[piece] = tiles->AddTileType({platformTexture, source, TILE_ONE_WAY});
   }
-
-  SDL_Texture *platformTexture =
-      LoadTexture(engine.GetRenderer(),
-                  "media/cartooncrypteque_platform_basicground_idle.bmp");
-  if (platformTexture) {
-    platform1->SetTexture(platformTexture);
-    platform2->SetTexture(platformTexture);
-    platform3->SetTexture(platformTexture);
-    platform4->SetTexture(platformTexture);
-    platform5->SetTexture(platformTexture);
+  tiles->SetTile(0, 10, ground[0]);
+  tiles->Fill(1, 10, 4, 1, ground[1]);
+  tiles->SetTile(5, 10, ground[2]);
+  tiles->SetTile(2, 7, ledge[0]);
+  tiles->SetTile(3, 7, ledge[2]);
+
+  // Platforms and coins come from the compiled level, or from its text
+  // when it hasn't been compiled. The scene holds their textures.
+  engine.RegisterEntityType<Platform>("platform");
+  engine.RegisterEntityType<Collectible>("coin");
+  Scene level;
+  const char *levelSource = cfg::LEVEL_SCENE;
+  if (!level.Load(engine, cfg::LEVEL_SCENE)) {
+    levelSource = cfg::LEVEL_TEXT;
+    level.LoadText(engine, cfg::LEVEL_TEXT);
   }
+  SDL_Log("Created %zu level entities in %.2f ms from %s",
+          level.GetEntities().size(), level.GetLoadMs(), levelSource);
+
+  engine.SetCameraTarget(player,
+                         {0.0f, 0.0f, cfg::WORLD_WIDTH, cfg::WORLD_HEIGHT});
 
   engine.Run();
 
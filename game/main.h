@@ -1,10 +1,25 @@
 #pragma once
+#include "Config.h"
 #include "GameEngine.h"
 #include <algorithm>
-#include <ctime>
 #include <iostream>
 #include <vector>
 
+// Collision layers: platforms don't test against platforms, nor coins
+// against coins.
+enum GameLayers : uint32_t {
+  LAYER_WORLD = 1u << 0, // platforms and the tilemap
+  LAYER_PLAYER = 1u << 1,
+  LAYER_PICKUP = 1u << 2, // coins
+};
+
+// Type tags for EntityCast in collision callbacks.
+enum GameTypeTags : uint32_t {
+  TAG_PLATFORM = 1,
+  TAG_PLAYER,
+  TAG_COLLECTIBLE,
+};
+
 class Platform : public Entity {
   private:
     static float lastSpawnTime;
@@ -14,22 +29,29 @@ class Platform : public Entity {
     bool collidedWithPlayer = false;
 
   public:
-    Platform(float x, float y, float w = 200, float h = 20, bool isGround = false)
+    static constexpr uint32_t TypeTag = TAG_PLATFORM;
+
+    Platform(float x = 0, float y = 0, float w = 200, float h = 20,
+             bool isGround = false)
         : Entity(x, y, w, h) {
+      typeTag = TypeTag;
+      collisionLayer = LAYER_WORLD;
+      collisionMask = LAYER_PLAYER | LAYER_PICKUP;
       isStatic = true;
       hasPhysics = false;
       affectedByGravity = false;
+      updatePolicy = UpdatePolicy::MAIN_THREAD; // shared timer + Random()
+      layer = 0;
       velocity.x = isGround ? 0.0f : -100.0f;
       velocity.y = 0.0f;
       isGroundPlatform = isGround;
   
-      // Random spawn delay for variety (1-4 seconds)
-      spawnDelay = 1.0f + (rand() % 300) / 100.0f;
+      // Middle of the 1-4 second range; respawns draw it from Random()
+      spawnDelay = 2.5f;
   
       // Initialize static variables on first platform creation
       if (platformCount == 0) {
         lastSpawnTime = 0.0f;
-        srand(static_cast<unsigned int>(time(nullptr)));
       }
       platformCount++;
     }
@@ -51,78 +73,71 @@ class Platform : public Entity {
         }
       }
     }
+
+    void SaveState(StateWriter &out) const override {
+      out.Write(spawnDelay);
+      out.Write(isGroundPlatform);
+      out.Write(collidedWithPlayer);
+    }
+    void LoadState(StateReader &in) override {
+      in.Read(spawnDelay);
+      in.Read(isGroundPlatform);
+      in.Read(collidedWithPlayer);
+    }
   
   private:
     void RespawnWithRandomProperties() {
+      GameEngine *engine = GetEngine();
+
       // Random Y position (200-800 range)
-      position.y = 100.0f + (rand() % 500);
+      position.y = 100.0f + (engine->Random() % 500);
   
       // Random width (100-400 range)
-      dimensions.x = 100.0f + (rand() % 300);
+      dimensions.x = 100.0f + (engine->Random() % 300);
   
       // Random speed (-80 to -150)
-      velocity.x = -80.0f - (rand() % 70);
+      velocity.x = -80.0f - (engine->Random() % 70);
   
       // Spawn off-screen to the right
       position.x = 1200.0f;
   
       // Add some randomness to spawn timing
-      spawnDelay = 1.0f + (rand() % 300) / 100.0f;
+      spawnDelay = 1.0f + (engine->Random() % 300) / 100.0f;
     }
 };
 
 
+// Clip ids from media/animations.txt, looked up once it's loaded.
+struct PlayerClips {
+  uint16_t idle = ANIMATION_NONE;
+  uint16_t walkLeft = ANIMATION_NONE, walkRight = ANIMATION_NONE;
+  uint16_t jumpLeft = ANIMATION_NONE, jumpRight = ANIMATION_NONE;
+};
+
 class Player : public Entity {
 private:
-  int currentFrame;
-  Uint32 lastFrameTime;
-  int animationDelay;
-
   bool wasGrounded = false;
   bool wasMoving = false;
 
-  Entity *groundRef = nullptr; // platform we're standing on (if any)
-  float groundVX = 0.0f;
-
-  SDL_Texture *idleTex, *runLeftTex, *runRightTex, *jumpLeftTex,
-      *jumpRightTex; // platform's current x velocity
-  bool loopAnimation = true;
-  bool flipAnimation = false;
+  EntityHandle groundRef; // platform we're standing on (if any)
+  float groundVX = 0.0f; // platform's current x velocity
 
 public:
-  Player(float x, float y, SDL_Texture *idle, SDL_Texture *runLeft,
-             SDL_Texture *runRight, SDL_Texture *jumpLeft,
-             SDL_Texture *jumpRight)
-      : Entity(x, y, 176, 128) {
+  static constexpr uint32_t TypeTag = TAG_PLAYER;
+  static PlayerClips clips;
+
+  Player(float x = 0, float y = 0) : Entity(x, y, 176, 128) {
+    typeTag = TypeTag;
+    collisionLayer = LAYER_PLAYER;
+    collisionMask = LAYER_WORLD | LAYER_PICKUP;
     velocity.x = 0.0f; // Move right at 150 pixels per second
-    currentFrame = 0;
-    lastFrameTime = 0;
-    animationDelay = 200;
-
-    tex.num_frames_x = 4;
-    tex.num_frames_y = 0;
-    tex.frame_width = 100;
-    tex.frame_height = 64;
-    idleTex = idle;
-    runLeftTex = runLeft, runRightTex = runRight, jumpLeftTex = jumpLeft,
-    jumpRightTex = jumpRight;
+    updatePolicy = UpdatePolicy::MAIN_THREAD; // reads input and groundRef
+    layer = 2;
+    PlayAnimation(clips.idle);
   }
 
   void Update(float deltaTime, InputManager *input) override {
-    // Update animation
-    lastFrameTime += (Uint32)(deltaTime * 1000); // Convert to milliseconds
-    if (lastFrameTime >= (Uint32)animationDelay) {
-      if (flipAnimation) {
-        currentFrame = loopAnimation ? (currentFrame - 1 + tex.num_frames_x) %
-                                           tex.num_frames_x
-                                     : std::max(currentFrame - 1, 0);
-      } else {
-        currentFrame = loopAnimation ? (currentFrame + 1) % tex.num_frames_x
-                                     : std::min(currentFrame + 1,
-                                                (int)tex.num_frames_x - 1);
-      }
-      lastFrameTime = 0;
-    }
+    (void)deltaTime;
 
     // speeds
     constexpr float runSpeed = 200.0f;
@@ -133,21 +148,16 @@ public:
     const bool right = input->IsKeyPressed(SDL_SCANCODE_D) ||
                        input->IsKeyPressed(SDL_SCANCODE_RIGHT);
 
-    // carrier velocity (only meaningful when grounded on a platform)
-    const float carrierVX =
-        (grounded && groundRef) ? groundRef->velocity.x : 0.0f;
+    // carrier velocity (only meaningful when grounded on a platform); the
+    // handle resolves to nullptr if the platform has been removed
+    const Entity *ground = grounded ? GetEngine()->Resolve(groundRef) : nullptr;
+    const float carrierVX = ground ? ground->velocity.x : 0.0f;
 
     // base desired velocity from input (world-space)
     float desiredVX = 0.0f;
     if (left ^ right) { // exactly one is held
       if (grounded && !wasMoving) {
-        if (left) {
-          flipAnimation = true;
-          tex = {runLeftTex, 6, 0, 100, 64};
-        } else {
-          flipAnimation = false;
-          tex = {runRightTex, 6, 0, 100, 64};
-        }
+        PlayAnimation(left ? clips.walkLeft : clips.walkRight);
         wasMoving = true;
       }
       desiredVX = left ? -runSpeed : runSpeed;
@@ -166,118 +176,112 @@ public:
       velocity.y = -1500.0f;
       grounded = false;
       wasGrounded = false;
-      if (left) {
-        flipAnimation = true;
-        tex = {jumpLeftTex, 6, 0, 100, 64};
-      } else {
-        flipAnimation = false;
-        tex = {jumpRightTex, 6, 0, 100, 64};
-      }
+      PlayAnimation(left ? clips.jumpLeft : clips.jumpRight);
     }
 
-    // Bounce off screen edges (demonstrates entity system working) using window
-    // bounds push opposite direction
+    // Keep the player inside the world's horizontal extent
     if (position.x <= 0) {
       position.x = 0;
-    } else if (position.x + dimensions.x >= 1920) {
-      position.x = 1920 - dimensions.x;
+    } else if (position.x + dimensions.x >= cfg::WORLD_WIDTH) {
+      position.x = cfg::WORLD_WIDTH - dimensions.x;
     }
 
     // Reset if falls off bottom (demonstrates physics working)
     if (!grounded) { // however you detect “no ground this frame”
-      groundRef = nullptr;
+      groundRef = {};
       groundVX = 0.0f;
     }
-    if (position.y > 1080) { // fell off bottom of screen
+    if (position.y > cfg::WORLD_HEIGHT) { // fell off bottom of the world
       position.x = 100;
       position.y = 100;
       velocity.y = 0.0f;
       grounded = false;
-      groundRef = nullptr;
+      groundRef = {};
       groundVX = 0.0f;
     }
   }
 
   void OnCollision(Entity *other, CollisionData *collData) override {
-    if (dynamic_cast<Platform*>(other) && collData->normal.y == -1.0f && collData->normal.x == 0.0f) {
+    if (EntityCast<Platform>(other) && collData->normal.y == -1.0f && collData->normal.x == 0.0f) {
       if (!wasGrounded || !wasMoving) {
-        tex = {idleTex, 4, 0, 100, 64};
+        PlayAnimation(clips.idle);
         wasGrounded = true;
         wasMoving = false;
       }
       grounded = true;
       velocity.y = 0.0f;
-      groundRef = other;
-    } else if (dynamic_cast<Platform*>(other) && collData->normal.x != 0.0f) {
+      groundRef = other->GetHandle();
+    } else if (EntityCast<Platform>(other) && collData->normal.x != 0.0f) {
       velocity.x =
           0.0f;
     }
   }
 
-  // Get current frame for rendering
-  bool GetSourceRect(SDL_FRect &out) const override {
-    out = SampleTextureAt(currentFrame, 0);
-    return true;
+  // Velocity into the tile is already gone; only landing needs handling.
+  void OnTileCollision(uint16_t tile, CollisionData *collData) override {
+    (void)tile;
+    if (collData->normal.y == -1.0f) {
+      if (!wasGrounded || !wasMoving) {
+        PlayAnimation(clips.idle);
+        wasGrounded = true;
+        wasMoving = false;
+      }
+      groundRef = {};
+    }
+  }
+
+  // The animation is saved by the engine with the rest of the entity.
+  void SaveState(StateWriter &out) const override {
+    out.Write(wasGrounded);
+    out.Write(wasMoving);
+    out.Write(groundRef);
+    out.Write(groundVX);
+  }
+  void LoadState(StateReader &in) override {
+    in.Read(wasGrounded);
+    in.Read(wasMoving);
+    in.Read(groundRef);
+    in.Read(groundVX);
   }
 };
 
 class Collectible : public Entity {
 private:
-  int currentFrame;
-  Uint32 lastFrameTime;
-  int animationDelay;
   int coinType; // 0, 1, or 2 for different coin types (rows)
-  bool isCollected;
-  float respawnTimer;
-  float respawnDelay;
-  Entity* groundRef; // platform we're standing on (if any)
-  static bool randomInitialized;
+  bool isCollected; // despawn already requested
+  EntityHandle groundRef; // platform we're standing on (if any)
   bool collidedWithPlayer = true;
 
 public:
-  Collectible(float x, float y, SDL_Texture* coinTexture, int type = 0)
-      : Entity(x, y, 50, 50) {
-    currentFrame = 0;
-    lastFrameTime = 0;
-    animationDelay = 100; // Faster animation for coins
+  static constexpr uint32_t TypeTag = TAG_COLLECTIBLE;
+  static uint16_t coinClips[3]; // by coin type, from media/animations.txt
+
+  Collectible(float x = 0, float y = 0, int type = 0) : Entity(x, y, 50, 50) {
+    typeTag = TypeTag;
+    collisionLayer = LAYER_PICKUP;
+    collisionMask = LAYER_WORLD | LAYER_PLAYER;
     coinType = type;
     isCollected = false;
-    respawnTimer = 0.0f;
-    respawnDelay = 2.0f; // Respawn after 2 seconds
-    groundRef = nullptr;
-    
-    // Initialize random seed on first collectible creation
-    if (!randomInitialized) {
-      srand(static_cast<unsigned int>(time(nullptr)));
-      randomInitialized = true;
-    }
-    
-    // Set up texture properties for coins.bmp
-    tex.sheet = coinTexture;
-    tex.num_frames_x = 7; // 7 frames horizontally
-    tex.num_frames_y = 3; // 3 different coin types (rows)
-    tex.frame_width = 18;
-    tex.frame_height = 18;
-    
+    updatePolicy = UpdatePolicy::MAIN_THREAD; // Random() + groundRef
+    layer = 1;
+    PlayAnimation(coinClips[coinType]);
+
     // Enable physics and gravity for collectibles
     hasPhysics = true;
     affectedByGravity = true;
     isStatic = false;
   }
 
+  // Level data passes the coin type.
+  void OnCreated(uint32_t param) override {
+    coinType = (int)(param % 3);
+    PlayAnimation(coinClips[coinType], true);
+  }
+
   void Update(float deltaTime, InputManager* input) override {
+    (void)deltaTime;
     (void)input; 
     
-    // Handle respawn timer
-    if (isCollected) {
-      respawnTimer += deltaTime;
-      if (respawnTimer >= respawnDelay) {
-        RespawnAtRandomPosition();
-        respawnTimer = 0.0f;
-      }
-      return;
-    }
-    
     // Check if collectible fell below screen (assuming 800px height)
     if (position.y > 800) {
       RespawnAtRandomPosition();
@@ -285,78 +289,90 @@ public:
     }
     
     // Handle platform movement - inherit platform velocity when grounded
-    if (grounded && groundRef) {
-      velocity.x = groundRef->velocity.x; // Move with the platform
+    if (grounded) {
+      if (const Entity *ground = GetEngine()->Resolve(groundRef))
+        velocity.x = ground->velocity.x; // Move with the platform
     }
     
     // Reset grounded state each frame (will be set by collision if on platform)
     grounded = false;
-    groundRef = nullptr;
-    
-    // Update animation
-    lastFrameTime += (Uint32)(deltaTime * 1000); // Convert to milliseconds
-    if (lastFrameTime >= (Uint32)animationDelay) {
-      currentFrame = (currentFrame + 1) % tex.num_frames_x;
-      lastFrameTime = 0;
-    }
+    groundRef = {};
   }
 
   void OnCollision(Entity* other, CollisionData* collData) override {
-    // Check if colliding with Player (player)
-    if (dynamic_cast<Player*>(other) && !isCollected) {
+    // Collected by the player: this coin is removed at the end of the tick
+    // and a new one enters from the right
+    if (EntityCast<Player>(other) && !isCollected) {
       isCollected = true;
-      isVisible = false; 
-      respawnTimer = 0.0f; 
-      dimensions.x = 0.0f;
-      dimensions.y = 0.0f;
+      CommandBuffer &commands = GetEngine()->Commands();
+      commands.Destroy(GetHandle());
+
+      GameEngine *engine = GetEngine();
+      const float x = 1200.0f + (engine->Random() % 200);
+      const float y = 100.0f + (engine->Random() % 300);
+      const float speed = -50.0f - (engine->Random() % 100);
+      const int type = engine->Random() % 3;
+      commands.Defer([=](GameEngine &engine) {
+        engine.Spawn<Collectible>(x, y, type)->velocity.x = speed;
+      });
       return;
     }
     
     // Check if colliding with Platform from above (landing on top)
-    if (dynamic_cast<Platform*>(other) && collData && collData->normal.y == -1.0f) {
+    if (EntityCast<Platform>(other) && collData && collData->normal.y == -1.0f) {
       // Landing on top of platform - stop falling
       grounded = true;
       velocity.y = 0.0f;
-      groundRef = other; // Set reference to the platform we're standing on
+      groundRef = other->GetHandle(); // the platform we're standing on
       // Position the collectible on top of the platform
       position.y = other->position.y - dimensions.y;
     }
   }
 
-  // Get current frame for rendering
-  bool GetSourceRect(SDL_FRect& out) const override {
-    if (isCollected) return false;
-    
-    out = SampleTextureAt(currentFrame, coinType);
-    return true;
+  void OnTileCollision(uint16_t tile, CollisionData *collData) override {
+    (void)tile;
+    if (collData->normal.y == -1.0f) {
+      velocity.x = 0.0f; // the ground doesn't carry it
+      groundRef = {};
+    }
   }
-  
+
   bool IsCollected() const { return isCollected; }
   int GetCoinType() const { return coinType; }
 
+  void SaveState(StateWriter &out) const override {
+    out.Write(coinType);
+    out.Write(isCollected);
+    out.Write(groundRef);
+    out.Write(collidedWithPlayer);
+  }
+  void LoadState(StateReader &in) override {
+    in.Read(coinType);
+    in.Read(isCollected);
+    in.Read(groundRef);
+    in.Read(collidedWithPlayer);
+  }
+
 private:
   void RespawnAtRandomPosition() {
+    GameEngine *engine = GetEngine();
+
     // Random X position off-screen to the right (1200-1400 range)
-    position.x = 1200.0f + (rand() % 200);
+    position.x = 1200.0f + (engine->Random() % 200);
     
     // Random Y position (100-400 range)
-    position.y = 100.0f + (rand() % 300);
+    position.y = 100.0f + (engine->Random() % 300);
     
     // Reset velocity
-    velocity.x = -50.0f - (rand() % 100); // Move left at random speed
+    velocity.x = -50.0f - (engine->Random() % 100); // Move left at random speed
     velocity.y = 0.0f;
     
     // Reset platform reference
-    groundRef = nullptr;
+    groundRef = {};
     grounded = false;
     
-    // Make visible again
-    isCollected = false;
-    isVisible = true;
-    dimensions.x = 50.0f;
-    dimensions.y = 50.0f;
-    
     // Randomize coin type for variety
-    coinType = rand() % 3;
+    coinType = engine->Random() % 3;
+    PlayAnimation(coinClips[coinType], true);
   }
 };
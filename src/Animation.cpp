@@ -0,0 +1,216 @@
+#include "Animation.h"
+#include "Config.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+std::vector<std::string> SplitWords(const std::string &line) {
+  std::vector<std::string> words;
+  size_t i = 0;
+  while (i < line.size()) {
+    while (i < line.size() && SDL_isspace((unsigned char)line[i]))
+      ++i;
+    const size_t start = i;
+    while (i < line.size() && !SDL_isspace((unsigned char)line[i]))
+      ++i;
+    if (i > start)
+      words.push_back(line.substr(start, i - start));
+  }
+  return words;
+}
+
+bool ParseNumber(const std::string &word, float &out) {
+  char *end = nullptr;
+  out = std::strtof(word.c_str(), &end);
+  return end && *end == '\0' && std::isfinite(out);
+}
+
+bool ParseCount(const std::string &word, uint32_t &out) {
+  char *end = nullptr;
+  const unsigned long value = std::strtoul(word.c_str(), &end, 10);
+  out = (uint32_t)value;
+  return end && *end == '\0' && word[0] != '-' && value <= UINT16_MAX;
+}
+} // namespace
+
+bool AnimationSystem::Load(const char *path, ResourceManager &resources) {
+  size_t size = 0;
+  void *data = SDL_LoadFile(path, &size);
+  if (!data) {
+    SDL_Log("Failed to read %s: %s", path, SDL_GetError());
+    return false;
+  }
+  const std::string text((const char *)data, size);
+  SDL_free(data);
+  return Parse(text, resources, path);
+}
+
+bool AnimationSystem::Parse(const std::string &text,
+                            ResourceManager &resources, const char *source) {
+  // Built on the side, so a bad line leaves the system as it was.
+  std::vector<SpriteSheet> newSheets;
+  std::vector<AnimationClip> newClips;
+  std::vector<SDL_FRect> newFrames;
+  auto findSheet = [&](const std::string &name) -> int {
+    for (size_t i = 0; i < sheets.size(); ++i)
+      if (sheets[i].name == name)
+        return (int)i;
+    for (size_t i = 0; i < newSheets.size(); ++i)
+      if (newSheets[i].name == name)
+        return (int)(sheets.size() + i);
+    return -1;
+  };
+  auto sheetAt = [&](int index) -> const SpriteSheet & {
+    return index < (int)sheets.size() ? sheets[index]
+                                      : newSheets[index - sheets.size()];
+  };
+  auto clipExists = [&](const std::string &name) {
+    auto named = [&](const AnimationClip &c) { return c.name == name; };
+    return std::any_of(clips.begin(), clips.end(), named) ||
+           std::any_of(newClips.begin(), newClips.end(), named);
+  };
+
+  size_t lineStart = 0;
+  int lineNumber = 0;
+  while (lineStart < text.size()) {
+    size_t lineEnd = text.find('\n', lineStart);
+    if (lineEnd == std::string::npos)
+      lineEnd = text.size();
+    const std::vector<std::string> words =
+        SplitWords(text.substr(lineStart, lineEnd - lineStart));
+    lineStart = lineEnd + 1;
+    ++lineNumber;
+    if (words.empty() || words[0][0] == '#')
+      continue;
+
+    bool ok = false;
+    if (words[0] == "sheet" && words.size() == 5) {
+      SpriteSheet sheet;
+      sheet.name = words[1];
+      sheet.path = words[2];
+      ok = findSheet(sheet.name) < 0 &&
+           ParseNumber(words[3], sheet.frameWidth) &&
+           ParseNumber(words[4], sheet.frameHeight) &&
+           sheet.frameWidth > 0.0f && sheet.frameHeight > 0.0f;
+      if (ok)
+        newSheets.push_back(std::move(sheet));
+    } else if (words[0] == "clip" && words.size() >= 7) {
+      const int sheet = findSheet(words[2]);
+      uint32_t row = 0, column = 0, count = 0;
+      float frameMs = 0.0f;
+      AnimationClip clip{};
+      clip.name = words[1];
+      ok = sheet >= 0 && !clipExists(clip.name) &&
+           ParseCount(words[3], row) && ParseCount(words[4], column) &&
+           ParseCount(words[5], count) && ParseNumber(words[6], frameMs) &&
+           count > 0 && frameMs > 0.0f;
+      for (size_t w = 7; ok && w < words.size(); ++w) {
+        if (words[w] == "loop")
+          clip.flags |= CLIP_LOOP;
+        else if (words[w] == "reverse")
+          clip.flags |= CLIP_REVERSE;
+        else
+          ok = false;
+      }
+      if (ok) {
+        const SpriteSheet &s = sheetAt(sheet);
+        clip.sheet = (uint32_t)sheet;
+        clip.firstFrame = (uint32_t)(frames.size() + newFrames.size());
+        clip.frameCount = count;
+        clip.frameTime = frameMs / 1000.0f;
+        for (uint32_t i = 0; i < count; ++i) {
+          const uint32_t c =
+              column + ((clip.flags & CLIP_REVERSE) ? count - 1 - i : i);
+          newFrames.push_back({(float)c * s.frameWidth,
+                               (float)row * s.frameHeight, s.frameWidth,
+                               s.frameHeight});
+        }
+        newClips.push_back(std::move(clip));
+      }
+    }
+    if (!ok) {
+      SDL_Log("%s:%d: bad or duplicate %s", source, lineNumber,
+              words[0].c_str());
+      return false;
+    }
+  }
+  if (clips.size() + newClips.size() > ANIMATION_NONE) {
+    SDL_Log("%s: more than %u clips", source, (unsigned)ANIMATION_NONE);
+    return false;
+  }
+
+  std::vector<std::string> paths;
+  for (const SpriteSheet &sheet : newSheets)
+    paths.push_back(sheet.path);
+  std::vector<TextureHandle> handles = resources.Preload(paths);
+  for (size_t i = 0; i < newSheets.size(); ++i) {
+    newSheets[i].handle = std::move(handles[i]);
+    newSheets[i].texture = newSheets[i].handle.Get(); // null if it failed
+  }
+
+  for (SpriteSheet &sheet : newSheets)
+    sheets.push_back(std::move(sheet));
+  for (AnimationClip &clip : newClips) {
+    clip.texture = sheets[clip.sheet].texture;
+    clips.push_back(std::move(clip));
+  }
+  frames.insert(frames.end(), newFrames.begin(), newFrames.end());
+  return true;
+}
+
+uint16_t AnimationSystem::FindClip(const char *name) const {
+  for (size_t i = 0; i < clips.size(); ++i)
+    if (clips[i].name == name)
+      return (uint16_t)i;
+  return ANIMATION_NONE;
+}
+
+void AnimationSystem::Resolve(const AnimationClip &clip,
+                              const AnimationState &state,
+                              Texture &out) const {
+  const uint32_t frame = std::min(clip.frameCount - 1,
+                                  (uint32_t)(state.time / clip.frameTime));
+  out.sheet = clip.texture;
+  out.source = frames[clip.firstFrame + frame];
+}
+
+void AnimationSystem::Advance(std::vector<Entity *> &entities,
+                              float deltaTime, JobSystem *jobs) const {
+  PROFILE_SCOPE("Animate");
+  auto advanceRange = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      Entity *entity = entities[i];
+      AnimationState &state = entity->animation;
+      if (state.clip >= clips.size())
+        continue;
+      const AnimationClip &clip = clips[state.clip];
+      if (state.flags & ANIMATION_STARTED) {
+        state.flags &= (uint16_t)~ANIMATION_STARTED;
+      } else if (!(state.flags & (ANIMATION_PAUSED | ANIMATION_FINISHED))) {
+        state.time += deltaTime;
+        const float length = clip.frameTime * (float)clip.frameCount;
+        if (state.time >= length) {
+          if (clip.flags & CLIP_LOOP) {
+            state.time = std::fmod(state.time, length);
+          } else {
+            state.time = length;
+            state.flags |= ANIMATION_FINISHED;
+          }
+        }
+      }
+      Resolve(clip, state, entity->tex);
+    }
+  };
+  if (jobs) {
+    jobs->ParallelFor(entities.size(), cfg::ANIMATION_CHUNK, advanceRange);
+  } else {
+    advanceRange(0, entities.size());
+  }
+}
+
+void AnimationSystem::Apply(Entity *entity) const {
+  if (entity->animation.clip < clips.size())
+    Resolve(clips[entity->animation.clip], entity->animation, entity->tex);
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include "Entity.h"
+#include "JobSystem.h"
+#include "ResourceManager.h"
+#include <SDL3/SDL.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum AnimationClipFlags : uint32_t {
+  CLIP_LOOP = 1u << 0,
+  CLIP_REVERSE = 1u << 1, // frames play right to left (mirrored sheets)
+};
+
+// A texture cut into a grid of equal frames.
+struct SpriteSheet {
+  std::string name;
+  std::string path;
+  TextureHandle handle; // keeps the texture loaded
+  SDL_Texture *texture = nullptr;
+  float frameWidth = 0.0f, frameHeight = 0.0f;
+};
+
+// Consecutive frames from one row of a sheet. Never changes once loaded;
+// entities refer to it by id (AnimationState::clip).
+struct AnimationClip {
+  std::string name;
+  uint32_t sheet;
+  SDL_Texture *texture; // the sheet's
+  uint32_t firstFrame;  // into the frame table, in play order
+  uint32_t frameCount;
+  float frameTime; // seconds per frame
+  uint32_t flags;  // AnimationClipFlags
+};
+
+// Shared clip descriptors, and the pass that plays them. Entities only hold
+// an AnimationState; once per tick Advance moves every playing one on and
+// writes its frame into tex, so rendering just reads tex.
+class AnimationSystem {
+private:
+  std::vector<SpriteSheet> sheets;
+  std::vector<AnimationClip> clips;
+  std::vector<SDL_FRect> frames; // every clip's source rects, in play order
+
+  void Resolve(const AnimationClip &clip, const AnimationState &state,
+               Texture &out) const;
+
+public:
+  // Reads sheets and clips from a text file, one per line:
+  //
+  //   sheet <name> <texture path> <frame width> <frame height>
+  //   clip <name> <sheet> <row> <first column> <frames> <ms per frame>
+  //        [loop] [reverse]
+  //
+  // Blank lines and lines starting with # are skipped. The sheets' textures
+  // are loaded through resources, in parallel, and are ready when this
+  // returns. Logs the line and returns false if one is malformed; nothing
+  // from that file is added then. Call before the first Step.
+  bool Load(const char *path, ResourceManager &resources);
+  // The same, from text already in memory; source names it in messages.
+  bool Parse(const std::string &text, ResourceManager &resources,
+             const char *source);
+
+  // ANIMATION_NONE if there's no such clip.
+  uint16_t FindClip(const char *name) const;
+  const AnimationClip *GetClip(uint16_t id) const {
+    return id < clips.size() ? &clips[id] : nullptr;
+  }
+  size_t GetClipCount() const { return clips.size(); }
+
+  // Moves every playing entity on by deltaTime and writes its frame into
+  // tex. Clips started this tick stay on their first frame. Each entity is
+  // only touched by its own range, so the pass runs on jobs if given.
+  void Advance(std::vector<Entity *> &entities, float deltaTime,
+               JobSystem *jobs = nullptr) const;
+  // Writes the entity's current frame without advancing it.
+  void Apply(Entity *entity) const;
+};
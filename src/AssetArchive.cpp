@@ -0,0 +1,77 @@
+#include "AssetArchive.h"
+
+bool AssetArchive::Open(const char *path) {
+  Close();
+  if (!file.Open(path))
+    return false;
+
+  const uint8_t *base = file.Data();
+  const size_t size = file.Size();
+  if (size < sizeof(PakHeader)) {
+    SDL_Log("%s: not an asset archive", path);
+    Close();
+    return false;
+  }
+  const PakHeader *header = (const PakHeader *)base;
+  if (header->magic != PAK_MAGIC || header->version != PAK_VERSION) {
+    SDL_Log("%s: unsupported archive (magic %08x, version %u)", path,
+            header->magic, header->version);
+    Close();
+    return false;
+  }
+  if ((size - sizeof(PakHeader)) / sizeof(PakEntry) < header->count) {
+    SDL_Log("%s: truncated index", path);
+    Close();
+    return false;
+  }
+
+  const PakEntry *index = (const PakEntry *)(base + sizeof(PakHeader));
+  for (uint32_t i = 0; i < header->count; ++i) {
+    const PakEntry &e = index[i];
+    if (e.offset > size || e.size > size - e.offset ||
+        (uint64_t)e.pitch * e.height > e.size ||
+        e.name[PAK_NAME_LENGTH - 1] != '\0') {
+      SDL_Log("%s: entry %u is out of bounds", path, i);
+      Close();
+      return false;
+    }
+    entries.emplace(e.name, &e);
+  }
+  return true;
+}
+
+void AssetArchive::Close() {
+  entries.clear();
+  file.Close();
+}
+
+const PakEntry *AssetArchive::Find(const std::string &name) const {
+  auto it = entries.find(name);
+  return it == entries.end() ? nullptr : it->second;
+}
+
+SDL_Texture *AssetArchive::CreateTexture(SDL_Renderer *renderer,
+                                         const std::string &name) const {
+  const PakEntry *e = Find(name);
+  if (!e)
+    return nullptr;
+
+  SDL_Texture *texture =
+      SDL_CreateTexture(renderer, (SDL_PixelFormat)e->format,
+                        SDL_TEXTUREACCESS_STATIC, (int)e->width, (int)e->height);
+  if (!texture) {
+    SDL_Log("Failed to create texture for %s: %s", name.c_str(),
+            SDL_GetError());
+    return nullptr;
+  }
+  if (!SDL_UpdateTexture(texture, nullptr, file.Data() + e->offset,
+                         (int)e->pitch)) {
+    SDL_Log("Failed to upload %s: %s", name.c_str(), SDL_GetError());
+    SDL_DestroyTexture(texture);
+    return nullptr;
+  }
+  SDL_SetTextureBlendMode(texture, (e->flags & PAK_BLEND)
+                                       ? SDL_BLENDMODE_BLEND
+                                       : SDL_BLENDMODE_NONE);
+  return texture;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "MappedFile.h"
+#include <SDL3/SDL.h>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+// On-disk layout of a .pak written by tools/asset_packer. All fields are
+// little-endian; pixel blobs start on PAK_ALIGN boundaries so they can be
+// handed to the renderer straight from the mapping.
+inline constexpr uint32_t PAK_MAGIC = 0x314b4150; // "PAK1"
+inline constexpr uint32_t PAK_VERSION = 1;
+inline constexpr uint32_t PAK_ALIGN = 64;
+inline constexpr uint32_t PAK_NAME_LENGTH = 112;
+
+enum PakFlags : uint32_t {
+  PAK_BLEND = 1 // source had alpha or a colour key
+};
+
+struct PakHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t count; // PakEntry records follow the header
+  uint32_t reserved;
+};
+
+struct PakEntry {
+  char name[PAK_NAME_LENGTH]; // path as passed to the packer, NUL-terminated
+  uint32_t format;            // SDL_PixelFormat
+  uint32_t flags;             // PakFlags
+  uint32_t width;
+  uint32_t height;
+  uint32_t pitch;
+  uint32_t reserved;
+  uint64_t offset; // from the start of the file
+  uint64_t size;
+};
+
+static_assert(sizeof(PakHeader) == 16, "PakHeader layout");
+static_assert(sizeof(PakEntry) == 152, "PakEntry layout");
+
+// Read-only view of a mapped .pak.
+class AssetArchive {
+private:
+  MappedFile file;
+  std::unordered_map<std::string, const PakEntry *> entries;
+
+public:
+  // Maps the archive and validates its index. Logs and returns false if
+  // the file is missing or malformed.
+  bool Open(const char *path);
+  void Close();
+  bool IsOpen() const { return file.IsOpen(); }
+
+  const PakEntry *Find(const std::string &name) const;
+  size_t Count() const { return entries.size(); }
+
+  // Creates a static texture whose pixels come straight from the mapping.
+  // Main thread only. Returns nullptr if name isn't in the archive.
+  SDL_Texture *CreateTexture(SDL_Renderer *renderer,
+                             const std::string &name) const;
+};
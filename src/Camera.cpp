@@ -0,0 +1,27 @@
+#include "Camera.h"
+#include <algorithm>
+
+Camera::Camera(float width, float height)
+    : position({.x = 0.0f, .y = 0.0f}), zoom(1.0f),
+      viewport({0.0f, 0.0f, width, height}) {}
+
+SDL_FRect Camera::GetViewBounds() const {
+  return {position.x, position.y, viewport.w / zoom, viewport.h / zoom};
+}
+
+vec2 Camera::WorldToViewport(vec2 p) const {
+  return add({.x = viewport.x, .y = viewport.y},
+             mul(zoom, sub(p, position)));
+}
+
+vec2 Camera::ViewportToWorld(vec2 p) const {
+  return add(position,
+             mul(1.0f / zoom, sub(p, {.x = viewport.x, .y = viewport.y})));
+}
+
+void Camera::CenterOn(vec2 target, const SDL_FRect &limits) {
+  const SDL_FRect view = GetViewBounds();
+  position = {.x = target.x - 0.5f * view.w, .y = target.y - 0.5f * view.h};
+  position.x = std::max(limits.x, std::min(position.x, limits.x + limits.w - view.w));
+  position.y = std::max(limits.y, std::min(position.y, limits.y + limits.h - view.h));
+}
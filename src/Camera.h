@@ -0,0 +1,25 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <vec2.h>
+
+// Maps world coordinates onto an area of the reference resolution. With the
+// defaults (origin at 0,0, zoom 1, viewport covering the reference size)
+// world and screen coordinates coincide.
+class Camera {
+public:
+  vec2 position;      // world point shown at the viewport's top-left corner
+  float zoom;         // screen pixels per world unit
+  SDL_FRect viewport; // where the view is drawn, in reference pixels
+
+  Camera(float width, float height);
+
+  // World-space rectangle currently visible through the viewport.
+  SDL_FRect GetViewBounds() const;
+
+  vec2 WorldToViewport(vec2 p) const;
+  vec2 ViewportToWorld(vec2 p) const;
+
+  // Centres the view on target, then clamps it so it stays inside limits
+  // (a limit smaller than the view pins the view to its top-left corner).
+  void CenterOn(vec2 target, const SDL_FRect &limits);
+};
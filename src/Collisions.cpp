@@ -1,7 +1,25 @@
 #include "Collisions.h"
+#include "Config.h"
+#include "Profiler.h"
 #include <SDL3/SDL.h>
 #include <vec2.h>
-// #include <algorithm>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+static uint64_t PairKey(uint32_t a, uint32_t b) {
+  return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+}
+
+static bool SameBounds(const SDL_FRect &a, const SDL_FRect &b) {
+  return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+}
+
+CollisionSystem::CollisionSystem()
+    : mode(BroadphaseMode::UNIFORM_GRID),
+      narrowphase(NarrowphaseMode::SEQUENTIAL),
+      staticGrid(cfg::COLLISION_CELL_SIZE),
+      dynamicGrid(cfg::COLLISION_CELL_SIZE) {}
 
 bool CollisionSystem::CheckCollision(const Entity *a, const Entity *b) const {
   SDL_FRect A = a->GetBounds();
@@ -14,88 +32,697 @@ bool CollisionSystem::CheckCollision(const SDL_FRect &a,
   return SDL_HasRectIntersectionFloat(&a, &b);
 }
 
+void CollisionSystem::SetCellSize(float size) {
+  staticGrid.SetCellSize(size);
+  dynamicGrid.SetCellSize(size);
+  staticProxies.clear();
+  freeProxies.clear();
+  indexValid = false;
+}
+
 void CollisionSystem::ProcessCollisions(std::vector<Entity *> &entities) {
-  for (auto &e : entities)
-    if (!e->isStatic)
+  PROFILE_SCOPE("Collisions");
+  // Sleeping bodies keep the contacts they fell asleep with.
+  for (uint32_t i = 0; i < (uint32_t)entities.size(); ++i) {
+    Entity *e = entities[i];
+    e->collisionIndex = i;
+    if (!e->isStatic && !e->sleeping)
       e->grounded = false;
+  }
 
-  const size_t n = entities.size();
-  for (size_t i = 0; i < n - 1; ++i) {
-    for (size_t j = i + 1; j < n; ++j) {
-      Entity *A = entities[i];
-      Entity *B = entities[j];
+  pairTests = 0;
+  tileTests = 0;
+  contacts.clear();
+  touching.clear();
+  indexValid = false;
+  if (tilemap)
+    WakeForTileEdits(entities);
+
+  if (entities.size() < 2) {
+    // Nothing to pair.
+  } else if (narrowphase == NarrowphaseMode::CONTACT_LIST) {
+    ProcessContactList(entities);
+  } else if (mode == BroadphaseMode::BRUTE_FORCE) {
+    ProcessBruteForce(entities);
+  } else {
+    ProcessGrid(entities);
+  }
 
-      SDL_FRect Ab = A->GetBounds();
-      SDL_FRect Bb = B->GetBounds();
-      if (!SDL_HasRectIntersectionFloat(&Ab, &Bb))
+  if (tilemap) {
+    PROFILE_SCOPE("Tiles");
+    const uint32_t layer = tilemap->GetCollisionLayer();
+    for (Entity *e : entities) {
+      if (e->isStatic || e->sleeping || !(e->collisionMask & layer))
         continue;
+      ResolveTiles(e);
+      // Keeps QueryRegion in step with the push; no pair is queued, as none
+      // comes after UINT64_MAX.
+      if (indexValid)
+        Reindex(entities, e->collisionIndex, UINT64_MAX);
+    }
+  }
+}
 
-      // Decide dynamic vs static priority
-      Entity *dyn = (A->isStatic && !B->isStatic) ? B : A;
-      Entity *stat = (A->isStatic && !B->isStatic) ? A : B;
+void CollisionSystem::WakeForTileEdits(std::vector<Entity *> &entities) {
+  tileEdits.clear();
+  tilemap->TakeEdits(tileEdits);
+  if (tileEdits.empty())
+    return;
+  // Sleepers sit in the static grid; without it, check them all.
+  if (mode == BroadphaseMode::UNIFORM_GRID) {
+    for (const SDL_FRect &region : tileEdits)
+      WakeSleepersNear(region, region);
+    return;
+  }
+  for (Entity *e : entities) {
+    if (!e->sleeping)
+      continue;
+    const SDL_FRect b = e->GetBounds();
+    const SDL_FRect grown = {b.x - 1.0f, b.y - 1.0f, b.w + 2.0f, b.h + 2.0f};
+    for (const SDL_FRect &region : tileEdits)
+      if (CheckCollision(grown, region))
+        e->Wake();
+  }
+}
 
-      // If both are dynamic or both static, just treat A as dyn, B as stat
-      if (A->isStatic == B->isStatic) {
-        dyn = A;
-        stat = B;
-      }
+void CollisionSystem::ResolveTiles(Entity *e) {
+  const float size = tilemap->GetTileSize();
+  SDL_FRect b = e->GetBounds();
+  const float right = b.x + b.w, bottom = b.y + b.h;
+  if (right <= 0.0f || bottom <= 0.0f)
+    return;
+  const uint32_t x0 = (uint32_t)std::max(0.0f, std::floor(b.x / size));
+  const uint32_t y0 = (uint32_t)std::max(0.0f, std::floor(b.y / size));
+  const uint32_t x1 = std::min<uint32_t>(
+      tilemap->GetWidth(), (uint32_t)std::min(std::ceil(right / size), 4e9f));
+  const uint32_t y1 = std::min<uint32_t>(
+      tilemap->GetHeight(), (uint32_t)std::min(std::ceil(bottom / size), 4e9f));
 
-      SDL_FRect Db = dyn->GetBounds();
-      SDL_FRect Sb = stat->GetBounds();
+  tileHits.clear();
+  for (uint32_t y = y0; y < y1; ++y) {
+    for (uint32_t x = x0; x < x1; ++x) {
+      ++tileTests;
+      if (!(tilemap->GetFlags(x, y) & (TILE_SOLID | TILE_ONE_WAY)))
+        continue;
+      const SDL_FRect t = tilemap->GetTileBounds(x, y);
+      const float w = std::min(right, t.x + t.w) - std::max(b.x, t.x);
+      const float h = std::min(bottom, t.y + t.h) - std::max(b.y, t.y);
+      if (w > 0.0f && h > 0.0f)
+        tileHits.push_back({x, y, w * h});
+    }
+  }
+  if (tileHits.empty())
+    return;
+  std::sort(tileHits.begin(), tileHits.end(),
+            [](const TileHit &l, const TileHit &r) {
+              if (l.overlap != r.overlap)
+                return l.overlap > r.overlap;
+              return l.y != r.y ? l.y < r.y : l.x < r.x;
+            });
 
-      SDL_FRect inter{};
-      SDL_GetRectIntersectionFloat(&Db, &Sb, &inter);
+  for (const TileHit &hit : tileHits) {
+    // Earlier pushes may have cleared this one.
+    b = e->GetBounds();
+    const SDL_FRect t = tilemap->GetTileBounds(hit.x, hit.y);
+    if (!SDL_HasRectIntersectionFloat(&b, &t))
+      continue;
+    const uint8_t flags = tilemap->GetFlags(hit.x, hit.y);
 
-      vec2 normals[4] = {
-          {1.0, 0.0},  // RIGHT
-          {-1.0, 0.0}, // LEFT
-          {0.0, 1.0},  // BOTTOM
-          {0.0, -1.0}  // TOP
+    vec2 normal{};
+    float penetration = 0.0f;
+    if (!(flags & TILE_SOLID)) {
+      // One-way: only from above, and only if the body started the tick
+      // there.
+      if (e->prevPosition.y + b.h > t.y + cfg::ONE_WAY_TOLERANCE)
+        continue;
+      normal = {.x = 0.0f, .y = -1.0f};
+      penetration = b.y + b.h - t.y;
+    } else {
+      // Faces shared with a solid neighbour can't be pushed through.
+      // Coordinates off the map wrap to huge values, which read as empty.
+      const struct {
+        bool open;
+        vec2 normal;
+        float penetration;
+      } faces[4] = {
+          {!(tilemap->GetFlags(hit.x, hit.y - 1) & TILE_SOLID),
+           {.x = 0.0f, .y = -1.0f}, b.y + b.h - t.y},
+          {!(tilemap->GetFlags(hit.x, hit.y + 1) & TILE_SOLID),
+           {.x = 0.0f, .y = 1.0f}, t.y + t.h - b.y},
+          {!(tilemap->GetFlags(hit.x - 1, hit.y) & TILE_SOLID),
+           {.x = -1.0f, .y = 0.0f}, b.x + b.w - t.x},
+          {!(tilemap->GetFlags(hit.x + 1, hit.y) & TILE_SOLID),
+           {.x = 1.0f, .y = 0.0f}, t.x + t.w - b.x},
       };
+      bool found = false;
+      for (const auto &face : faces) {
+        if (face.open && (!found || face.penetration < penetration)) {
+          found = true;
+          normal = face.normal;
+          penetration = face.penetration;
+        }
+      }
+      if (!found)
+        continue; // buried; the surrounding tiles push it out
+    }
+
+    e->position = add(e->position, mul(penetration, normal));
+    if (normal.y < 0.0f)
+      e->grounded = true;
+    const float into = dot(e->velocity, normal);
+    if (into < 0.0f)
+      e->velocity = sub(e->velocity, mul(into, normal));
+
+    SDL_FRect inter{};
+    SDL_GetRectIntersectionFloat(&b, &t, &inter);
+    CollisionData data = {
+        .point = {.x = inter.x + 0.5f * inter.w, .y = inter.y + 0.5f * inter.h},
+        .normal = normal};
+    e->OnTileCollision(tilemap->GetTile(hit.x, hit.y), &data);
+  }
+}
+
+void CollisionSystem::ProcessBruteForce(std::vector<Entity *> &entities) {
+  PROFILE_SCOPE("Narrowphase");
+  const size_t n = entities.size();
+  for (size_t i = 0; i < n - 1; ++i) {
+    for (size_t j = i + 1; j < n; ++j) {
+      if (ShouldTest(entities[i], entities[j]))
+        ResolvePair(entities[i], entities[j]);
+    }
+  }
+}
 
-      vec2 db_collision_normal, sb_collision_normal;
+// Resolves the same pairs as the brute-force loop, in its (i, j) order.
+// Pairs come from the grids; after a pair resolves, bodies that moved or
+// woke since they were indexed are re-indexed and any new neighbours later
+// in the order are queued. Those are the pair's two bodies, or every body
+// when either one is collisionMovesOthers.
+void CollisionSystem::ProcessGrid(std::vector<Entity *> &entities) {
+  BuildGridCandidates(entities);
 
-      float minimum_penetration = std::min(inter.w, inter.h);
+  PROFILE_SCOPE("Narrowphase");
+  latePairs.clear();
+  size_t next = 0;
+  bool hasLast = false;
+  uint64_t last = 0;
+  while (next < candidates.size() || !latePairs.empty()) {
+    uint64_t key;
+    if (!latePairs.empty() &&
+        (next == candidates.size() || latePairs.front() < candidates[next])) {
+      key = latePairs.front();
+      std::pop_heap(latePairs.begin(), latePairs.end(), std::greater<>());
+      latePairs.pop_back();
+    } else {
+      key = candidates[next++];
+    }
+    if (hasLast && key == last)
+      continue;
+    hasLast = true;
+    last = key;
+
+    const uint32_t i = (uint32_t)(key >> 32);
+    const uint32_t j = (uint32_t)(key & 0xffffffffu);
+    // Layers are re-checked in case a callback changed them mid-pass.
+    if (!ShouldTest(entities[i], entities[j]) ||
+        !ResolvePair(entities[i], entities[j]))
+      continue;
 
-      if (inter.w < inter.h) /** side collision */ {
-        if (Db.x < Sb.x) {
-          db_collision_normal = normals[1];
-        } else {
-          db_collision_normal = normals[0];
+    if (entities[i]->collisionMovesOthers ||
+        entities[j]->collisionMovesOthers) {
+      for (uint32_t k = 0; k < (uint32_t)entities.size(); ++k)
+        Reindex(entities, k, key);
+    } else {
+      Reindex(entities, i, key);
+      Reindex(entities, j, key);
+    }
+  }
+}
+
+// Three stages: pairs are tested in parallel against the state at the start
+// of the pass, producing contacts; contacts are sorted by pair; then they
+// are resolved and dispatched serially in that order. Nothing in the first
+// stage writes to entities, so the result doesn't depend on thread count.
+void CollisionSystem::ProcessContactList(std::vector<Entity *> &entities) {
+  const size_t n = entities.size();
+  const bool grid = mode == BroadphaseMode::UNIFORM_GRID;
+  if (grid)
+    BuildGridCandidates(entities);
+
+  // Grid: chunks of candidate pairs. Brute force: chunks of rows i, each
+  // testing every j > i.
+  const size_t work = grid ? candidates.size() : n - 1;
+  const size_t grain = grid ? cfg::CONTACT_CHUNK : cfg::CONTACT_CHUNK / 64 + 1;
+  const size_t chunks = (work + grain - 1) / grain;
+  if (chunkContacts.size() < chunks)
+    chunkContacts.resize(chunks);
+  chunkTests.assign(chunks, 0);
+
+  auto testChunk = [&](size_t chunk) {
+    PROFILE_SCOPE("ContactChunk");
+    std::vector<Contact> &out = chunkContacts[chunk];
+    out.clear();
+    const size_t begin = chunk * grain;
+    const size_t end = std::min(work, begin + grain);
+    size_t tests = 0;
+    Contact c;
+    for (size_t k = begin; k < end; ++k) {
+      if (grid) {
+        const uint32_t i = (uint32_t)(candidates[k] >> 32);
+        const uint32_t j = (uint32_t)(candidates[k] & 0xffffffffu);
+        ++tests;
+        if (ComputeContact(entities[i], entities[j], c)) {
+          c.a = i;
+          c.b = j;
+          out.push_back(c);
         }
-      } else /** top collision */ {
-        if (Db.y < Sb.y) {
-          dyn->grounded = true;
-          db_collision_normal = normals[3];
-        } else {
-          //stat->grounded = true;
-          db_collision_normal = normals[2];
+      } else {
+        for (size_t j = k + 1; j < n; ++j) {
+          if (!ShouldTest(entities[k], entities[j]))
+            continue;
+          ++tests;
+          if (ComputeContact(entities[k], entities[j], c)) {
+            c.a = (uint32_t)k;
+            c.b = (uint32_t)j;
+            out.push_back(c);
+          }
         }
       }
+    }
+    chunkTests[chunk] = tests;
+  };
 
-      sb_collision_normal = neg(db_collision_normal);
+  if (jobs) {
+    jobs->ParallelFor(chunks, 1, [&](size_t begin, size_t end) {
+      for (size_t chunk = begin; chunk < end; ++chunk)
+        testChunk(chunk);
+    });
+  } else {
+    for (size_t chunk = 0; chunk < chunks; ++chunk)
+      testChunk(chunk);
+  }
 
-      if (!dyn->isStatic && !stat->isStatic) {
-        stat->position = add(stat->position, mul(minimum_penetration * 0.5f,
-                                                 sb_collision_normal));
-        dyn->position = add(
-            dyn->position, mul(minimum_penetration * 0.5f, db_collision_normal));
+  PROFILE_SCOPE("ResolveContacts");
+  for (size_t chunk = 0; chunk < chunks; ++chunk) {
+    pairTests += chunkTests[chunk];
+    contacts.insert(contacts.end(), chunkContacts[chunk].begin(),
+                    chunkContacts[chunk].end());
+  }
+  std::sort(contacts.begin(), contacts.end(),
+            [](const Contact &x, const Contact &y) {
+              return PairKey(x.a, x.b) < PairKey(y.a, y.b);
+            });
+
+  for (const Contact &c : contacts)
+    ApplyContact(entities[c.a], entities[c.b], c);
+  // Keeps QueryRegion in step with the pushes; nothing is queued.
+  if (grid)
+    for (const Contact &c : contacts) {
+      Reindex(entities, c.a, UINT64_MAX);
+      Reindex(entities, c.b, UINT64_MAX);
+    }
+}
+
+void CollisionSystem::BuildGridCandidates(std::vector<Entity *> &entities) {
+  PROFILE_SCOPE("Broadphase");
+  ++frame;
+  const uint32_t n = (uint32_t)entities.size();
+  indexedBounds.resize(n);
+  proxyOfIndex.assign(n, UINT32_MAX);
+  dynamicGrid.Clear();
+
+  for (uint32_t i = 0; i < n; ++i)
+    IndexBody(entities[i], i);
+
+  // Proxies whose entity stopped being static leave the grid. (Removed
+  // entities' proxies are gone already; see RemoveProxy.)
+  SweepProxies();
+
+  // Pairs whose layers don't match never become candidates.
+  candidates.clear();
+  auto addCandidate = [&](uint32_t a, uint32_t b) {
+    if (ShouldTest(entities[a], entities[b]))
+      candidates.push_back(PairKey(a, b));
+  };
+  dynamicGrid.ForEachCell([&](uint64_t key, const std::vector<uint32_t> &items) {
+    for (size_t a = 0; a < items.size(); ++a)
+      for (size_t b = a + 1; b < items.size(); ++b)
+        addCandidate(items[a], items[b]);
+
+    if (const std::vector<uint32_t> *statics = staticGrid.GetCell(key))
+      for (uint32_t d : items)
+        for (uint32_t s : *statics)
+          addCandidate(d, staticProxies[s].entity->collisionIndex);
+  });
+  for (uint32_t id = 0; id < staticProxies.size(); ++id) {
+    const StaticProxy &proxy = staticProxies[id];
+    if (!proxy.live)
+      continue;
+    for (uint32_t other : proxy.neighbours)
+      if (id < other)
+        addCandidate(proxy.entity->collisionIndex,
+                     staticProxies[other].entity->collisionIndex);
+  }
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                   candidates.end());
+  indexValid = true;
+}
+
+void CollisionSystem::IndexBody(Entity *e, uint32_t index) {
+  e->collisionIndex = index;
+  indexedBounds[index] = e->GetBounds();
+  // Sleeping bodies sit in the static grid until they wake.
+  if (e->isStatic || e->sleeping) {
+    proxyOfIndex[index] = SyncStaticProxy(e, indexedBounds[index]);
+  } else {
+    dynamicGrid.Insert(index, indexedBounds[index]);
+  }
+}
+
+void CollisionSystem::AddToIndex(const std::vector<Entity *> &entities,
+                                 uint32_t index) {
+  if (!indexValid)
+    return;
+  indexedBounds.emplace_back();
+  proxyOfIndex.push_back(UINT32_MAX);
+  IndexBody(entities[index], index);
+}
+
+void CollisionSystem::RemoveFromIndex(const std::vector<Entity *> &entities,
+                                      uint32_t index) {
+  if (!indexValid)
+    return;
+  const uint32_t last = (uint32_t)entities.size() - 1;
+  if (proxyOfIndex[index] == UINT32_MAX)
+    dynamicGrid.Remove(index, indexedBounds[index]);
+  if (index != last) {
+    // Static proxies find their body through collisionIndex.
+    if (proxyOfIndex[last] == UINT32_MAX) {
+      dynamicGrid.Remove(last, indexedBounds[last]);
+      dynamicGrid.Insert(index, indexedBounds[last]);
+    }
+    indexedBounds[index] = indexedBounds[last];
+    proxyOfIndex[index] = proxyOfIndex[last];
+    entities[last]->collisionIndex = index;
+  }
+  indexedBounds.pop_back();
+  proxyOfIndex.pop_back();
+}
+
+bool CollisionSystem::QueryRegion(const SDL_FRect &region,
+                                  std::vector<uint32_t> &out) const {
+  if (!indexValid)
+    return false;
+  const size_t first = out.size();
+  dynamicGrid.Query(region, out);
+  const size_t statics = out.size();
+  staticGrid.Query(region, out);
+  for (size_t k = statics; k < out.size(); ++k)
+    out[k] = staticProxies[out[k]].entity->collisionIndex;
+  std::sort(out.begin() + first, out.end());
+  out.erase(std::unique(out.begin() + first, out.end()), out.end());
+  return true;
+}
+
+bool CollisionSystem::ResolvePair(Entity *A, Entity *B) {
+  ++pairTests;
+
+  Contact contact;
+  if (!ComputeContact(A, B, contact))
+    return false;
+  ApplyContact(A, B, contact);
+  return true;
+}
+
+bool CollisionSystem::ComputeContact(const Entity *A, const Entity *B,
+                                     Contact &out) const {
+  SDL_FRect Ab = A->GetBounds();
+  SDL_FRect Bb = B->GetBounds();
+  if (!SDL_HasRectIntersectionFloat(&Ab, &Bb))
+    return false;
+
+  // Decide dynamic vs static priority. If both are dynamic or both static,
+  // A is treated as dyn and B as stat.
+  out.dynIsA = !(A->isStatic && !B->isStatic);
+  const Entity *dyn = out.dynIsA ? A : B;
+  const Entity *stat = out.dynIsA ? B : A;
+
+  SDL_FRect Db = dyn->GetBounds();
+  SDL_FRect Sb = stat->GetBounds();
+
+  SDL_FRect inter{};
+  SDL_GetRectIntersectionFloat(&Db, &Sb, &inter);
+
+  vec2 normals[4] = {
+      {1.0, 0.0},  // RIGHT
+      {-1.0, 0.0}, // LEFT
+      {0.0, 1.0},  // BOTTOM
+      {0.0, -1.0}  // TOP
+  };
+
+  out.penetration = std::min(inter.w, inter.h);
+  out.landed = false;
+
+  if (stat->isOneWay) {
+    // Only stops what came down onto it from above.
+    if (dyn->prevPosition.y + dyn->dimensions.y >
+        stat->prevPosition.y + cfg::ONE_WAY_TOLERANCE)
+      return false;
+    out.landed = true;
+    out.normal = normals[3];
+    out.penetration = Db.y + Db.h - Sb.y;
+    out.point = {.x = inter.x + 0.5f * inter.w,
+                 .y = inter.y + 0.5f * inter.h};
+    return true;
+  }
+
+  if (inter.w < inter.h) /** side collision */ {
+    if (Db.x < Sb.x) {
+      out.normal = normals[1];
+    } else {
+      out.normal = normals[0];
+    }
+  } else /** top collision */ {
+    if (Db.y < Sb.y) {
+      out.landed = true;
+      out.normal = normals[3];
+    } else {
+      out.normal = normals[2];
+    }
+  }
+
+  out.point = {.x = inter.x + 0.5f * inter.w, .y = inter.y + 0.5f * inter.h};
+  return true;
+}
+
+void CollisionSystem::ApplyContact(Entity *A, Entity *B, const Contact &c) {
+  Entity *dyn = c.dynIsA ? A : B;
+  Entity *stat = c.dynIsA ? B : A;
+
+  if (c.landed)
+    dyn->grounded = true;
+
+  // Only pairs with an awake body get here, so a sleeper was hit.
+  if (dyn->sleeping)
+    dyn->Wake();
+  if (stat->sleeping)
+    stat->Wake();
+  if (!dyn->isStatic && !stat->isStatic)
+    touching.push_back(PairKey(dyn->collisionIndex, stat->collisionIndex));
+
+  vec2 db_collision_normal = c.normal;
+  vec2 sb_collision_normal = neg(db_collision_normal);
+  float minimum_penetration = c.penetration;
+
+  if (!dyn->isStatic && !stat->isStatic) {
+    stat->position = add(stat->position, mul(minimum_penetration * 0.5f,
+                                             sb_collision_normal));
+    dyn->position = add(
+        dyn->position, mul(minimum_penetration * 0.5f, db_collision_normal));
+  } else {
+    dyn->position =
+        add(dyn->position, mul(minimum_penetration, db_collision_normal));
+  }
+
+  CollisionData cd_dyn = {.point = c.point, .normal = db_collision_normal};
+
+  CollisionData cd_stat = {.point = c.point, .normal = sb_collision_normal};
+
+  dyn->OnCollision(stat, &cd_dyn);
+  stat->OnCollision(dyn, &cd_stat);
+}
+
+uint32_t CollisionSystem::SyncStaticProxy(Entity *e, const SDL_FRect &bounds,
+                                          bool wakeOnMove) {
+  uint32_t id = e->broadphaseProxy;
+  if (id < staticProxies.size() && staticProxies[id].live &&
+      staticProxies[id].entity == e) {
+    if (!SameBounds(staticProxies[id].bounds, bounds)) {
+      if (!wakeOnMove) {
+        // Restored, not moved.
+      } else if (e->sleeping) {
+        e->Wake(); // moved by something other than the simulation
       } else {
-        dyn->position =
-            add(dyn->position, mul(minimum_penetration, db_collision_normal));
+        WakeSleepersNear(staticProxies[id].bounds, bounds);
       }
+      if (staticGrid.SameCells(staticProxies[id].bounds, bounds)) {
+        staticProxies[id].bounds = bounds;
+      } else {
+        UnlinkProxy(id);
+        InsertProxy(id, bounds);
+      }
+    }
+  } else {
+    if (!freeProxies.empty()) {
+      id = freeProxies.back();
+      freeProxies.pop_back();
+    } else {
+      id = (uint32_t)staticProxies.size();
+      staticProxies.emplace_back();
+    }
+    staticProxies[id].entity = e;
+    staticProxies[id].live = true;
+    InsertProxy(id, bounds);
+    e->broadphaseProxy = id;
+  }
+  staticProxies[id].lastSeen = frame;
+  return id;
+}
 
-      vec2 collision_point = {.x = inter.x + 0.5f * inter.w,
-                              .y = inter.y + 0.5f * inter.h};
-
-      CollisionData cd_dyn = {.point = collision_point,
-                              .normal = db_collision_normal};
+void CollisionSystem::RemoveProxy(Entity *e) {
+  const uint32_t id = e->broadphaseProxy;
+  e->broadphaseProxy = UINT32_MAX;
+  if (id >= staticProxies.size() || !staticProxies[id].live ||
+      staticProxies[id].entity != e)
+    return;
+  UnlinkProxy(id);
+  staticProxies[id].live = false;
+  staticProxies[id].entity = nullptr;
+  freeProxies.push_back(id);
+}
 
-      CollisionData cd_stat = {.point = collision_point,
-                               .normal = sb_collision_normal};
+void CollisionSystem::RebuildStaticProxies(
+    const std::vector<Entity *> &entities) {
+  // Proxies of bodies that were resting before are kept, and only moved if
+  // their bounds differ; the sweep drops the rest.
+  ++frame;
+  for (Entity *e : entities) {
+    if (mode == BroadphaseMode::UNIFORM_GRID && (e->isStatic || e->sleeping))
+      SyncStaticProxy(e, e->GetBounds(), false);
+    else
+      e->broadphaseProxy = UINT32_MAX;
+  }
+  SweepProxies();
+  indexValid = false;
+}
 
-      dyn->OnCollision(stat, &cd_dyn);
-      stat->OnCollision(dyn, &cd_stat);
+void CollisionSystem::SweepProxies() {
+  for (uint32_t id = 0; id < staticProxies.size(); ++id) {
+    StaticProxy &proxy = staticProxies[id];
+    if (proxy.live && proxy.lastSeen != frame) {
+      UnlinkProxy(id);
+      proxy.live = false;
+      proxy.entity = nullptr;
+      freeProxies.push_back(id);
     }
   }
-}
\ No newline at end of file
+}
+
+void CollisionSystem::WakeSleepersNear(const SDL_FRect &from,
+                                       const SDL_FRect &to) {
+  // Resting contacts only touch edges, so look one pixel further.
+  const float left = std::min(from.x, to.x) - 1.0f;
+  const float top = std::min(from.y, to.y) - 1.0f;
+  const SDL_FRect swept = {
+      left, top, std::max(from.x + from.w, to.x + to.w) + 1.0f - left,
+      std::max(from.y + from.h, to.y + to.h) + 1.0f - top};
+  queryScratch.clear();
+  staticGrid.Query(swept, queryScratch);
+  for (uint32_t id : queryScratch) {
+    Entity *other = staticProxies[id].entity;
+    if (other->sleeping && CheckCollision(swept, staticProxies[id].bounds))
+      other->Wake();
+  }
+}
+
+void CollisionSystem::InsertProxy(uint32_t id, const SDL_FRect &bounds) {
+  queryScratch.clear();
+  staticGrid.Query(bounds, queryScratch);
+  std::sort(queryScratch.begin(), queryScratch.end());
+  queryScratch.erase(std::unique(queryScratch.begin(), queryScratch.end()),
+                     queryScratch.end());
+
+  StaticProxy &proxy = staticProxies[id];
+  proxy.bounds = bounds;
+  proxy.neighbours.assign(queryScratch.begin(), queryScratch.end());
+  for (uint32_t other : queryScratch)
+    staticProxies[other].neighbours.push_back(id);
+  staticGrid.Insert(id, bounds);
+}
+
+void CollisionSystem::UnlinkProxy(uint32_t id) {
+  StaticProxy &proxy = staticProxies[id];
+  for (uint32_t other : proxy.neighbours) {
+    std::vector<uint32_t> &list = staticProxies[other].neighbours;
+    list.erase(std::remove(list.begin(), list.end(), id), list.end());
+  }
+  proxy.neighbours.clear();
+  staticGrid.Remove(id, proxy.bounds);
+}
+
+void CollisionSystem::Reindex(std::vector<Entity *> &entities, uint32_t index,
+                              uint64_t current) {
+  Entity *e = entities[index];
+  const SDL_FRect bounds = e->GetBounds();
+  // Woken mid-pass (or no longer static): its pairs with resting bodies
+  // count from now on, and none of them were candidates.
+  const bool woke =
+      proxyOfIndex[index] != UINT32_MAX && !e->isStatic && !e->sleeping;
+  if (!woke && SameBounds(bounds, indexedBounds[index]))
+    return;
+
+  // Still in the same cells: every pair it can form is already queued.
+  if (!woke && dynamicGrid.SameCells(bounds, indexedBounds[index])) {
+    indexedBounds[index] = bounds;
+    if (proxyOfIndex[index] != UINT32_MAX)
+      staticProxies[proxyOfIndex[index]].bounds = bounds;
+    return;
+  }
+
+  if (woke) {
+    RemoveProxy(e);
+    proxyOfIndex[index] = UINT32_MAX;
+    dynamicGrid.Insert(index, bounds);
+  } else if (proxyOfIndex[index] != UINT32_MAX) {
+    UnlinkProxy(proxyOfIndex[index]);
+    InsertProxy(proxyOfIndex[index], bounds);
+  } else {
+    dynamicGrid.Remove(index, indexedBounds[index]);
+    dynamicGrid.Insert(index, bounds);
+  }
+  indexedBounds[index] = bounds;
+
+  queryScratch.clear();
+  dynamicGrid.Query(bounds, queryScratch);
+  for (uint32_t other : queryScratch)
+    if (other != index && ShouldTest(e, entities[other]))
+      PushLatePair(index, other, current);
+
+  queryScratch.clear();
+  staticGrid.Query(bounds, queryScratch);
+  for (uint32_t id : queryScratch) {
+    const uint32_t other = staticProxies[id].entity->collisionIndex;
+    if (other != index && ShouldTest(e, entities[other]))
+      PushLatePair(index, other, current);
+  }
+}
+
+void CollisionSystem::PushLatePair(uint32_t a, uint32_t b, uint64_t current) {
+  const uint64_t key = PairKey(a, b);
+  // Pairs at or before the current one were already visited this pass.
+  if (key <= current)
+    return;
+  latePairs.push_back(key);
+  std::push_heap(latePairs.begin(), latePairs.end(), std::greater<>());
+}
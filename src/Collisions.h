@@ -1,13 +1,191 @@
 #pragma once
 #include "Entity.h"
+#include "JobSystem.h"
+#include "SpatialGrid.h"
+#include "Tilemap.h"
+#include <cstdint>
 // #include <memory>
 #include <vector>
 
+enum class NarrowphaseMode {
+  SEQUENTIAL,  // Resolve each pair as soon as it is found (reference path)
+  CONTACT_LIST // Test pairs in parallel, then resolve contacts in pair order
+};
+
+// One overlapping pair, seen from the body that gets pushed ("dyn").
+struct Contact {
+  uint32_t a, b;     // entity indices, a < b
+  bool dynIsA;       // which of the two is pushed
+  bool landed;       // dyn came down on top of the other body
+  vec2 point;
+  vec2 normal;       // on dyn, pointing away from the other body
+  float penetration;
+};
+
+enum class BroadphaseMode {
+  BRUTE_FORCE, // Test every pair; kept as the reference for validation
+  UNIFORM_GRID // Only pairs sharing a grid cell reach the narrowphase
+};
+
 class CollisionSystem {
+private:
+  struct StaticProxy {
+    Entity *entity = nullptr;
+    SDL_FRect bounds{};
+    uint64_t lastSeen = 0;
+    bool live = false;
+    std::vector<uint32_t> neighbours; // static proxies sharing a cell
+  };
+
+  BroadphaseMode mode;
+  NarrowphaseMode narrowphase;
+  JobSystem *jobs = nullptr;
+  Tilemap *tilemap = nullptr;
+  uint64_t frame = 0;
+  size_t pairTests = 0;
+  size_t tileTests = 0;
+  bool indexValid = false; // grids match the entity list of the last pass
+
+  // Static bodies stay in their grid across frames and are only
+  // re-inserted when their bounds change.
+  SpatialGrid staticGrid;
+  std::vector<StaticProxy> staticProxies;
+  std::vector<uint32_t> freeProxies;
+
+  // Dynamic bodies are re-indexed every pass.
+  SpatialGrid dynamicGrid;
+
+  // Per-pass scratch, kept around to avoid reallocating every frame.
+  std::vector<SDL_FRect> indexedBounds;
+  std::vector<uint32_t> proxyOfIndex;
+  std::vector<uint64_t> candidates;
+  std::vector<uint64_t> latePairs; // min-heap of pairs found mid-pass
+  std::vector<uint32_t> queryScratch;
+  std::vector<Contact> contacts;
+  std::vector<uint64_t> touching; // non-static pairs in contact this pass
+  std::vector<std::vector<Contact>> chunkContacts;
+  std::vector<size_t> chunkTests;
+  struct TileHit {
+    uint32_t x, y;
+    float overlap; // area
+  };
+  std::vector<TileHit> tileHits;
+  std::vector<SDL_FRect> tileEdits;
+
 public:
+  CollisionSystem();
+
   bool CheckCollision(const Entity *a, const Entity *b) const;
   bool CheckCollision(const SDL_FRect &a, const SDL_FRect &b) const;
 
-  // Resolves penetration and sets grounded when landing on static bodies.
+  void SetBroadphaseMode(BroadphaseMode newMode) { mode = newMode; }
+  BroadphaseMode GetBroadphaseMode() const { return mode; }
+
+  void SetNarrowphaseMode(NarrowphaseMode newMode) { narrowphase = newMode; }
+  NarrowphaseMode GetNarrowphaseMode() const { return narrowphase; }
+  // Threads used for CONTACT_LIST pair testing; nullptr runs it inline.
+  void SetJobSystem(JobSystem *jobSystem) { jobs = jobSystem; }
+
+  // Changing the cell size drops the static grid; it is rebuilt next pass.
+  void SetCellSize(float size);
+  float GetCellSize() const { return staticGrid.GetCellSize(); }
+
+  // Solid and one-way tiles stop bodies whose collisionMask includes the
+  // map's collision layer, after the entity pairs are resolved; nullptr for
+  // none.
+  void SetTilemap(Tilemap *map) { tilemap = map; }
+  Tilemap *GetTilemap() const { return tilemap; }
+
+  // Narrowphase tests performed by the last ProcessCollisions call.
+  size_t GetPairTestCount() const { return pairTests; }
+  // Tiles looked up by the last ProcessCollisions call.
+  size_t GetTileTestCount() const { return tileTests; }
+  // Contacts resolved by the last CONTACT_LIST pass, in resolution order.
+  const std::vector<Contact> &GetContacts() const { return contacts; }
+  // Pairs of non-static bodies that touched in the last pass, as
+  // (lower index << 32 | higher index); feeds PhysicsSystem::UpdateSleep.
+  const std::vector<uint64_t> &GetTouchingPairs() const { return touching; }
+
+  // Resolves penetration and sets grounded when landing on static bodies
+  // or tiles. A body landing on an isOneWay one is only stopped if its
+  // bottom was at or above the other's top at the start of the tick.
   void ProcessCollisions(std::vector<Entity *> &entities);
+
+  // Layer/mask filter, applied before any intersection test.
+  static bool ShouldCollide(const Entity *a, const Entity *b) {
+    return (a->collisionLayer & b->collisionMask) &&
+           (b->collisionLayer & a->collisionMask);
+  }
+
+  // Narrowphase for one pair: pushes the bodies apart and fires
+  // OnCollision on both. Returns false if they don't intersect. Doesn't
+  // check layers; the passes do that before calling it.
+  bool ResolvePair(Entity *A, Entity *B);
+
+  // Appends the index (into the list passed to the last ProcessCollisions)
+  // of every body whose cells overlap region, sorted and without repeats.
+  // Returns false when there is no usable index: the last pass didn't use
+  // the grid, or InvalidateIndex was called since.
+  bool QueryRegion(const SDL_FRect &region, std::vector<uint32_t> &out) const;
+  // For entity list changes outside a pass that the calls below don't cover.
+  void InvalidateIndex() { indexValid = false; }
+  // Keeps the index usable when entities[index], the last entry, was just
+  // appended to the list passed to the last ProcessCollisions.
+  void AddToIndex(const std::vector<Entity *> &entities, uint32_t index);
+  // Same, for entities[index] about to be removed by moving the last entry
+  // into its place. Its static proxy stays until RemoveProxy.
+  void RemoveFromIndex(const std::vector<Entity *> &entities, uint32_t index);
+  // Takes a removed entity's static proxy out of the grid, so nothing
+  // reaches the entity through it. Call before the entity is destroyed.
+  void RemoveProxy(Entity *e);
+  // Puts every static and sleeping body's proxy at its current bounds, as
+  // if the last pass had ended there. For when the whole simulation state
+  // was replaced (snapshot restore): the next pass then only reacts to
+  // movement after the restore, and doesn't wake anything for the jump
+  // itself. Proxies of bodies that didn't change are left alone.
+  void RebuildStaticProxies(const std::vector<Entity *> &entities);
+
+private:
+  // ShouldCollide, minus pairs where nothing can move: a sleeping body
+  // against a static or sleeping one. Static pairs are still resolved.
+  static bool ShouldTest(const Entity *a, const Entity *b) {
+    const bool aResting = a->isStatic || a->sleeping;
+    const bool bResting = b->isStatic || b->sleeping;
+    if (aResting && bResting && (a->sleeping || b->sleeping))
+      return false;
+    return ShouldCollide(a, b);
+  }
+  // Wakes sleeping bodies next to a static one that moved from `from` to
+  // `to`.
+  void WakeSleepersNear(const SDL_FRect &from, const SDL_FRect &to);
+
+  void ProcessBruteForce(std::vector<Entity *> &entities);
+  void ProcessGrid(std::vector<Entity *> &entities);
+  void ProcessContactList(std::vector<Entity *> &entities);
+  void BuildGridCandidates(std::vector<Entity *> &entities);
+  // Sleepers where the tilemap was edited since the last pass wake up.
+  void WakeForTileEdits(std::vector<Entity *> &entities);
+  // Pushes e out of the tiles it overlaps, deepest first, through faces
+  // that aren't shared with another solid tile (so bodies slide along
+  // floors and walls without catching on the seams).
+  void ResolveTiles(Entity *e);
+
+  // Read-only half of ResolvePair; safe to call from several threads.
+  bool ComputeContact(const Entity *A, const Entity *B, Contact &out) const;
+  void ApplyContact(Entity *A, Entity *B, const Contact &contact);
+
+  // Puts entities[index] in the grid its state calls for.
+  void IndexBody(Entity *e, uint32_t index);
+  // Keeps e's proxy at bounds, creating it if needed. A static body that
+  // moved wakes its sleeping neighbours, a sleeper that moved wakes up;
+  // unless wakeOnMove is false.
+  uint32_t SyncStaticProxy(Entity *e, const SDL_FRect &bounds,
+                           bool wakeOnMove = true);
+  // Drops the proxies the last sync didn't reach.
+  void SweepProxies();
+  void InsertProxy(uint32_t id, const SDL_FRect &bounds);
+  void UnlinkProxy(uint32_t id);
+  void Reindex(std::vector<Entity *> &entities, uint32_t index,
+               uint64_t current);
+  void PushLatePair(uint32_t a, uint32_t b, uint64_t current);
 };
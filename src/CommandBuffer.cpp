@@ -0,0 +1,82 @@
+#include "CommandBuffer.h"
+#include "GameEngine.h"
+#include "Profiler.h"
+#include <algorithm>
+
+CommandBuffer::Header *CommandBuffer::Arena::Allocate(size_t size) {
+  if (blocks.empty() || offset + size > cfg::COMMAND_BLOCK_BYTES) {
+    if (!blocks.empty())
+      ++block;
+    if (block == blocks.size())
+      blocks.push_back(std::make_unique<Block>());
+    offset = 0;
+  }
+  Header *header = reinterpret_cast<Header *>(blocks[block]->bytes + offset);
+  offset += size;
+  return header;
+}
+
+void CommandBuffer::Arena::Append(Header *header) {
+  if (tail)
+    tail->next = header;
+  else
+    head = header;
+  tail = header;
+  ++count;
+}
+
+void CommandBuffer::Arena::Reset() {
+  block = 0;
+  offset = 0;
+  head = tail = nullptr;
+  count = 0;
+}
+
+void CommandBuffer::Discard() {
+  for (Arena *arena : {&recording, &applying}) {
+    for (Header *h = arena->head; h;) {
+      Header *next = h->next;
+      h->run(h + 1, nullptr);
+      h = next;
+    }
+    arena->Reset();
+  }
+}
+
+std::vector<CommandBuffer::Pending> &CommandBuffer::PendingScratch() {
+  static std::vector<Pending> pending;
+  return pending;
+}
+
+void CommandBuffer::Apply(std::vector<std::unique_ptr<CommandBuffer>> &buffers,
+                          GameEngine &engine) {
+  PROFILE_SCOPE("ApplyCommands");
+  std::vector<Pending> &pending = PendingScratch();
+  for (int round = 0; round < cfg::COMMAND_FLUSH_ROUNDS; ++round) {
+    // Swap first: anything recorded while these run lands in a fresh arena.
+    pending.clear();
+    for (uint32_t b = 0; b < (uint32_t)buffers.size(); ++b) {
+      CommandBuffer &buffer = *buffers[b];
+      std::swap(buffer.recording, buffer.applying);
+      uint32_t sequence = 0;
+      for (Header *h = buffer.applying.head; h; h = h->next)
+        pending.push_back({h->order, b, sequence++, h});
+      buffer.order = OrderKey(STAGE_EXTERNAL);
+    }
+    if (pending.empty())
+      break;
+
+    std::sort(pending.begin(), pending.end(),
+              [](const Pending &x, const Pending &y) {
+                if (x.order != y.order)
+                  return x.order < y.order;
+                if (x.buffer != y.buffer)
+                  return x.buffer < y.buffer;
+                return x.sequence < y.sequence;
+              });
+    for (const Pending &p : pending)
+      p.header->run(p.header + 1, &engine);
+    for (auto &buffer : buffers)
+      buffer->applying.Reset();
+  }
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include "Config.h"
+#include "Entity.h"
+#include "World.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class GameEngine;
+
+// Structural changes recorded while the engine is iterating its entities
+// (Update, OnCollision) and applied by GameEngine at the end of the tick.
+// There is one buffer per job thread, so recording needs no locks; records
+// live in reused fixed-size blocks, so a warmed-up buffer doesn't allocate.
+//
+// Each record carries an order key set by the engine (which stage and which
+// entity was running), and buffers are merged by it, so the apply order
+// doesn't depend on which thread happened to update which entity.
+class CommandBuffer {
+public:
+  // Sort keys for the stages of a tick; the low 32 bits are an entity index.
+  enum Stage : uint64_t {
+    STAGE_EXTERNAL = 0, // recorded outside a tick
+    STAGE_UPDATE = 1,   // parallel Update, by entity index
+    STAGE_UPDATE_MAIN = 2,
+    STAGE_COLLISIONS = 3,
+  };
+  static uint64_t OrderKey(Stage stage, uint32_t index = 0) {
+    return ((uint64_t)stage << 32) | index;
+  }
+
+  CommandBuffer() = default;
+  CommandBuffer(const CommandBuffer &) = delete;
+  CommandBuffer &operator=(const CommandBuffer &) = delete;
+  ~CommandBuffer() { Discard(); }
+
+  // GameEngine::Spawn<T>(args...) at the sync point. Arguments are copied.
+  template <typename T, typename... Args> void Spawn(Args &&...args) {
+    Defer([args = std::make_tuple(std::forward<Args>(args)...)](
+              auto &engine) mutable {
+      std::apply(
+          [&](auto &...a) { engine.template Spawn<T>(std::move(a)...); },
+          args);
+    });
+  }
+  // Removes the entity (destroying it if it's pooled); stale handles and
+  // repeated destroys are ignored.
+  void Destroy(EntityHandle handle) {
+    Defer([handle](auto &engine) { engine.Despawn(handle); });
+  }
+  // GameEngine::AddEntity for a caller-owned entity.
+  void Add(Entity *entity) {
+    Defer([entity](auto &engine) { engine.AddEntity(entity); });
+  }
+  // World::SetComponents; moves the row to another archetype.
+  void SetComponents(WorldEntity entity, uint32_t mask) {
+    Defer([entity, mask](auto &engine) {
+      engine.GetWorld()->SetComponents(entity, mask);
+    });
+  }
+  // Anything else: fn(GameEngine &) runs at the sync point.
+  template <typename Fn> void Defer(Fn &&fn) {
+    using Payload = std::decay_t<Fn>;
+    static_assert(alignof(Payload) <= alignof(std::max_align_t),
+                  "over-aligned command");
+    static_assert(RecordSize(sizeof(Payload)) <= cfg::COMMAND_BLOCK_BYTES,
+                  "command too large for a block");
+    Header *header = recording.Allocate(RecordSize(sizeof(Payload)));
+    new (header + 1) Payload(std::forward<Fn>(fn));
+    header->run = [](void *payload, GameEngine *engine) {
+      Payload *p = static_cast<Payload *>(payload);
+      if (engine)
+        (*p)(*engine);
+      p->~Payload();
+    };
+    header->order = order;
+    header->next = nullptr;
+    recording.Append(header);
+  }
+
+  void SetOrder(uint64_t key) { order = key; }
+  size_t Count() const { return recording.count; }
+  bool Empty() const { return recording.count == 0; }
+
+  // Applies everything recorded in buffers, merged by order key. Commands
+  // recorded while applying (by constructors or deferred functions) run in
+  // follow-up rounds, up to cfg::COMMAND_FLUSH_ROUNDS; the rest wait for the
+  // next call. Main thread only, with no jobs in flight.
+  static void Apply(std::vector<std::unique_ptr<CommandBuffer>> &buffers,
+                    GameEngine &engine);
+
+  // Destroys pending commands without running them.
+  void Discard();
+
+private:
+  struct alignas(std::max_align_t) Header {
+    Header *next;
+    void (*run)(void *payload, GameEngine *engine); // nullptr: just destroy
+    uint64_t order;
+  };
+
+  static constexpr size_t RecordSize(size_t payload) {
+    const size_t align = alignof(std::max_align_t);
+    return sizeof(Header) + (payload + align - 1) / align * align;
+  }
+
+  // Linked records in blocks that are kept and refilled after a Reset.
+  struct Arena {
+    struct alignas(std::max_align_t) Block {
+      unsigned char bytes[cfg::COMMAND_BLOCK_BYTES];
+    };
+    std::vector<std::unique_ptr<Block>> blocks;
+    size_t block = 0;  // block being filled
+    size_t offset = 0; // bytes used in it
+    Header *head = nullptr;
+    Header *tail = nullptr;
+    size_t count = 0;
+
+    Header *Allocate(size_t size);
+    void Append(Header *header);
+    void Reset();
+  };
+
+  // Records sorted for one Apply round, kept to avoid reallocating.
+  struct Pending {
+    uint64_t order;
+    uint32_t buffer;
+    uint32_t sequence;
+    Header *header;
+  };
+  static std::vector<Pending> &PendingScratch();
+
+  Arena recording;
+  Arena applying; // swapped in by Apply while its commands run
+  uint64_t order = 0;
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 namespace cfg {
@@ -8,6 +9,19 @@ namespace cfg {
 inline constexpr int    SCREEN_WIDTH          = 1920;
 inline constexpr int    SCREEN_HEIGHT         = 1080;
 inline constexpr int    TARGET_FPS            = 60;
+inline constexpr float  STATIC_CHUNK_SIZE     = 512.0f;    // cached static layer chunk, world units (1 px each)
+inline constexpr uint32_t TILE_CHUNK_TILES    = 32;        // tilemap chunk side, tiles (storage and geometry)
+
+// ------------ World ------------
+inline constexpr float  WORLD_WIDTH           = 1920.0f;   // playable area, world units
+inline constexpr float  WORLD_HEIGHT          = 1080.0f;
+
+// ------------ Timing ------------
+inline constexpr int    TICK_RATE             = 60;        // fixed simulation steps per second
+inline constexpr int    MAX_CATCHUP_TICKS     = 5;         // per frame, before dropping time
+inline constexpr double FRAME_SPIN_MS         = 1.0;       // busy-wait the last stretch of a frame
+inline constexpr double LATE_FRAME_MS         = 0.2;       // tolerance before a frame counts as late
+inline constexpr float  INTERPOLATION_SNAP    = 256.0f;    // pixels; larger jumps are teleports
 
 // Background clear color (SDL uses 0..255)
 inline constexpr uint8_t CLEAR_R              = 0;
@@ -15,8 +29,33 @@ inline constexpr uint8_t CLEAR_G              = 100;
 inline constexpr uint8_t CLEAR_B              = 200;
 inline constexpr uint8_t CLEAR_A              = 255;
 
+// ------------ Threading ------------
+inline constexpr unsigned JOB_THREADS         = 0;         // incl. main; 0 = one per hardware thread
+inline constexpr size_t   UPDATE_CHUNK        = 512;       // entities per parallel update job
+inline constexpr size_t   INTEGRATE_CHUNK     = 16384;     // world rows per integration job
+inline constexpr size_t   ANIMATION_CHUNK     = 4096;      // entities per parallel animation job
+inline constexpr size_t   COMMAND_BLOCK_BYTES = 16384;     // command buffer allocation unit
+inline constexpr int      COMMAND_FLUSH_ROUNDS = 4;        // cascades applied per sync point
+
 // ------------ Physics ------------
 inline constexpr float GRAVITY_Y              = 1200.0f;   // pixels/s^2 down (+Y)
+inline constexpr float SLEEP_VELOCITY         = 8.0f;      // pixels/s; slower counts as resting
+inline constexpr float SLEEP_TIME             = 0.5f;      // seconds an island rests before sleeping
+
+// ------------ Streaming ------------
+inline constexpr float  STREAM_LOAD_DISTANCE  = 2048.0f;   // regions this close to the focus load, world units
+inline constexpr float  STREAM_KEEP_DISTANCE  = 3072.0f;   // farther ones may be unloaded
+inline constexpr size_t STREAM_MEMORY_BUDGET  = 64u << 20; // resident region bytes before far regions unload
+inline constexpr size_t STREAM_SPAWNS_PER_FRAME = 4096;    // entities a region creates per frame boundary
+
+// ------------ Rollback ------------
+inline constexpr size_t STATE_RING_TICKS      = 16;        // snapshots kept by StateRing
+inline constexpr uint64_t RANDOM_SEED         = 0x2545f4914f6cdd1dull; // GameEngine::Random
+
+// ------------ Collision ------------
+inline constexpr float COLLISION_CELL_SIZE    = 128.0f;    // broadphase grid cell, pixels
+inline constexpr size_t CONTACT_CHUNK         = 2048;      // candidate pairs per narrowphase job
+inline constexpr float ONE_WAY_TOLERANCE      = 1.0f;      // pixels a body may have been below a one-way top
 
 // ------------ Player / Entities ------------
 inline constexpr float PLAYER_SPEED_X         = 350.0f;    // pixels/s
@@ -25,7 +64,29 @@ inline constexpr int   PLAYER_WIDTH           = 128;
 inline constexpr int   PLAYER_HEIGHT          = 128;
 inline constexpr float DEFAULT_ENTITY_W       = 32.0f;
 inline constexpr float DEFAULT_ENTITY_H       = 32.0f;
+inline constexpr size_t ENTITY_POOL_BLOCK     = 256;       // entities per pool allocation
+
+// ------------ Networking ------------
+inline constexpr uint16_t NET_DEFAULT_PORT    = 27960;
+inline constexpr int    NET_MAX_CLIENTS       = 64;
+inline constexpr int    NET_SNAPSHOT_INTERVAL = 2;         // ticks between snapshots (30 Hz at 60)
+inline constexpr int    NET_SNAPSHOT_HISTORY  = 64;        // snapshots kept as delta baselines
+inline constexpr size_t NET_MAX_PACKET        = 1200;      // datagram bytes, below typical MTU
+inline constexpr int    NET_MAX_FRAGMENTS     = 255;       // per snapshot
+inline constexpr int    NET_INPUT_REDUNDANCY  = 4;         // inputs repeated per packet
+inline constexpr float  NET_POSITION_SCALE    = 16.0f;     // quantization steps per pixel
+inline constexpr float  NET_INTERP_TICKS      = 6.0f;      // client render delay, ticks
+inline constexpr double NET_TIMEOUT_MS        = 3000.0;    // silence before a peer is dropped
+inline constexpr double NET_CONNECT_RETRY_MS  = 250.0;
+
+// ------------ Profiling ------------
+inline constexpr size_t   PROFILE_RING_EVENTS    = 1 << 15;  // markers kept per thread
+inline constexpr size_t   PROFILE_HISTORY_FRAMES = 240;      // window for min/avg/p99
+inline constexpr const char* PROFILE_TRACE_PATH  = "trace.json"; // F9 writes it
 
 // ------------ Paths (if you centralize assets) ------------
 inline constexpr const char* ASSETS_DIR       = "media/";
+inline constexpr const char* ASSET_ARCHIVE    = "media.pak"; // built by the pack_assets target
+inline constexpr const char* LEVEL_SCENE      = "level.scene"; // built by compile_scenes
+inline constexpr const char* LEVEL_TEXT       = "media/level.txt"; // its source
 } // namespace cfg
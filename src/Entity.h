@@ -1,21 +1,73 @@
 #pragma once
 #include <Input.h>
 #include <SDL3/SDL.h>
+#include <StateBuffer.h>
 #include <vec2.h>
 
+class GameEngine;
+
+// Names an entity registered with a GameEngine. Once the entity is removed
+// the handle resolves to nullptr, even after its slot is reused.
+typedef struct EntityHandle {
+  uint32_t index = UINT32_MAX;
+  uint32_t generation = 0;
+
+  bool operator==(const EntityHandle &) const = default;
+} EntityHandle;
+
+inline constexpr uint32_t ENTITY_TYPE_NONE = UINT32_MAX;
+
+// One entity for GameEngine::CreateEntities.
+struct EntityDesc {
+  uint32_t type; // from GameEngine::RegisterEntityType
+  vec2 position;
+  vec2 dimensions;      // 0 keeps the type's own size
+  SDL_Texture *texture; // nullptr keeps the type's own
+  uint32_t param;       // passed to Entity::OnCreated
+};
+
 typedef struct CollisionData {
   vec2 point;
   vec2 normal;
 } CollisionData;
 
+// Where an entity's Update may run. Entities that read or write anything
+// besides their own fields (input, other entities, statics, Random()) must
+// opt out with MAIN_THREAD; those run serially after the parallel pass.
+enum class UpdatePolicy {
+  PARALLEL,
+  MAIN_THREAD
+};
+
+// Collision filtering: two entities are tested only if each one's layer is
+// in the other's mask. Games define their own bits; by default everything
+// is on layer 0 and collides with everything.
+enum CollisionLayerBits : uint32_t {
+  COLLISION_LAYER_DEFAULT = 1u << 0,
+  COLLISION_MASK_ALL = 0xffffffffu,
+};
+
+// What an entity draws. Animated entities get both fields from their
+// clip (see AnimationSystem); others set them by hand.
 typedef struct Texture {
   SDL_Texture* sheet;
-  uint32_t num_frames_x;
-  uint32_t num_frames_y;
-  uint32_t frame_width;
-  uint32_t frame_height;
+  SDL_FRect source; // pixels; w < 0 means the whole texture
 } Texture;
 
+enum AnimationFlags : uint16_t {
+  ANIMATION_STARTED = 1u << 0,  // played this tick; advances from the next
+  ANIMATION_FINISHED = 1u << 1, // a clip that doesn't loop reached its end
+  ANIMATION_PAUSED = 1u << 2,
+};
+inline constexpr uint16_t ANIMATION_NONE = 0xffff;
+
+// Playback of an AnimationSystem clip; the clip itself is shared.
+typedef struct AnimationState {
+  uint16_t clip = ANIMATION_NONE;
+  uint16_t flags = 0; // AnimationFlags
+  float time = 0.0f;  // seconds since the clip started
+} AnimationState;
+
 
 class Entity {
 private:
@@ -23,14 +75,25 @@ private:
       0; // <-- inline variable: defined once program-wide
   int id;
 
+  // Set by GameEngine while the entity is registered with it.
+  friend class GameEngine;
+  GameEngine *engine = nullptr;
+  EntityHandle handle;
+  uint32_t engineIndex = 0; // position in GameEngine's entity list
+  bool staticCached = false; // drawn from the static layer cache...
+  vec2 cachedPosition{};     // ...at this position
+
 public:
   vec2 position;
+  vec2 prevPosition; // position at the start of the current tick
   vec2 dimensions; //
-  vec2 velocity;   // float velocityX = 0.0f, velocityY = 0.0f;
-  vec2 force;
+  vec2 velocity{}; // zeroed, or pooled entities start with stale values
+  vec2 force{};
 
   Texture tex;
+  AnimationState animation;
   bool isVisible = true;
+  int layer = 0; // draw order; higher layers are drawn on top
 
   bool hasPhysics = true;
   bool affectedByGravity = true;
@@ -38,38 +101,118 @@ public:
   bool grounded = false;
   bool isOneWay = false;
 
-  virtual bool GetSourceRect(SDL_FRect &out) const { (void)out; return false; }
+  UpdatePolicy updatePolicy = UpdatePolicy::PARALLEL;
+
+  // Sleep state, managed by PhysicsSystem::UpdateSleep. Sleeping bodies are
+  // not integrated and only collide with awake ones; contact, Wake,
+  // Teleport, ApplyImpulse, or an Update that moves them wakes them.
+  bool canSleep = true;
+  bool sleeping = false;
+  float restTime = 0.0f;             // seconds spent below the threshold
+  uint32_t sleepIsland = UINT32_MAX; // island it fell asleep with
+
+  // Read by the broadphase when a pass starts; change them between ticks.
+  uint32_t collisionLayer = COLLISION_LAYER_DEFAULT;
+  uint32_t collisionMask = COLLISION_MASK_ALL;
+
+  // Set in the constructor if OnCollision moves or wakes entities besides
+  // the two colliding. The grid broadphase then re-checks every body after
+  // this one's contacts, as it otherwise only re-indexes the pair.
+  bool collisionMovesOthers = false;
+
+  // Cheap type check for callbacks; see EntityCast. 0 = untagged.
+  uint32_t typeTag = 0;
+
+  // Scratch state owned by CollisionSystem's broadphase.
+  uint32_t collisionIndex = 0;
+  uint32_t broadphaseProxy = UINT32_MAX;
 
   Entity(float startX = 0.0f, float startY = 0.0f, float w = 32.0f,
          float h = 32.0f)
-      : id(nextId++), position({.x = startX, .y = startY}), dimensions({.x = w, .y = h}) {
+      : id(nextId++), position({.x = startX, .y = startY}),
+        prevPosition(position), dimensions({.x = w, .y = h}) {
     if (affectedByGravity) {
       force.y = 9.8 * 300.0;
     }
     tex.sheet = nullptr;
+    tex.source = {0.0f, 0.0f, -1.0f, -1.0f};
   }
   virtual ~Entity() = default;
 
   int GetId() const { return id; }
+  // Invalid (and nullptr) until the entity is added to an engine.
+  EntityHandle GetHandle() const { return handle; }
+  GameEngine *GetEngine() const { return engine; }
 
   virtual void Update(float, InputManager *) {}
   virtual void OnCollision(Entity *, CollisionData *) {}
+  // Pushed out of a tile of the collision pass's Tilemap (tile is its id).
+  // The velocity into the tile has already been removed.
+  virtual void OnTileCollision(uint16_t, CollisionData *) {}
+  // Created from level data (GameEngine::CreateEntities): position, size
+  // and texture are set, and it's about to be added. param is the level's
+  // value for it, e.g. a variant.
+  virtual void OnCreated(uint32_t) {}
+
+  // Subclass simulation state for snapshots (GameEngine::SaveState); the
+  // engine saves the fields declared here itself. Write plain values and
+  // handles, never pointers or render resources, and read them back in the
+  // same order. Restoring may construct the entity with its default
+  // constructor first, so subclasses that can be despawned and rolled back
+  // need one.
+  virtual void SaveState(StateWriter &) const {}
+  virtual void LoadState(StateReader &) {}
 
   inline SDL_FRect GetBounds() const {
     return SDL_FRect{position.x, position.y, dimensions.x, dimensions.y};
   }
+  // Its island wakes with it at the end of the tick.
+  inline void Wake() {
+    sleeping = false;
+    restTime = 0.0f;
+  }
+  inline void ApplyImpulse(vec2 deltaVelocity) {
+    velocity = add(velocity, deltaVelocity);
+    Wake();
+  }
+  // Moves without interpolating from the old position.
+  inline void Teleport(vec2 to) {
+    position = to;
+    prevPosition = to;
+    Wake();
+  }
   inline void SetPosition(float newX, float newY) {
     position = {.x = newX, .y = newY};
   }
   inline void SetTexture(SDL_Texture *texp) { tex.sheet = texp; }
   inline SDL_Texture *GetTexture() const { return tex.sheet; }
-  
-  SDL_FRect SampleTextureAt(int x, int y) const {
-    return {
-      .x = (float)(x * tex.frame_width),
-      .y = (float)(y * tex.frame_height),
-      .w = (float)(tex.frame_width),
-      .h = (float)(tex.frame_height)
-    };  
+  // The part of the texture to draw; false draws all of it.
+  inline bool GetSourceRect(SDL_FRect &out) const {
+    out = tex.source;
+    return tex.source.w >= 0.0f;
   }
+
+  // Starts an AnimationSystem clip from its first frame, unless it's
+  // already playing and restart is false. The frame is drawn from the end
+  // of the tick (or from AddEntity / Spawn, when played before).
+  inline void PlayAnimation(uint16_t clip, bool restart = false) {
+    if (clip == animation.clip && !restart)
+      return;
+    animation = {.clip = clip, .flags = ANIMATION_STARTED, .time = 0.0f};
+  }
+  // Keeps the current frame.
+  inline void StopAnimation() { animation = {}; }
 };
+
+// Downcast by tag instead of dynamic_cast. T declares
+// `static constexpr uint32_t TypeTag` and stores it in typeTag when
+// constructed; subclasses of T need a tag of their own.
+template <typename T> T *EntityCast(Entity *entity) {
+  return entity && entity->typeTag == T::TypeTag ? static_cast<T *>(entity)
+                                                 : nullptr;
+}
+template <typename T> const T *EntityCast(const Entity *entity) {
+  return entity && entity->typeTag == T::TypeTag
+             ? static_cast<const T *>(entity)
+             : nullptr;
+}
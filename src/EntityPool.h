@@ -0,0 +1,103 @@
+#pragma once
+#include "Config.h"
+#include "Entity.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Lets GameEngine return an entity to its pool without knowing its type.
+class EntityPoolBase {
+public:
+  virtual ~EntityPoolBase() = default;
+  virtual void Destroy(Entity *entity) = 0;
+  // Default-constructed object, or nullptr if the type has no default
+  // constructor. Used to bring back despawned entities on restore.
+  virtual Entity *CreateDefault() = 0;
+  virtual void Reserve(size_t count) = 0;
+  virtual size_t Count() const = 0;
+};
+
+// Storage for one Entity subclass, allocated in blocks of
+// cfg::ENTITY_POOL_BLOCK. Objects never move, and a destroyed object's slot
+// is reused by the next Create, so spawning into a pool that has reached its
+// working size never touches the heap. Everything created must be destroyed
+// before the pool is.
+template <typename T> class EntityPool final : public EntityPoolBase {
+  static_assert(std::is_base_of_v<Entity, T>, "pools hold Entity subclasses");
+
+  // Free slots link through their own storage.
+  union Slot {
+    Slot *next;
+    alignas(T) unsigned char bytes[sizeof(T)];
+  };
+
+  std::vector<std::unique_ptr<Slot[]>> blocks;
+  Slot *freeList = nullptr;
+  size_t live = 0;
+
+  void Grow() {
+    const size_t n = cfg::ENTITY_POOL_BLOCK;
+    // Not zeroed: Create constructs over it, and a bulk Reserve would
+    // otherwise write every block twice.
+    blocks.push_back(std::make_unique_for_overwrite<Slot[]>(n));
+    Slot *block = blocks.back().get();
+    for (size_t i = n; i-- > 0;) {
+      block[i].next = freeList;
+      freeList = &block[i];
+    }
+  }
+
+public:
+  EntityPool() = default;
+  EntityPool(const EntityPool &) = delete;
+  EntityPool &operator=(const EntityPool &) = delete;
+
+  template <typename... Args> T *Create(Args &&...args) {
+    if (!freeList)
+      Grow();
+    Slot *slot = freeList;
+    freeList = slot->next;
+    ++live;
+    return new (slot->bytes) T(std::forward<Args>(args)...);
+  }
+
+  Entity *CreateDefault() override {
+    if constexpr (std::is_default_constructible_v<T>)
+      return Create();
+    else
+      return nullptr;
+  }
+
+  void Destroy(Entity *entity) override {
+    T *object = static_cast<T *>(entity);
+    object->~T();
+    Slot *slot = reinterpret_cast<Slot *>(object);
+    slot->next = freeList;
+    freeList = slot;
+    --live;
+  }
+
+  // Allocates up front so the first `count` objects don't grow the pool.
+  void Reserve(size_t count) override {
+    while (Capacity() < count)
+      Grow();
+  }
+
+  size_t Count() const override { return live; }
+  size_t Capacity() const { return blocks.size() * cfg::ENTITY_POOL_BLOCK; }
+};
+
+// Dense per-type index, so GameEngine finds a type's pool without hashing.
+inline uint32_t NextEntityPoolType() {
+  static uint32_t next = 0;
+  return next++;
+}
+
+template <typename T> uint32_t EntityPoolType() {
+  static const uint32_t type = NextEntityPoolType();
+  return type;
+}
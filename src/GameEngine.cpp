@@ -1,14 +1,33 @@
 // GameEngine.cpp
 // #include <memory>
 #include "GameEngine.h"
+#include "Config.h"
 #include <algorithm>
 
 // GameEngine Implementation
-GameEngine::GameEngine() : window(nullptr), renderer(nullptr), running(false) {}
+GameEngine::GameEngine()
+    : window(nullptr), renderer(nullptr), running(false), useWorld(false),
+      tickRate(cfg::TICK_RATE), maxCatchUpTicks(cfg::MAX_CATCHUP_TICKS),
+      targetFrameRate(cfg::TARGET_FPS), simTick(0),
+      randomState(cfg::RANDOM_SEED), traceRequested(false), traceFrame(0),
+      frameLimit(0), framePipeline(FramePipeline::SERIAL),
+      staticCaching(true),
+      world(std::make_unique<World>()),
+      jobs(std::make_unique<JobSystem>(cfg::JOB_THREADS)),
+      assets(std::make_unique<AssetArchive>()),
+      animation(std::make_unique<AnimationSystem>()),
+      cameraTarget(nullptr),
+      cameraLimits({0.0f, 0.0f, cfg::WORLD_WIDTH, cfg::WORLD_HEIGHT}),
+      staticScene(std::make_shared<StaticScene>()) {
+  for (unsigned i = 0; i < jobs->GetThreadCount(); ++i)
+    commandBuffers.push_back(std::make_unique<CommandBuffer>());
+}
 
 GameEngine::~GameEngine() { Shutdown(); }
 
 bool GameEngine::Initialize(const char* title, int resx, int resy) {
+  PROFILE_THREAD("main");
+
   // Initialize SDL
   if (!SDL_Init(SDL_INIT_VIDEO)) {
     SDL_Log("Failed to initialize SDL: %s", SDL_GetError());
@@ -35,62 +54,356 @@ bool GameEngine::Initialize(const char* title, int resx, int resy) {
   physics = std::make_unique<PhysicsSystem>();
   input = std::make_unique<InputManager>();
   collision = std::make_unique<CollisionSystem>();
+  collision->SetJobSystem(jobs.get());
+  collision->SetTilemap(tilemap.get());
   renderSystem = std::make_unique<RenderSystem>(renderer, resx, resy);
+  resources = std::make_unique<ResourceManager>(renderer, jobs.get());
 
   running = true;
   return true;
 }
 
+// Fixed-step loop: the simulation always advances in 1/tickRate steps, and
+// rendering blends between the last two ticks by the leftover time.
 void GameEngine::Run() {
-  SDL_Event event;
-  Uint32 lastTime = SDL_GetTicks();
+  if (framePipeline != FramePipeline::SERIAL) {
+    RunPipelined();
+    return;
+  }
+  const Uint64 tickNS = SDL_NS_PER_SECOND / (Uint64)tickRate;
+  Uint64 previous = SDL_GetTicksNS();
+  Uint64 accumulator = 0;
+  Uint64 nextFrame = previous;
 
   while (running) {
-    // Calculate delta time
-    Uint32 currentTime = SDL_GetTicks();
-    float deltaTime = (float)(currentTime - lastTime);
-    lastTime = currentTime;
+    BeginProfilerFrame();
+    PROFILE_SCOPE("Frame");
+    const Uint64 now = SDL_GetTicksNS();
+    accumulator += now - previous;
+    previous = now;
 
-    // Handle events
-    while (SDL_PollEvent(&event)) {
-      if (event.type == SDL_EVENT_QUIT || input->IsKeyPressed(SDL_SCANCODE_ESCAPE)) {
-        running = false;
-      }   
-    }
-    // Update input
-    input->Update();
+    HandleEvents();
+    UpdateStreaming();
 
-    // Update game
-    Update(deltaTime / 1000.0);
+    {
+      PROFILE_SCOPE("Simulate");
+      int steps = 0;
+      while (accumulator >= tickNS && steps < maxCatchUpTicks) {
+        Step();
+        accumulator -= tickNS;
+        ++steps;
+      }
+    }
+    // Too far behind to catch up: drop the backlog instead of spiralling.
+    if (accumulator >= tickNS) {
+      frameStats.droppedTicks += accumulator / tickNS;
+      accumulator %= tickNS;
+    }
 
-    // Render
+    resources->Update();
+    renderSystem->SetInterpolationAlpha((float)accumulator / (float)tickNS);
     Render();
+    EndFrame(now, nextFrame);
+  }
+}
+
+// The simulation thread steps on its own fixed schedule and publishes a
+// render list after every batch of ticks; this thread polls events, draws
+// the newest list and presents, at whatever rate the display allows.
+void GameEngine::RunPipelined() {
+  renderPipeline = std::make_unique<RenderPipeline>(
+      framePipeline == FramePipeline::TRIPLE_BUFFERED ? 3 : 2);
+  {
+    std::lock_guard<std::mutex> guard(frameInputLock);
+    frameCamera = renderSystem->GetCamera();
+  }
+  simulating.store(true, std::memory_order_release);
+  simulationThread = std::thread(&GameEngine::SimulationLoop, this);
 
-    float delay = std::max(0.0, 1000.0 / 60.0 - deltaTime);
-    SDL_Delay(delay);
+  const Uint64 tickNS = SDL_NS_PER_SECOND / (Uint64)tickRate;
+  Uint64 nextFrame = SDL_GetTicksNS();
+  uint64_t drawnTick = 0; // newest tick on screen
+  while (running) {
+    BeginProfilerFrame();
+    PROFILE_SCOPE("Frame");
+    const Uint64 now = SDL_GetTicksNS();
+
+    HandleEvents();
+    {
+      int numKeys = 0;
+      const bool *keys = SDL_GetKeyboardState(&numKeys);
+      std::lock_guard<std::mutex> guard(frameInputLock);
+      std::copy(keys, keys + std::min((size_t)numKeys, frameKeys.size()),
+                frameKeys.begin());
+      frameCamera = renderSystem->GetCamera();
+    }
+
+    // Textures of unloaded regions go once no list drawing them is left.
+    if (streamer)
+      streamer->UpdateResources(drawnTick);
+    resources->Update();
+    const RenderList *list = renderPipeline->Acquire();
+    // Same blend as the serial loop: how far past the list's tick we are.
+    const float alpha =
+        list && now > list->tickTimeNS
+            ? std::min(1.0f, (float)(now - list->tickTimeNS) / (float)tickNS)
+            : 0.0f;
+    renderSystem->SetInterpolationAlpha(alpha);
+    DrawRenderList(list);
+    if (list)
+      drawnTick = list->tick;
+    EndFrame(now, nextFrame);
   }
+
+  simulating.store(false, std::memory_order_release);
+  simulationThread.join();
+  frameStats.skippedLists += renderPipeline->GetDropped();
+  renderPipeline.reset();
 }
 
-void GameEngine::Update(float deltaTime) {
-  // Update all entities
+void GameEngine::SimulationLoop() {
+  PROFILE_THREAD("simulation");
+  const Uint64 tickNS = SDL_NS_PER_SECOND / (Uint64)tickRate;
+  std::array<bool, SDL_SCANCODE_COUNT> keys{};
+  Camera camera = [this] {
+    std::lock_guard<std::mutex> guard(frameInputLock);
+    return frameCamera;
+  }();
+  input->SetSource(keys.data());
+
+  // Simulated time runs up to simulatedNS; a tick is due once the clock
+  // has passed the end of it.
+  Uint64 simulatedNS = SDL_GetTicksNS();
+  while (simulating.load(std::memory_order_acquire)) {
+    Uint64 now = SDL_GetTicksNS();
+    if (now < simulatedNS + tickNS) {
+      SDL_DelayNS(simulatedNS + tickNS - now);
+      continue;
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(frameInputLock);
+      keys = frameKeys;
+      camera = frameCamera;
+    }
+    if (streamer)
+      streamer->Update(GetStreamFocus(camera));
+    {
+      PROFILE_SCOPE("Simulate");
+      int steps = 0;
+      while (now >= simulatedNS + tickNS && steps < maxCatchUpTicks) {
+        Step();
+        simulatedNS += tickNS;
+        ++steps;
+      }
+    }
+    // Too far behind to catch up: drop the backlog instead of spiralling.
+    if (now >= simulatedNS + tickNS) {
+      const Uint64 behind = (now - simulatedNS) / tickNS;
+      frameStats.droppedTicks += behind;
+      simulatedNS += behind * tickNS;
+    }
+
+    RenderList &list = renderPipeline->BeginWrite();
+    RecordRenderList(list, camera);
+    list.tickTimeNS = simulatedNS;
+    renderPipeline->Publish(list);
+  }
+  input->SetSource(nullptr);
+}
+
+void GameEngine::BeginProfilerFrame() {
+  // Folds the previous frame's markers, so its "Frame" scope has closed.
+  Profiler::EndFrame();
+  if (traceRequested || (traceFrame && frameStats.frames == traceFrame)) {
+    Profiler::WriteChromeTrace(cfg::PROFILE_TRACE_PATH);
+    traceRequested = false;
+  }
+}
+
+void GameEngine::EndFrame(Uint64 frameStart, Uint64 &nextFrame) {
+  if (targetFrameRate > 0) {
+    const Uint64 frameNS = SDL_NS_PER_SECOND / (Uint64)targetFrameRate;
+    nextFrame += frameNS;
+    WaitUntil(nextFrame);
+
+    const Uint64 presented = SDL_GetTicksNS();
+    const double lateMs = (double)(presented - nextFrame) / SDL_NS_PER_MS;
+    if (lateMs > cfg::LATE_FRAME_MS) {
+      ++frameStats.lateFrames;
+      frameStats.worstLatenessMs =
+          std::max(frameStats.worstLatenessMs, lateMs);
+    }
+    // A long stall (window drag, breakpoint) restarts the schedule.
+    if (presented > nextFrame + frameNS)
+      nextFrame = presented;
+  }
+
+  const Uint64 frameEnd = SDL_GetTicksNS();
+  frameStats.lastFrameMs = (double)(frameEnd - frameStart) / SDL_NS_PER_MS;
+  ++frameStats.frames;
+  if (frameLimit && frameStats.frames >= frameLimit)
+    running = false;
+}
+
+void GameEngine::HandleEvents() {
+  PROFILE_SCOPE("Events");
+  SDL_Event event;
+  while (SDL_PollEvent(&event)) {
+    // SDL's key state: input may belong to the simulation thread.
+    if (event.type == SDL_EVENT_QUIT ||
+        SDL_GetKeyboardState(nullptr)[SDL_SCANCODE_ESCAPE]) {
+      running = false;
+    }
+    if (event.type == SDL_EVENT_KEY_DOWN && !event.key.repeat &&
+        event.key.scancode == SDL_SCANCODE_F9) {
+      traceRequested = true;
+    }
+    // The cached static layers' targets lost their contents; they're
+    // redrawn from the next frame's scene.
+    if (event.type == SDL_EVENT_RENDER_TARGETS_RESET ||
+        event.type == SDL_EVENT_RENDER_DEVICE_RESET) {
+      renderSystem->ReleaseStaticLayers();
+    }
+  }
+}
+
+void GameEngine::WaitUntil(Uint64 deadlineNS) {
+  PROFILE_SCOPE("FrameWait");
+  const Uint64 spinNS = (Uint64)(cfg::FRAME_SPIN_MS * SDL_NS_PER_MS);
+  Uint64 now = SDL_GetTicksNS();
+  if (now + spinNS < deadlineNS) {
+    SDL_DelayNS(deadlineNS - now - spinNS);
+  }
+  while (SDL_GetTicksNS() < deadlineNS) {
+    // spin: the OS sleep granularity is too coarse for the last stretch
+  }
+}
+
+void GameEngine::SetThreadCount(unsigned count) {
+  if (resources)
+    resources->Finish(); // nothing may still be queued on the old pool
+  jobs = std::make_unique<JobSystem>(count);
+  while (commandBuffers.size() < jobs->GetThreadCount())
+    commandBuffers.push_back(std::make_unique<CommandBuffer>());
+  if (resources)
+    resources->SetJobSystem(jobs.get());
+  if (collision)
+    collision->SetJobSystem(jobs.get());
+}
+
+bool GameEngine::MountArchive(const char *path) {
+  if (!assets->Open(path)) {
+    resources->SetArchive(nullptr);
+    return false;
+  }
+  resources->SetArchive(assets.get());
+  SDL_Log("Mounted %s (%zu assets)", path, assets->Count());
+  return true;
+}
+
+void GameEngine::SetTickRate(int ticksPerSecond) {
+  tickRate = std::max(1, ticksPerSecond);
+}
+
+void GameEngine::Step() {
+  PROFILE_SCOPE("Step");
+  bool staticsChanged = false;
   for (auto &entity : entities) {
+    // Statics that appeared, moved, stopped or were hidden since the last
+    // tick; the cache picks them up before the next frame.
+    staticsChanged |=
+        entity->staticCached
+            ? MovedSinceCached(entity) || !StaticScene::Caches(entity)
+            : staticCaching && StaticScene::Caches(entity);
+    entity->prevPosition = entity->position;
+  }
+  if (staticsChanged)
+    InvalidateStatics();
+  world->SnapshotPositions();
+
+  // Update input
+  input->Update();
+
+  Update(GetFixedDeltaTime());
+  // Sync point: nothing iterates the entity list any more this tick.
+  FlushCommands();
+  // Last, so clips played this tick (and by spawns) are drawn from its end.
+  animation->Advance(entities, GetFixedDeltaTime(), jobs.get());
+  ++frameStats.ticks;
+  ++simTick;
+}
+
+void GameEngine::Update(float deltaTime) {
+  PROFILE_SCOPE("Update");
+  auto updateEntity = [&](Entity *entity, CommandBuffer::Stage stage) {
+    Commands().SetOrder(CommandBuffer::OrderKey(stage, entity->engineIndex));
     entity->Update(deltaTime, input.get());
+    // An Update that moves a sleeping body or gives it velocity wakes it.
+    if (entity->sleeping &&
+        (entity->velocity.x != 0.0f || entity->velocity.y != 0.0f ||
+         entity->position.x != entity->prevPosition.x ||
+         entity->position.y != entity->prevPosition.y))
+      entity->Wake();
+    // A cached static that moves itself leaves the cache this frame.
+    if (entity->staticCached && MovedSinceCached(entity))
+      InvalidateStatics();
 
     // Apply physics if entity has physics enabled
-    if (entity->hasPhysics) {
+    if (!useWorld && entity->hasPhysics) {
       physics->ApplyPhysics(entity, deltaTime);
     }
+  };
+
+  // Parallel-safe entities are updated in chunks across the job threads;
+  // the rest run afterwards on this thread in their original order.
+  mainThreadEntities.clear();
+  jobs->ParallelFor(entities.size(), cfg::UPDATE_CHUNK,
+                    [&](size_t begin, size_t end) {
+                      PROFILE_SCOPE("UpdateChunk");
+                      for (size_t i = begin; i < end; ++i) {
+                        if (entities[i]->updatePolicy == UpdatePolicy::PARALLEL)
+                          updateEntity(entities[i],
+                                       CommandBuffer::STAGE_UPDATE);
+                      }
+                    });
+  for (auto &entity : entities) {
+    if (entity->updatePolicy == UpdatePolicy::MAIN_THREAD)
+      mainThreadEntities.push_back(entity);
+  }
+  {
+    PROFILE_SCOPE("UpdateMainThread");
+    for (auto &entity : mainThreadEntities) {
+      updateEntity(entity, CommandBuffer::STAGE_UPDATE_MAIN);
+    }
+  }
+
+  if (useWorld) {
+    PROFILE_SCOPE("Integrate");
+    world->PullAdopted();
+    physics->Integrate(*world, deltaTime, jobs.get());
+    world->PushAdopted();
   }
 
   // Process collisions
+  Commands().SetOrder(CommandBuffer::OrderKey(CommandBuffer::STAGE_COLLISIONS));
   collision->ProcessCollisions(entities);
+  physics->UpdateSleep(entities, collision->GetTouchingPairs(), deltaTime);
 }
 
-void GameEngine::Render() {
-  if (input->IsKeyPressed(SDL_SCANCODE_0)){
+CommandBuffer &GameEngine::Commands() {
+  const unsigned index = JobSystem::CurrentThreadIndex();
+  return *commandBuffers[index < commandBuffers.size() ? index : 0];
+}
+
+void GameEngine::FlushCommands() { CommandBuffer::Apply(commandBuffers, *this); }
+
+void GameEngine::BeginRender() {
+  const bool *keys = SDL_GetKeyboardState(nullptr);
+  if (keys[SDL_SCANCODE_0]){
     renderSystem->SetScalingMode(ScalingMode::CONSTANT_SIZE);
   }
-  if (input->IsKeyPressed(SDL_SCANCODE_9)){
+  if (keys[SDL_SCANCODE_9]){
     renderSystem->SetScalingMode(ScalingMode::PROPORTIONAL);
   }
 
@@ -104,26 +417,332 @@ void GameEngine::Render() {
   // Clear screen to blue as required
   renderSystem->SetBackgroundColor(0, 100, 200); // Blue background
   renderSystem->Clear();
+}
+
+void GameEngine::Render() {
+  PROFILE_SCOPE("Render");
+  BeginRender();
 
-  // Render all visible entities
-  for (const auto &entity : entities) {
-    if (entity->isVisible) {
-      renderSystem->RenderEntity(entity);
+  if (cameraTarget) {
+    const float alpha = renderSystem->GetInterpolationAlpha();
+    const vec2 pos =
+        add(cameraTarget->prevPosition,
+            mul(alpha, sub(cameraTarget->position, cameraTarget->prevPosition)));
+    renderSystem->GetCamera().CenterOn(
+        add(pos, mul(0.5f, cameraTarget->dimensions)), cameraLimits);
+  }
+  UpdateStaticScene();
+  renderSystem->BeginFrame();
+
+  {
+    PROFILE_SCOPE("Submit");
+    renderSystem->SubmitStaticLayers(*staticScene);
+    if (tilemap) {
+      tileScratch.clear();
+      tilemap->CollectMeshes(renderSystem->GetCullBounds(), tileScratch);
+      renderSystem->SubmitTiles(tileScratch);
+    }
+    // Only bodies near the view come back from the collision grids; without
+    // a valid index (brute-force broadphase, no grid pass yet) every entity
+    // is tested against the view instead.
+    visibleScratch.clear();
+    if (collision->QueryRegion(renderSystem->GetCullBounds(),
+                               visibleScratch)) {
+      renderSystem->AddCulled(
+          (uint32_t)(entities.size() - visibleScratch.size()));
+      for (uint32_t index : visibleScratch) {
+        if (entities[index]->isVisible && !IsCachedStatic(entities[index])) {
+          renderSystem->SubmitEntity(entities[index]);
+        }
+      }
+    } else {
+      for (const auto &entity : entities) {
+        if (entity->isVisible && !IsCachedStatic(entity)) {
+          renderSystem->SubmitEntity(entity);
+        }
+      }
+    }
+    if (useWorld) {
+      renderSystem->RenderWorld(*world);
     }
   }
 
+  renderSystem->EndFrame();
   renderSystem->Present();
 }
 
-void GameEngine::AddEntity(Entity *entity) { entities.push_back(entity); }
+void GameEngine::UpdateStaticScene() {
+  if (!staticsDirty.exchange(false, std::memory_order_relaxed))
+    return;
+  PROFILE_SCOPE("UpdateStaticScene");
+  staticScratch.sprites.clear();
+  for (Entity *entity : entities) {
+    entity->staticCached = staticCaching && StaticScene::Caches(entity);
+    if (entity->staticCached) {
+      entity->cachedPosition = entity->position;
+      staticScratch.Add(entity);
+    }
+  }
+  if (staticScratch.sprites == staticScene->sprites)
+    return;
+  staticScratch.version = staticScene->version + 1;
+  staticScene = std::make_shared<StaticScene>(staticScratch);
+}
+
+void GameEngine::RecordRenderList(RenderList &list, Camera &camera) {
+  PROFILE_SCOPE("RecordRenderList");
+  list.Clear();
+  list.tick = simTick;
+  if (cameraTarget) {
+    const vec2 half = mul(0.5f, cameraTarget->dimensions);
+    list.hasFocus = true;
+    list.prevFocus = add(cameraTarget->prevPosition, half);
+    list.focus = add(cameraTarget->position, half);
+    camera.CenterOn(list.focus, cameraLimits);
+  }
+
+  UpdateStaticScene();
+  list.statics = staticScene;
+  const SDL_FRect region = RenderSystem::CullBounds(camera);
+  if (tilemap)
+    tilemap->CollectMeshes(region, list.tiles);
+  visibleScratch.clear();
+  if (collision->QueryRegion(region, visibleScratch)) {
+    list.culled = (uint32_t)(entities.size() - visibleScratch.size());
+    for (uint32_t index : visibleScratch)
+      if (entities[index]->isVisible && !IsCachedStatic(entities[index]))
+        list.AddEntity(entities[index]);
+  } else {
+    for (const auto &entity : entities)
+      if (entity->isVisible && !IsCachedStatic(entity))
+        list.AddEntity(entity);
+  }
+  if (useWorld)
+    list.AddWorld(*world, region);
+}
+
+void GameEngine::DrawRenderList(const RenderList *list) {
+  PROFILE_SCOPE("Render");
+  BeginRender();
+  if (list) {
+    if (list->hasFocus) {
+      const float alpha = renderSystem->GetInterpolationAlpha();
+      renderSystem->GetCamera().CenterOn(
+          add(list->prevFocus, mul(alpha, sub(list->focus, list->prevFocus))),
+          cameraLimits);
+    }
+    renderSystem->BeginFrame();
+    {
+      PROFILE_SCOPE("Submit");
+      if (list->statics)
+        renderSystem->SubmitStaticLayers(*list->statics);
+      renderSystem->SubmitTiles(list->tiles);
+      renderSystem->SubmitList(*list);
+    }
+    renderSystem->EndFrame();
+  }
+  renderSystem->Present();
+}
+
+Tilemap *GameEngine::CreateTilemap(uint32_t widthTiles, uint32_t heightTiles,
+                                   float tileSize) {
+  tilemap = std::make_unique<Tilemap>(widthTiles, heightTiles, tileSize);
+  if (collision)
+    collision->SetTilemap(tilemap.get());
+  return tilemap.get();
+}
+
+LevelStreamer *GameEngine::CreateStreamer(const char *directory,
+                                          float regionSize) {
+  streamer.reset(); // joins its thread before the new one starts
+  streamer = std::make_unique<LevelStreamer>(*this, directory, regionSize);
+  return streamer.get();
+}
+
+void GameEngine::UpdateStreaming() {
+  if (!streamer)
+    return;
+  streamer->Update(GetStreamFocus(renderSystem->GetCamera()));
+  // Nothing drawn can still show what was unloaded.
+  streamer->UpdateResources(UINT64_MAX);
+}
+
+vec2 GameEngine::GetStreamFocus(const Camera &camera) const {
+  if (cameraTarget)
+    return add(cameraTarget->position, mul(0.5f, cameraTarget->dimensions));
+  const SDL_FRect view = camera.GetViewBounds();
+  return {.x = view.x + 0.5f * view.w, .y = view.y + 0.5f * view.h};
+}
+
+void GameEngine::SetCameraTarget(Entity *target, const SDL_FRect &limits) {
+  cameraTarget = target;
+  cameraLimits = limits;
+}
+
+void GameEngine::AddEntity(Entity *entity) { Register(entity, nullptr); }
+
+void GameEngine::Register(Entity *entity, EntityPoolBase *pool) {
+  uint32_t index;
+  if (!freeEntitySlots.empty()) {
+    index = freeEntitySlots.back();
+    freeEntitySlots.pop_back();
+  } else {
+    index = (uint32_t)entitySlots.size();
+    entitySlots.emplace_back();
+  }
+  EntitySlot &slot = entitySlots[index];
+  slot.entity = entity;
+  slot.pool = pool;
+  entity->engine = this;
+  entity->handle = {.index = index, .generation = slot.generation};
+  entity->engineIndex = (uint32_t)entities.size();
+
+  entities.push_back(entity);
+  animation->Apply(entity);
+  collision->AddToIndex(entities, entity->engineIndex);
+  if (useWorld) {
+    world->Adopt(entity);
+  }
+}
+
+uint32_t GameEngine::AddEntityType(const char *name, uint32_t poolType,
+                                   size_t size) {
+  const uint32_t existing = FindEntityType(name);
+  if (existing != ENTITY_TYPE_NONE) {
+    if (entityTypes[existing].poolType == poolType)
+      return existing;
+    SDL_Log("Entity type %s is already registered to another class", name);
+    return ENTITY_TYPE_NONE;
+  }
+  entityTypes.push_back({name, poolType, size});
+  return (uint32_t)(entityTypes.size() - 1);
+}
+
+uint32_t GameEngine::FindEntityType(const char *name) const {
+  for (size_t i = 0; i < entityTypes.size(); ++i)
+    if (entityTypes[i].name == name)
+      return (uint32_t)i;
+  return ENTITY_TYPE_NONE;
+}
+
+void GameEngine::CreateEntities(const EntityDesc *descs, size_t count,
+                                EntityHandle *handles) {
+  PROFILE_SCOPE("CreateEntities");
+  // Everything is reserved first, so the loop below never grows a pool or
+  // a table.
+  typeCounts.assign(entityTypes.size(), 0);
+  for (size_t i = 0; i < count; ++i)
+    if (descs[i].type < entityTypes.size())
+      ++typeCounts[descs[i].type];
+  for (size_t type = 0; type < entityTypes.size(); ++type) {
+    if (typeCounts[type] == 0)
+      continue;
+    EntityPoolBase *pool = pools[entityTypes[type].poolType].get();
+    pool->Reserve(pool->Count() + typeCounts[type]);
+  }
+  // Geometric, so creating a level in slices doesn't copy the tables
+  // every time.
+  auto grow = [](auto &table, size_t needed) {
+    if (table.capacity() < needed)
+      table.reserve(std::max(needed, table.capacity() * 2));
+  };
+  grow(entities, entities.size() + count);
+  grow(entitySlots, entitySlots.size() +
+                        (count - std::min(count, freeEntitySlots.size())));
+
+  size_t unknown = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const EntityDesc &desc = descs[i];
+    if (desc.type >= entityTypes.size()) {
+      if (handles)
+        handles[i] = {};
+      ++unknown;
+      continue;
+    }
+    EntityPoolBase *pool = pools[entityTypes[desc.type].poolType].get();
+    Entity *entity = pool->CreateDefault();
+    entity->position = desc.position;
+    entity->prevPosition = desc.position;
+    if (desc.dimensions.x > 0.0f && desc.dimensions.y > 0.0f)
+      entity->dimensions = desc.dimensions;
+    if (desc.texture)
+      entity->SetTexture(desc.texture);
+    entity->OnCreated(desc.param);
+    Register(entity, pool);
+    if (handles)
+      handles[i] = entity->GetHandle();
+  }
+  if (unknown > 0)
+    SDL_Log("CreateEntities: skipped %zu of unregistered types", unknown);
+}
 
 void GameEngine::RemoveEntity(Entity *entity) {
-  entities.erase(std::remove(entities.begin(), entities.end(), entity),
-                 entities.end());
+  if (!entity || Resolve(entity->handle) != entity)
+    return; // not registered here, or already removed
+  if (cameraTarget == entity)
+    cameraTarget = nullptr;
+
+  // Before the swap, so the grids still see both at their old indices.
+  collision->RemoveFromIndex(entities, entity->engineIndex);
+  Entity *last = entities.back();
+  entities[entity->engineIndex] = last;
+  last->engineIndex = entity->engineIndex;
+  entities.pop_back();
+  world->Release(entity);
+
+  Unregister(entity);
+}
+
+void GameEngine::Unregister(Entity *entity) {
+  collision->RemoveProxy(entity);
+  if (entity->staticCached) {
+    entity->staticCached = false;
+    InvalidateStatics();
+  }
+  // A new generation makes every outstanding handle stale.
+  EntitySlot &slot = entitySlots[entity->handle.index];
+  EntityPoolBase *pool = slot.pool;
+  freeEntitySlots.push_back(entity->handle.index);
+  slot = {.entity = nullptr, .pool = nullptr, .generation = slot.generation + 1};
+  if (pool) {
+    pool->Destroy(entity);
+  } else {
+    entity->engine = nullptr;
+    entity->handle = {};
+  }
+}
+
+void GameEngine::Despawn(EntityHandle handle) { RemoveEntity(Resolve(handle)); }
+
+void GameEngine::EnableWorld(bool enable) {
+  if (enable == useWorld)
+    return;
+  useWorld = enable;
+  if (useWorld) {
+    for (auto &entity : entities)
+      world->Adopt(entity);
+  } else {
+    world->ReleaseAllAdopted();
+  }
 }
 
 void GameEngine::Shutdown() {
+  for (auto &buffer : commandBuffers)
+    buffer->Discard();
+  world->ReleaseAllAdopted();
+  for (Entity *entity : entities)
+    Unregister(entity);
   entities.clear();
+  collision->InvalidateIndex();
+  cameraTarget = nullptr;
+
+  // Textures belong to the renderer, so they go first.
+  streamer.reset();
+  if (renderSystem)
+    renderSystem->ReleaseStaticLayers();
+  if (resources)
+    resources->Clear();
+  assets->Close();
 
   if (renderer) {
     SDL_DestroyRenderer(renderer);
@@ -137,3 +756,293 @@ void GameEngine::Shutdown() {
 
   SDL_Quit();
 }
+
+uint32_t GameEngine::Random() {
+  randomState = randomState * 6364136223846793005ull + 1442695040888963407ull;
+  return (uint32_t)(randomState >> 32);
+}
+
+// Snapshot layout: StateHeader, slot generations, free slots, the physics
+// section, then per entity an EntityRecord followed by its SaveState bytes.
+namespace {
+constexpr uint32_t STATE_MAGIC = 0x54534547; // "GEST"
+constexpr uint32_t STATE_VERSION = 2;
+constexpr uint32_t CALLER_OWNED = UINT32_MAX;
+
+struct StateHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t tick;
+  uint64_t random;
+  uint32_t entityCount;
+  uint32_t slotCount;
+  uint32_t freeCount;
+  uint32_t reserved;
+};
+static_assert(sizeof(StateHeader) == 40, "no padding in snapshots");
+
+enum EntityStateFlags : uint8_t {
+  STATE_VISIBLE = 1u << 0,
+  STATE_HAS_PHYSICS = 1u << 1,
+  STATE_GRAVITY = 1u << 2,
+  STATE_STATIC = 1u << 3,
+  STATE_GROUNDED = 1u << 4,
+  STATE_ONE_WAY = 1u << 5,
+  STATE_CAN_SLEEP = 1u << 6,
+  STATE_SLEEPING = 1u << 7,
+};
+
+struct EntityRecord {
+  uint32_t index;
+  uint32_t generation;
+  uint32_t poolType; // CALLER_OWNED for AddEntity entities
+  uint32_t extraBytes; // the entity's own SaveState, right after
+  vec2 position;
+  vec2 prevPosition;
+  vec2 dimensions;
+  vec2 velocity;
+  vec2 force;
+  float restTime;
+  uint32_t sleepIsland;
+  uint32_t collisionLayer;
+  uint32_t collisionMask;
+  int32_t layer;
+  uint8_t flags;
+  uint8_t updatePolicy;
+  uint16_t animationClip;
+  uint16_t animationFlags;
+  uint16_t reserved;
+  float animationTime;
+};
+static_assert(sizeof(EntityRecord) == 88, "no padding in snapshots");
+
+uint8_t StateFlagsOf(const Entity *e) {
+  return (e->isVisible ? STATE_VISIBLE : 0) |
+         (e->hasPhysics ? STATE_HAS_PHYSICS : 0) |
+         (e->affectedByGravity ? STATE_GRAVITY : 0) |
+         (e->isStatic ? STATE_STATIC : 0) | (e->grounded ? STATE_GROUNDED : 0) |
+         (e->isOneWay ? STATE_ONE_WAY : 0) |
+         (e->canSleep ? STATE_CAN_SLEEP : 0) |
+         (e->sleeping ? STATE_SLEEPING : 0);
+}
+} // namespace
+
+void GameEngine::SaveState(std::vector<uint8_t> &out) const {
+  PROFILE_SCOPE("SaveState");
+  out.clear();
+  StateWriter writer(out);
+  const StateHeader header = {.magic = STATE_MAGIC,
+                              .version = STATE_VERSION,
+                              .tick = simTick,
+                              .random = randomState,
+                              .entityCount = (uint32_t)entities.size(),
+                              .slotCount = (uint32_t)entitySlots.size(),
+                              .freeCount = (uint32_t)freeEntitySlots.size(),
+                              .reserved = 0};
+  writer.Write(header);
+  for (const EntitySlot &slot : entitySlots)
+    writer.Write(slot.generation);
+  writer.Write(freeEntitySlots.data(),
+               freeEntitySlots.size() * sizeof(uint32_t));
+
+  // Length-prefixed, so LoadState can validate past it before applying.
+  const size_t physicsAt = writer.Size();
+  writer.Write(uint32_t(0));
+  physics->SaveState(writer);
+  const uint32_t physicsBytes =
+      (uint32_t)(writer.Size() - physicsAt - sizeof(uint32_t));
+  memcpy(out.data() + physicsAt, &physicsBytes, sizeof(physicsBytes));
+
+  for (const Entity *e : entities) {
+    const EntitySlot &slot = entitySlots[e->handle.index];
+    uint32_t poolType = CALLER_OWNED;
+    for (uint32_t t = 0; slot.pool && t < pools.size(); ++t)
+      if (pools[t].get() == slot.pool)
+        poolType = t;
+
+    const EntityRecord record = {
+        .index = e->handle.index,
+        .generation = e->handle.generation,
+        .poolType = poolType,
+        .extraBytes = 0,
+        .position = e->position,
+        .prevPosition = e->prevPosition,
+        .dimensions = e->dimensions,
+        .velocity = e->velocity,
+        .force = e->force,
+        .restTime = e->restTime,
+        .sleepIsland = e->sleepIsland,
+        .collisionLayer = e->collisionLayer,
+        .collisionMask = e->collisionMask,
+        .layer = e->layer,
+        .flags = StateFlagsOf(e),
+        .updatePolicy = (uint8_t)e->updatePolicy,
+        .animationClip = e->animation.clip,
+        .animationFlags = e->animation.flags,
+        .reserved = 0,
+        .animationTime = e->animation.time};
+    const size_t recordAt = writer.Size();
+    writer.Write(record);
+    e->SaveState(writer);
+    const uint32_t extraBytes =
+        (uint32_t)(writer.Size() - recordAt - sizeof(EntityRecord));
+    memcpy(out.data() + recordAt + offsetof(EntityRecord, extraBytes),
+           &extraBytes, sizeof(extraBytes));
+  }
+}
+
+bool GameEngine::LoadState(const uint8_t *data, size_t size) {
+  PROFILE_SCOPE("LoadState");
+  // Validate everything before touching the engine.
+  StateReader reader(data, size);
+  const StateHeader header = reader.Read<StateHeader>();
+  if (!reader.Ok() || header.magic != STATE_MAGIC ||
+      header.version != STATE_VERSION ||
+      header.entityCount > header.slotCount ||
+      header.freeCount > header.slotCount ||
+      (size_t)header.slotCount * sizeof(uint32_t) > reader.Remaining()) {
+    SDL_Log("LoadState: not a snapshot from this build");
+    return false;
+  }
+  restoreGenerations.resize(header.slotCount);
+  reader.Read(restoreGenerations.data(), header.slotCount * sizeof(uint32_t));
+  restoreFree.resize(header.freeCount);
+  reader.Read(restoreFree.data(), header.freeCount * sizeof(uint32_t));
+  bool valid = true;
+  for (uint32_t index : restoreFree)
+    valid = valid && index < header.slotCount;
+  const uint32_t physicsBytes = reader.Read<uint32_t>();
+  const uint8_t *physicsData = reader.Cursor();
+  reader.Skip(physicsBytes);
+
+  restoreRecord.assign(header.slotCount, UINT32_MAX);
+  restoreOffsets.resize(header.entityCount);
+  for (uint32_t i = 0; i < header.entityCount && valid && reader.Ok(); ++i) {
+    restoreOffsets[i] = (size_t)(reader.Cursor() - data);
+    const EntityRecord record = reader.Read<EntityRecord>();
+    valid = record.index < header.slotCount &&
+            restoreRecord[record.index] == UINT32_MAX &&
+            (record.poolType == CALLER_OWNED ||
+             (record.poolType < pools.size() && pools[record.poolType]));
+    if (valid)
+      restoreRecord[record.index] = i;
+    reader.Skip(record.extraBytes);
+  }
+  if (!valid || !reader.Ok()) {
+    SDL_Log("LoadState: snapshot is truncated or inconsistent");
+    return false;
+  }
+
+  // Commands recorded after the snapshot belong to the abandoned future.
+  for (auto &buffer : commandBuffers)
+    buffer->Discard();
+
+  // Entities the snapshot doesn't have, under this handle and pool, go.
+  for (Entity *e : entities) {
+    const uint32_t index = e->handle.index;
+    const EntitySlot &slot = entitySlots[index];
+    const uint32_t r = index < header.slotCount ? restoreRecord[index]
+                                                : UINT32_MAX;
+    if (r != UINT32_MAX) {
+      EntityRecord record;
+      memcpy(&record, data + restoreOffsets[r], sizeof(record));
+      const EntityPoolBase *pool = record.poolType == CALLER_OWNED
+                                       ? nullptr
+                                       : pools[record.poolType].get();
+      if (record.generation == e->handle.generation && pool == slot.pool)
+        continue;
+    }
+    if (cameraTarget == e)
+      cameraTarget = nullptr;
+    world->Release(e);
+    entitySlots[index].entity = nullptr;
+    if (slot.pool) {
+      slot.pool->Destroy(e);
+    } else {
+      e->engine = nullptr;
+      e->handle = {};
+    }
+  }
+  entities.clear();
+
+  entitySlots.resize(header.slotCount);
+  for (uint32_t i = 0; i < header.slotCount; ++i) {
+    EntitySlot &slot = entitySlots[i];
+    slot.generation = restoreGenerations[i];
+    if (!slot.entity)
+      slot.pool = nullptr;
+  }
+  freeEntitySlots.assign(restoreFree.begin(), restoreFree.end());
+
+  bool complete = true;
+  for (uint32_t i = 0; i < header.entityCount; ++i) {
+    EntityRecord record;
+    memcpy(&record, data + restoreOffsets[i], sizeof(record));
+    EntitySlot &slot = entitySlots[record.index];
+    Entity *e = slot.entity;
+    if (!e) {
+      if (record.poolType != CALLER_OWNED)
+        e = pools[record.poolType]->CreateDefault();
+      if (!e) {
+        SDL_Log("LoadState: can't recreate entity %u (%s)", record.index,
+                record.poolType == CALLER_OWNED ? "caller-owned"
+                                                : "no default constructor");
+        ++slot.generation; // its handles stay dead
+        freeEntitySlots.push_back(record.index);
+        complete = false;
+        continue;
+      }
+      slot.entity = e;
+      slot.pool = pools[record.poolType].get();
+      if (useWorld)
+        world->Adopt(e);
+    }
+    e->engine = this;
+    e->handle = {.index = record.index, .generation = record.generation};
+    e->engineIndex = (uint32_t)entities.size();
+    entities.push_back(e);
+
+    e->position = record.position;
+    e->prevPosition = record.prevPosition;
+    e->dimensions = record.dimensions;
+    e->velocity = record.velocity;
+    e->force = record.force;
+    e->restTime = record.restTime;
+    e->sleepIsland = record.sleepIsland;
+    e->collisionLayer = record.collisionLayer;
+    e->collisionMask = record.collisionMask;
+    e->layer = record.layer;
+    e->isVisible = record.flags & STATE_VISIBLE;
+    e->hasPhysics = record.flags & STATE_HAS_PHYSICS;
+    e->affectedByGravity = record.flags & STATE_GRAVITY;
+    e->isStatic = record.flags & STATE_STATIC;
+    e->grounded = record.flags & STATE_GROUNDED;
+    e->isOneWay = record.flags & STATE_ONE_WAY;
+    e->canSleep = record.flags & STATE_CAN_SLEEP;
+    e->sleeping = record.flags & STATE_SLEEPING;
+    e->updatePolicy = (UpdatePolicy)record.updatePolicy;
+    e->animation = {.clip = record.animationClip,
+                    .flags = record.animationFlags,
+                    .time = record.animationTime};
+    animation->Apply(e);
+
+    StateReader extra(data + restoreOffsets[i] + sizeof(EntityRecord),
+                      record.extraBytes);
+    e->LoadState(extra);
+    if (!extra.Ok()) {
+      SDL_Log("LoadState: entity %u read past its state", record.index);
+      complete = false;
+    }
+  }
+
+  simTick = header.tick;
+  randomState = header.random;
+  StateReader physicsReader(physicsData, physicsBytes);
+  if (!physics->LoadState(physicsReader)) {
+    SDL_Log("LoadState: bad sleep island state");
+    complete = false;
+  }
+  collision->RebuildStaticProxies(entities);
+  InvalidateStatics();
+  return complete;
+}
@@ -1,17 +1,58 @@
 // GameEngine.h
 #pragma once
+#include "Animation.h"
+#include "AssetArchive.h"
 #include "Collisions.h"
+#include "CommandBuffer.h"
 #include "Entity.h"
+#include "EntityPool.h"
 #include "Input.h"
+#include "JobSystem.h"
+#include "LevelStreamer.h"
 #include "Physics.h"
+#include "Profiler.h"
 #include "Render.h"
+#include "RenderList.h"
+#include "ResourceManager.h"
+#include "Scene.h"
+#include "Tilemap.h"
+#include "World.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <SDL3/SDL.h>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
 // #include <unordered_map>
 #include <vector>
 
 // Forward declarations
 
+// Loop timing counters, cumulative since Initialize.
+struct FrameStats {
+  uint64_t frames = 0;
+  uint64_t ticks = 0;
+  uint64_t lateFrames = 0;   // presented more than cfg::LATE_FRAME_MS late
+  uint64_t droppedTicks = 0; // simulation time discarded by the catch-up cap
+  uint64_t skippedLists = 0; // pipelined: ticks never drawn (see
+                             // RenderPipeline)
+  double lastFrameMs = 0.0;
+  double worstLatenessMs = 0.0;
+};
+
+// How Run splits simulation and presentation. SDL renderers belong to the
+// thread that created them, so rendering, events and presenting stay on
+// the thread calling Run; the pipelined modes move the simulation to a
+// thread of its own, which records a RenderList per tick.
+enum class FramePipeline {
+  SERIAL,          // simulate, then render, one after the other
+  DOUBLE_BUFFERED, // render one list while the next tick is simulated
+  TRIPLE_BUFFERED, // plus a finished spare, for slow or uneven presents
+};
+
 // Core Engine Class
 class GameEngine {
 private:
@@ -20,13 +61,83 @@ private:
   SDL_Window *window;
   SDL_Renderer *renderer;
   bool running;
+  bool useWorld;
+
+  int tickRate;
+  int maxCatchUpTicks;
+  int targetFrameRate; // 0 = present as fast as possible
+  FrameStats frameStats;
+  uint64_t simTick;      // Steps run; saved with the simulation state
+  uint64_t randomState;  // Random(); saved with the simulation state
+  bool traceRequested;  // F9: write a trace after this frame
+  uint64_t traceFrame;  // write a trace once this many frames ran; 0 = off
+  uint64_t frameLimit;  // Run returns after this many frames; 0 = no limit
+  FramePipeline framePipeline;
+  bool staticCaching;   // draw resting statics through StaticLayerCache
+  std::atomic<bool> staticsDirty{true}; // staticScene may be out of date
 
   std::unique_ptr<PhysicsSystem> physics;
   std::unique_ptr<InputManager> input;
   std::unique_ptr<CollisionSystem> collision;
   std::unique_ptr<RenderSystem> renderSystem;
+  std::unique_ptr<World> world;
+  std::unique_ptr<JobSystem> jobs;
+  std::unique_ptr<AssetArchive> assets;
+  std::unique_ptr<ResourceManager> resources; // after jobs: decodes use it
+  std::unique_ptr<AnimationSystem> animation; // after resources: holds sheets
+  std::unique_ptr<Tilemap> tilemap;
+  std::unique_ptr<LevelStreamer> streamer; // after resources: holds textures
+
+  // Registration table behind EntityHandle; pool is null for entities the
+  // caller owns (AddEntity).
+  struct EntitySlot {
+    Entity *entity = nullptr;
+    EntityPoolBase *pool = nullptr;
+    uint32_t generation = 0;
+  };
+  std::vector<EntitySlot> entitySlots;
+  std::vector<uint32_t> freeEntitySlots;
+  std::vector<std::unique_ptr<EntityPoolBase>> pools; // by EntityPoolType<T>
+
+  // Types level data can create by name.
+  struct EntityType {
+    std::string name;
+    uint32_t poolType;
+    size_t size; // sizeof the class
+  };
+  std::vector<EntityType> entityTypes;
+  std::vector<size_t> typeCounts; // CreateEntities scratch
+
+  // One per job thread (index = JobSystem::CurrentThreadIndex()).
+  std::vector<std::unique_ptr<CommandBuffer>> commandBuffers;
 
   std::vector<Entity *> entities;
+  std::vector<Entity *> mainThreadEntities; // per-tick scratch
+  std::vector<uint32_t> visibleScratch;     // per-frame cull query results
+  std::vector<std::shared_ptr<const TileMesh>> tileScratch;
+
+  Entity *cameraTarget;
+  SDL_FRect cameraLimits;
+
+  // Resting statics as of the last frame recorded; replaced, never
+  // modified, when they change (render lists share it).
+  std::shared_ptr<const StaticScene> staticScene;
+  StaticScene staticScratch;
+
+  // Pipelined Run: the simulation thread and what the render thread hands
+  // it each frame (keys and camera, for input and culling).
+  std::unique_ptr<RenderPipeline> renderPipeline;
+  std::thread simulationThread;
+  std::atomic<bool> simulating{false};
+  std::mutex frameInputLock;
+  std::array<bool, SDL_SCANCODE_COUNT> frameKeys{};
+  Camera frameCamera{(float)cfg::SCREEN_WIDTH, (float)cfg::SCREEN_HEIGHT};
+
+  // LoadState scratch.
+  std::vector<uint32_t> restoreGenerations;
+  std::vector<uint32_t> restoreFree;
+  std::vector<uint32_t> restoreRecord; // by handle index
+  std::vector<size_t> restoreOffsets;  // of each entity record
 
 public:
   GameEngine();
@@ -37,19 +148,205 @@ public:
   void Shutdown();
   void Render();
   void Update(float deltaTime);
+  // Advances the simulation by exactly one fixed tick.
+  void Step();
+  // Ticks stepped so far; rolls back with LoadState.
+  uint64_t GetTick() const { return simTick; }
+
+  void SetTickRate(int ticksPerSecond);
+  int GetTickRate() const { return tickRate; }
+  float GetFixedDeltaTime() const { return 1.0f / (float)tickRate; }
+  void SetMaxCatchUpTicks(int ticks) { maxCatchUpTicks = ticks; }
+  void SetTargetFrameRate(int fps) { targetFrameRate = fps; }
+  const FrameStats &GetFrameStats() const { return frameStats; }
+  // Writes cfg::PROFILE_TRACE_PATH once `frames` frames have run (0 = only
+  // on F9).
+  void SetTraceFrame(uint64_t frames) { traceFrame = frames; }
+  // Run returns after this many frames (0 = when the window closes).
+  void SetFrameLimit(uint64_t frames) { frameLimit = frames; }
+  // Applies from the next Run. In the pipelined modes Step runs on another
+  // thread during Run: only touch entities from their callbacks and
+  // commands, and don't Wait on the job system from this thread meanwhile.
+  void SetFramePipeline(FramePipeline mode) { framePipeline = mode; }
+  FramePipeline GetFramePipeline() const { return framePipeline; }
+  // Resting static entities are drawn into cached chunk layers that are
+  // only redrawn when one of them changes (on by default). Applies from
+  // the next frame; don't change it during a pipelined Run.
+  void SetStaticCaching(bool enable) {
+    staticCaching = enable;
+    InvalidateStatics();
+  }
+  bool GetStaticCaching() const { return staticCaching; }
+  // The cache notices statics being added, removed, moved, shown, hidden or
+  // given a texture; moves made from other entities' callbacks or commands
+  // show a tick late. Call this after changing a static entity's texture,
+  // frame, size or layer, or to redraw it at once.
+  void InvalidateStatics() {
+    staticsDirty.store(true, std::memory_order_relaxed);
+  }
   std::vector<Entity *> &GetEntities() { return entities; }
 
+  // Keeps the camera centred on target (nullptr stops following) without
+  // showing anything outside limits, in world coordinates.
+  void SetCameraTarget(Entity *target, const SDL_FRect &limits);
+
+  // Creates a T in the engine's pool for T and adds it. The engine owns it:
+  // RemoveEntity / Despawn destroy it, and Shutdown destroys what's left.
+  template <typename T, typename... Args> T *Spawn(Args &&...args) {
+    EntityPool<T> &pool = GetPool<T>();
+    T *entity = pool.Create(std::forward<Args>(args)...);
+    Register(entity, &pool);
+    return entity;
+  }
+  template <typename T> EntityPool<T> &GetPool() {
+    const uint32_t type = EntityPoolType<T>();
+    if (type >= pools.size())
+      pools.resize(type + 1);
+    if (!pools[type])
+      pools[type] = std::make_unique<EntityPool<T>>();
+    return static_cast<EntityPool<T> &>(*pools[type]);
+  }
+
+  // Lets level data (LevelStreamer, Scene) create T by name: default-constructed
+  // in T's pool, then set up by CreateEntities. Register every type before
+  // loading levels. Returns the type's id.
+  template <typename T> uint32_t RegisterEntityType(const char *name) {
+    static_assert(std::is_default_constructible_v<T>,
+                  "level data creates entities default-constructed");
+    GetPool<T>();
+    return AddEntityType(name, EntityPoolType<T>(), sizeof(T));
+  }
+  // ENTITY_TYPE_NONE if no type has that name.
+  uint32_t FindEntityType(const char *name) const;
+  // sizeof the registered class, 0 for ENTITY_TYPE_NONE.
+  size_t GetEntityTypeSize(uint32_t type) const {
+    return type < entityTypes.size() ? entityTypes[type].size : 0;
+  }
+  // Creates count entities at once, reserving pools and tables once up
+  // front. Each gets its desc's position, size and texture, then
+  // OnCreated(param), then is added like Spawn would. handles (if given)
+  // receives each one's handle; entries with an unknown type are skipped
+  // and get an invalid handle. Not during Step.
+  void CreateEntities(const EntityDesc *descs, size_t count,
+                      EntityHandle *handles = nullptr);
+
+  // Adds an entity the caller keeps ownership of.
   void AddEntity(Entity *entity);
+  // O(1): the last entity takes the removed one's place in the list. Pooled
+  // entities are destroyed; others are only unregistered. AddEntity, Spawn
+  // and RemoveEntity must not be called during Step; use Commands() there.
   void RemoveEntity(Entity *entity);
+  // Does nothing if the handle is stale.
+  void Despawn(EntityHandle handle);
+  // The calling thread's command buffer, for spawning, destroying and
+  // changing components from Update / OnCollision (on any job thread).
+  // Commands apply at the end of the tick, after collisions.
+  CommandBuffer &Commands();
+  // Applies pending commands now; Step does this itself.
+  void FlushCommands();
+
+  // Gameplay random numbers. The sequence is part of the saved state, so a
+  // rollback replays the same numbers; use this instead of rand() in
+  // simulation code. Not thread-safe: call it from MAIN_THREAD updates,
+  // collision callbacks or commands.
+  uint32_t Random();
+  void SeedRandom(uint64_t seed) { randomState = seed; }
+
+  // Replaces out with the simulation state: the tick, the random state, the
+  // handle table, sleep islands, and every registered entity's fields plus
+  // its SaveState. Textures, the camera and pending commands aren't
+  // included. Call between ticks.
+  void SaveState(std::vector<uint8_t> &out) const;
+  // Returns to a SaveState snapshot taken by this process. Entities spawned
+  // since are removed, despawned ones are recreated (default-constructed,
+  // then loaded) under their old handles, and the rest get their saved
+  // state back. Caller-owned entities can't be recreated. Logs and returns
+  // false if the snapshot is malformed (nothing changes) or some entities
+  // couldn't be recreated (the rest is restored).
+  bool LoadState(const uint8_t *data, size_t size);
+
+  // nullptr once the entity has been removed.
+  Entity *Resolve(EntityHandle handle) const {
+    return handle.index < entitySlots.size() &&
+                   entitySlots[handle.index].generation == handle.generation
+               ? entitySlots[handle.index].entity
+               : nullptr;
+  }
+
+  // World mode: entities are adopted into the component store and integrated
+  // in bulk; bodies created directly in the world are updated and drawn too.
+  void EnableWorld(bool enable);
+  bool IsWorldEnabled() const { return useWorld; }
+  World *GetWorld() const { return world.get(); }
 
   PhysicsSystem *GetPhysics() const { return physics.get(); }
   InputManager *GetInput() const { return input.get(); }
   CollisionSystem *GetCollision() const { return collision.get(); }
   RenderSystem *GetRenderSystem() const { return renderSystem.get(); }
+  JobSystem *GetJobSystem() const { return jobs.get(); }
+  ResourceManager *GetResources() const { return resources.get(); }
+  AnimationSystem *GetAnimation() const { return animation.get(); }
+  // Level geometry, drawn under the entities and collided with by bodies
+  // whose mask includes its collision layer. Replaces any earlier map. Not
+  // part of SaveState.
+  Tilemap *CreateTilemap(uint32_t widthTiles, uint32_t heightTiles,
+                         float tileSize);
+  Tilemap *GetTilemap() const { return tilemap.get(); }
+  // Streams regions of the world from directory around the camera target
+  // (or the camera); see LevelStreamer. Replaces any earlier streamer,
+  // unloading what it had streamed in. Its entities and tiles aren't rolled
+  // back by LoadState.
+  LevelStreamer *CreateStreamer(const char *directory, float regionSize);
+  LevelStreamer *GetStreamer() const { return streamer.get(); }
+  // Run does this once per frame. Loops that call Step and Render
+  // themselves call it between frames, on the main thread.
+  void UpdateStreaming();
+  // Maps a .pak built by asset_packer; textures it contains load from it
+  // instead of their BMP files. Returns false if it can't be opened.
+  bool MountArchive(const char *path);
+  // Replaces the pool; 0 = one thread per hardware thread, 1 = serial.
+  void SetThreadCount(unsigned count);
   SDL_Renderer *GetRenderer() const { return renderer; }
 
 private:
+  void Register(Entity *entity, EntityPoolBase *pool);
+  uint32_t AddEntityType(const char *name, uint32_t poolType, size_t size);
+  // What streaming loads around: the camera target's centre, or the
+  // centre of camera's view.
+  vec2 GetStreamFocus(const Camera &camera) const;
+  // Frees the handle slot and destroys pooled entities.
+  void Unregister(Entity *entity);
   void HandleEvents();
+  // Sleeps most of the way to the deadline, then spins the rest.
+  void WaitUntil(Uint64 deadlineNS);
+  // Folds the last frame's profile and writes a trace if one is due.
+  void BeginProfilerFrame();
+  // Frame-rate cap and lateness stats, at the end of a Run frame.
+  void EndFrame(Uint64 frameStart, Uint64 &nextFrame);
+  // Scaling keys, window size and clear: the start of every frame drawn.
+  void BeginRender();
+  // Collects the statics to cache if they may have changed; replaces
+  // staticScene if they did.
+  void UpdateStaticScene();
+  // Drawn by the cache, so not submitted one by one. A static that has
+  // moved or been hidden since is drawn (or not) like any other entity.
+  static bool IsCachedStatic(const Entity *entity) {
+    return entity->staticCached && !MovedSinceCached(entity) &&
+           StaticScene::Caches(entity);
+  }
+  static bool MovedSinceCached(const Entity *entity) {
+    return entity->position.x != entity->cachedPosition.x ||
+           entity->position.y != entity->cachedPosition.y;
+  }
+
+  void RunPipelined();
+  void SimulationLoop();
+  // On the simulation thread: what's visible through camera after this
+  // tick. camera is the render thread's, recentred on the target here.
+  void RecordRenderList(RenderList &list, Camera &camera);
+  // On the render thread: draws list (nothing before the first) and
+  // presents.
+  void DrawRenderList(const RenderList *list);
 };
 
 // Physics System
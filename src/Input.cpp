@@ -2,12 +2,12 @@
 
 // SDL3: SDL_GetKeyboardState returns const bool*
 // keyboardState points to SDL's internal array for the *current* frame.
-InputManager::InputManager() : keyboardState(nullptr) {}
+InputManager::InputManager() : keyboardState(nullptr), source(nullptr) {}
 
 void InputManager::Update() {
   // Fetch the current keyboard state first
   int numKeys = 0;
-  const bool* state = SDL_GetKeyboardState(&numKeys);
+  const bool* state = source ? source : SDL_GetKeyboardState(&numKeys);
 
   // Snapshot "previous" for any keys we've tracked so far
   // (Don't clear the map; we overwrite values for tracked scancodes.)
@@ -5,11 +5,16 @@
 class InputManager {
 private:
   const bool *keyboardState; // SDL3 returns const bool*, not const Uint8*
+  const bool *source;        // read instead of SDL's array when set
   std::unordered_map<SDL_Scancode, bool> previousKeyState;
 
 public:
   InputManager();
   void Update();
+  // Makes Update read keys (SDL_SCANCODE_COUNT entries) instead of SDL's
+  // own array, e.g. a copy taken on the thread that polls events; nullptr
+  // goes back to SDL's.
+  void SetSource(const bool *keys) { source = keys; }
 
   bool IsKeyPressed(SDL_Scancode scancode) const;
   bool IsKeyJustPressed(SDL_Scancode scancode) const;
@@ -0,0 +1,177 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <string>
+
+static thread_local unsigned tlsThreadIndex = 0;
+
+size_t JobGraph::Add(std::function<void()> fn,
+                     std::initializer_list<size_t> dependsOn) {
+  auto node = std::make_unique<Node>();
+  node->fn = std::move(fn);
+  nodes.push_back(std::move(node));
+  const size_t id = nodes.size() - 1;
+  for (size_t dep : dependsOn)
+    DependsOn(id, dep);
+  return id;
+}
+
+void JobGraph::DependsOn(size_t node, size_t dependency) {
+  nodes[dependency]->dependents.push_back(node);
+  ++nodes[node]->dependencyCount;
+}
+
+JobSystem::JobSystem(unsigned threadCount) {
+  if (threadCount == 0)
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  const unsigned workerCount = threadCount - 1;
+
+  for (unsigned i = 0; i <= workerCount; ++i)
+    queues.push_back(std::make_unique<Queue>());
+  for (unsigned i = 1; i <= workerCount; ++i)
+    workers.emplace_back([this, i] { WorkerLoop(i); });
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> guard(sleepLock);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto &worker : workers)
+    worker.join();
+}
+
+unsigned JobSystem::CurrentThreadIndex() { return tlsThreadIndex; }
+
+void JobSystem::Schedule(Job job, JobCounter *counter) {
+  if (counter)
+    counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+  // Workers push to their own deque; any other thread uses slot 0.
+  unsigned self = tlsThreadIndex;
+  if (self >= queues.size())
+    self = 0;
+  {
+    std::lock_guard<std::mutex> guard(queues[self]->lock);
+    queues[self]->tasks.push_back({std::move(job), counter});
+  }
+  queued.fetch_add(1, std::memory_order_release);
+  if (!workers.empty()) {
+    std::lock_guard<std::mutex> guard(sleepLock);
+    wake.notify_one();
+  }
+}
+
+void JobSystem::Wait(JobCounter &counter) {
+  unsigned self = tlsThreadIndex;
+  if (self >= queues.size())
+    self = 0;
+  while (counter.pending.load(std::memory_order_acquire) > 0) {
+    if (!RunOne(self))
+      std::this_thread::yield();
+  }
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grain,
+                            const std::function<void(size_t, size_t)> &fn) {
+  if (count == 0)
+    return;
+  grain = std::max<size_t>(grain, 1);
+  if (workers.empty() || count <= grain) {
+    fn(0, count);
+    return;
+  }
+
+  JobCounter counter;
+  for (size_t begin = 0; begin < count; begin += grain) {
+    const size_t end = std::min(count, begin + grain);
+    Schedule([&fn, begin, end] { fn(begin, end); }, &counter);
+  }
+  Wait(counter);
+}
+
+void JobSystem::Run(JobGraph &graph) {
+  JobCounter counter;
+  for (auto &node : graph.nodes)
+    node->remaining.store(node->dependencyCount, std::memory_order_relaxed);
+  for (size_t i = 0; i < graph.nodes.size(); ++i)
+    if (graph.nodes[i]->dependencyCount == 0)
+      ScheduleNode(graph, i, &counter);
+  Wait(counter);
+}
+
+void JobSystem::ScheduleNode(JobGraph &graph, size_t node,
+                             JobCounter *counter) {
+  Schedule(
+      [this, &graph, node, counter] {
+        JobGraph::Node &n = *graph.nodes[node];
+        if (n.fn)
+          n.fn();
+        for (size_t dependent : n.dependents)
+          if (graph.nodes[dependent]->remaining.fetch_sub(
+                  1, std::memory_order_acq_rel) == 1)
+            ScheduleNode(graph, dependent, counter);
+      },
+      counter);
+}
+
+void JobSystem::WorkerLoop(unsigned index) {
+  tlsThreadIndex = index;
+#if ENGINE_PROFILE
+  const std::string name = "worker " + std::to_string(index);
+  PROFILE_THREAD(name.c_str());
+#endif
+  while (true) {
+    if (RunOne(index))
+      continue;
+
+    std::unique_lock<std::mutex> guard(sleepLock);
+    wake.wait(guard, [this] {
+      return stopping.load() || queued.load(std::memory_order_acquire) > 0;
+    });
+    if (stopping && queued.load() == 0)
+      return;
+  }
+}
+
+bool JobSystem::RunOne(unsigned self) {
+  Task task;
+  if (Pop(self, task) || Steal(self, task)) {
+    Execute(task);
+    return true;
+  }
+  return false;
+}
+
+bool JobSystem::Pop(unsigned self, Task &out) {
+  Queue &q = *queues[self];
+  std::lock_guard<std::mutex> guard(q.lock);
+  if (q.tasks.empty())
+    return false;
+  out = std::move(q.tasks.back());
+  q.tasks.pop_back();
+  queued.fetch_sub(1, std::memory_order_relaxed);
+  return true;
+}
+
+bool JobSystem::Steal(unsigned self, Task &out) {
+  const size_t n = queues.size();
+  for (size_t k = 1; k < n; ++k) {
+    Queue &q = *queues[(self + k) % n];
+    std::lock_guard<std::mutex> guard(q.lock);
+    if (q.tasks.empty())
+      continue;
+    out = std::move(q.tasks.front());
+    q.tasks.pop_front();
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+  }
+  return false;
+}
+
+void JobSystem::Execute(Task &task) {
+  task.fn();
+  if (task.counter)
+    task.counter->pending.fetch_sub(1, std::memory_order_acq_rel);
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Counts outstanding jobs; JobSystem::Wait returns once it reaches zero.
+struct JobCounter {
+  std::atomic<int> pending{0};
+};
+
+// A set of jobs with dependencies, run with JobSystem::Run. A node starts
+// once every node it depends on has finished.
+class JobGraph {
+private:
+  friend class JobSystem;
+  struct Node {
+    std::function<void()> fn;
+    std::vector<size_t> dependents;
+    int dependencyCount = 0;
+    std::atomic<int> remaining{0};
+  };
+  std::vector<std::unique_ptr<Node>> nodes;
+
+public:
+  size_t Add(std::function<void()> fn,
+             std::initializer_list<size_t> dependsOn = {});
+  void DependsOn(size_t node, size_t dependency);
+  size_t Size() const { return nodes.size(); }
+  void Clear() { nodes.clear(); }
+};
+
+// Work-stealing thread pool. Every thread (workers plus slot 0 for the
+// thread that owns the engine) has its own deque: owners push and pop at
+// the back, idle threads steal from the front of someone else's. Threads
+// blocked in Wait run jobs instead of sleeping.
+class JobSystem {
+public:
+  using Job = std::function<void()>;
+
+private:
+  struct Task {
+    Job fn;
+    JobCounter *counter;
+  };
+  struct Queue {
+    std::mutex lock;
+    std::deque<Task> tasks;
+  };
+
+  std::vector<std::unique_ptr<Queue>> queues; // [0] = owner thread
+  std::vector<std::thread> workers;
+  std::mutex sleepLock;
+  std::condition_variable wake;
+  std::atomic<int> queued{0};
+  std::atomic<bool> stopping{false};
+
+public:
+  // threadCount includes the calling thread, so 1 runs everything inline;
+  // 0 uses one thread per hardware thread.
+  explicit JobSystem(unsigned threadCount = 0);
+  ~JobSystem();
+
+  JobSystem(const JobSystem &) = delete;
+  JobSystem &operator=(const JobSystem &) = delete;
+
+  unsigned GetWorkerCount() const { return (unsigned)workers.size(); }
+  // Workers plus the thread that waits.
+  unsigned GetThreadCount() const { return (unsigned)workers.size() + 1; }
+
+  void Schedule(Job job, JobCounter *counter = nullptr);
+  void Wait(JobCounter &counter);
+
+  // Splits [0, count) into chunks of about `grain` items and runs
+  // fn(begin, end) for each across all threads; returns when all are done.
+  void ParallelFor(size_t count, size_t grain,
+                   const std::function<void(size_t, size_t)> &fn);
+
+  // Runs every node of the graph respecting its dependencies.
+  void Run(JobGraph &graph);
+
+  // 0 on threads that aren't workers of any pool, 1..N on workers.
+  static unsigned CurrentThreadIndex();
+
+private:
+  void WorkerLoop(unsigned index);
+  bool RunOne(unsigned self);
+  bool Pop(unsigned self, Task &out);
+  bool Steal(unsigned self, Task &out);
+  void Execute(Task &task);
+  void ScheduleNode(JobGraph &graph, size_t node, JobCounter *counter);
+};
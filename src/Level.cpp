@@ -0,0 +1,224 @@
+#include "Level.h"
+#include <SDL3/SDL.h>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+
+namespace {
+std::vector<std::string> SplitWords(const std::string &line) {
+  std::vector<std::string> words;
+  size_t i = 0;
+  while (i < line.size()) {
+    while (i < line.size() && SDL_isspace((unsigned char)line[i]))
+      ++i;
+    const size_t start = i;
+    while (i < line.size() && !SDL_isspace((unsigned char)line[i]))
+      ++i;
+    if (i > start)
+      words.push_back(line.substr(start, i - start));
+  }
+  return words;
+}
+
+bool ParseNumber(const std::string &word, float &out) {
+  char *end = nullptr;
+  out = std::strtof(word.c_str(), &end);
+  return end && *end == '\0' && std::isfinite(out);
+}
+
+bool ParseUint(const std::string &word, uint32_t &out,
+               unsigned long limit = UINT32_MAX) {
+  char *end = nullptr;
+  const unsigned long value = std::strtoul(word.c_str(), &end, 10);
+  out = (uint32_t)value;
+  return end && *end == '\0' && word[0] != '-' && value <= limit;
+}
+} // namespace
+
+void LevelData::Clear() {
+  types.clear();
+  textures.clear();
+  entities.clear();
+  tiles.clear();
+}
+
+bool ParseLevel(const std::string &text, const char *source, LevelData &out) {
+  out.Clear();
+  std::vector<std::string> textureNames; // by index into out.textures
+  auto findTexture = [&](const std::string &name) -> int {
+    for (size_t i = 0; i < textureNames.size(); ++i)
+      if (textureNames[i] == name)
+        return (int)i;
+    return -1;
+  };
+  auto typeIndex = [&](const std::string &name) -> uint32_t {
+    for (size_t i = 0; i < out.types.size(); ++i)
+      if (out.types[i] == name)
+        return (uint32_t)i;
+    out.types.push_back(name);
+    return (uint32_t)(out.types.size() - 1);
+  };
+
+  size_t lineStart = 0;
+  int lineNumber = 0;
+  while (lineStart < text.size()) {
+    size_t lineEnd = text.find('\n', lineStart);
+    if (lineEnd == std::string::npos)
+      lineEnd = text.size();
+    const std::vector<std::string> words =
+        SplitWords(text.substr(lineStart, lineEnd - lineStart));
+    lineStart = lineEnd + 1;
+    ++lineNumber;
+    if (words.empty() || words[0][0] == '#')
+      continue;
+
+    bool ok = false;
+    if (words[0] == "texture" && words.size() == 3) {
+      ok = words[1] != "-" && findTexture(words[1]) < 0;
+      if (ok) {
+        textureNames.push_back(words[1]);
+        out.textures.push_back(words[2]);
+      }
+    } else if (words[0] == "entity" && words.size() >= 4 &&
+               words.size() <= 8 && words.size() != 5) {
+      LevelEntity e{};
+      e.texture = LEVEL_NO_TEXTURE;
+      ok = ParseNumber(words[2], e.position.x) &&
+           ParseNumber(words[3], e.position.y);
+      if (ok && words.size() >= 6)
+        ok = ParseNumber(words[4], e.dimensions.x) &&
+             ParseNumber(words[5], e.dimensions.y) &&
+             e.dimensions.x >= 0.0f && e.dimensions.y >= 0.0f;
+      if (ok && words.size() >= 7 && words[6] != "-") {
+        const int texture = findTexture(words[6]);
+        ok = texture >= 0;
+        e.texture = (uint32_t)texture;
+      }
+      if (ok && words.size() == 8)
+        ok = ParseUint(words[7], e.param);
+      if (ok) {
+        e.type = typeIndex(words[1]);
+        out.entities.push_back(e);
+      }
+    } else if (words[0] == "tiles" && words.size() == 6) {
+      LevelTiles t{};
+      uint32_t id = 0;
+      ok = ParseUint(words[1], t.x) && ParseUint(words[2], t.y) &&
+           ParseUint(words[3], t.w) && ParseUint(words[4], t.h) &&
+           ParseUint(words[5], id, UINT16_MAX);
+      t.id = (uint16_t)id;
+      if (ok)
+        out.tiles.push_back(t);
+    }
+    if (!ok) {
+      SDL_Log("%s:%d: bad or duplicate %s", source, lineNumber,
+              words[0].c_str());
+      out.Clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+namespace {
+uint64_t AlignUp(uint64_t value) {
+  return (value + SCENE_ALIGN - 1) / SCENE_ALIGN * SCENE_ALIGN;
+}
+
+bool CheckName(const char *source, const char *what, const SceneName &name) {
+  if (name.name[SCENE_NAME_LENGTH - 1] == '\0')
+    return true;
+  SDL_Log("%s: %s name is not terminated", source, what);
+  return false;
+}
+
+// True if count records of size bytes fit at offset.
+bool Fits(size_t size, uint64_t offset, uint64_t count, size_t record) {
+  return offset % alignof(uint32_t) == 0 && offset <= size &&
+         (size - offset) / record >= count;
+}
+} // namespace
+
+bool WriteScene(const LevelData &data, const char *source,
+                std::vector<uint8_t> &out) {
+  out.clear();
+  for (const std::vector<std::string> *names : {&data.types, &data.textures})
+    for (const std::string &name : *names)
+      if (name.size() >= SCENE_NAME_LENGTH) {
+        SDL_Log("%s: %s is longer than %u bytes", source, name.c_str(),
+                SCENE_NAME_LENGTH - 1);
+        return false;
+      }
+
+  SceneHeader header{};
+  header.magic = SCENE_MAGIC;
+  header.version = SCENE_VERSION;
+  header.typeCount = (uint32_t)data.types.size();
+  header.textureCount = (uint32_t)data.textures.size();
+  header.entityCount = (uint32_t)data.entities.size();
+  header.tileCount = (uint32_t)data.tiles.size();
+  header.entitiesOffset = AlignUp(
+      sizeof(SceneHeader) +
+      sizeof(SceneName) * (uint64_t)(header.typeCount + header.textureCount));
+  header.tilesOffset = AlignUp(header.entitiesOffset +
+                               sizeof(LevelEntity) * data.entities.size());
+  // Zeroed, so padding and the unused ends of names are deterministic.
+  out.assign(header.tilesOffset + sizeof(LevelTiles) * data.tiles.size(), 0);
+
+  SDL_memcpy(out.data(), &header, sizeof(header));
+  SceneName *names = (SceneName *)(out.data() + sizeof(SceneHeader));
+  for (const std::string &type : data.types)
+    SDL_memcpy((names++)->name, type.data(), type.size());
+  for (const std::string &texture : data.textures)
+    SDL_memcpy((names++)->name, texture.data(), texture.size());
+  if (!data.entities.empty())
+    SDL_memcpy(out.data() + header.entitiesOffset, data.entities.data(),
+               sizeof(LevelEntity) * data.entities.size());
+  uint8_t *tiles = out.data() + header.tilesOffset;
+  for (const LevelTiles &t : data.tiles) {
+    // Field by field: the struct's tail padding stays zero.
+    SDL_memcpy(tiles + offsetof(LevelTiles, x), &t.x, sizeof(uint32_t) * 4);
+    SDL_memcpy(tiles + offsetof(LevelTiles, id), &t.id, sizeof(t.id));
+    tiles += sizeof(LevelTiles);
+  }
+  return true;
+}
+
+bool ReadScene(const uint8_t *bytes, size_t size, const char *source,
+               SceneView &out) {
+  out = {};
+  if (size < sizeof(SceneHeader)) {
+    SDL_Log("%s: not a scene", source);
+    return false;
+  }
+  const SceneHeader *header = (const SceneHeader *)bytes;
+  if (header->magic != SCENE_MAGIC || header->version != SCENE_VERSION) {
+    SDL_Log("%s: unsupported scene (magic %08x, version %u)", source,
+            header->magic, header->version);
+    return false;
+  }
+  const uint64_t names = (uint64_t)header->typeCount + header->textureCount;
+  if (!Fits(size, sizeof(SceneHeader), names, sizeof(SceneName)) ||
+      !Fits(size, header->entitiesOffset, header->entityCount,
+            sizeof(LevelEntity)) ||
+      !Fits(size, header->tilesOffset, header->tileCount, sizeof(LevelTiles))) {
+    SDL_Log("%s: truncated scene", source);
+    return false;
+  }
+
+  const SceneName *table = (const SceneName *)(bytes + sizeof(SceneHeader));
+  for (uint64_t i = 0; i < names; ++i)
+    if (!CheckName(source, i < header->typeCount ? "type" : "texture",
+                   table[i]))
+      return false;
+
+  out.types = table;
+  out.textures = table + header->typeCount;
+  out.entities = (const LevelEntity *)(bytes + header->entitiesOffset);
+  out.tiles = (const LevelTiles *)(bytes + header->tilesOffset);
+  out.typeCount = header->typeCount;
+  out.textureCount = header->textureCount;
+  out.entityCount = header->entityCount;
+  out.tileCount = header->tileCount;
+  return true;
+}
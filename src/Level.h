@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <vec2.h>
+
+inline constexpr uint32_t LEVEL_NO_TEXTURE = UINT32_MAX;
+
+// An entity to create, by index into its file's type and texture tables,
+// so names are looked up once per file rather than once per entity.
+struct LevelEntity {
+  uint32_t type;    // into LevelData::types
+  uint32_t texture; // into LevelData::textures, or LEVEL_NO_TEXTURE
+  vec2 position;    // world units from the level's origin
+  vec2 dimensions;  // 0 keeps the type's own size
+  uint32_t param;   // passed to Entity::OnCreated
+};
+
+// A rectangle of tiles set to one tile id, in tiles from the level's first.
+struct LevelTiles {
+  uint32_t x, y, w, h;
+  uint16_t id;
+};
+
+// Level content without engine objects: parsed off the main thread, then
+// turned into entities and tiles by whoever activates it.
+struct LevelData {
+  std::vector<std::string> types;    // entity type names
+  std::vector<std::string> textures; // texture paths
+  std::vector<LevelEntity> entities;
+  std::vector<LevelTiles> tiles;
+
+  void Clear();
+};
+
+// Reads level text, one item per line:
+//
+//   texture <name> <path>
+//   entity <type> <x> <y> [<w> <h> [<texture name> [<param>]]]
+//   tiles <x> <y> <w> <h> <tile id>
+//
+// A texture of - means none. Blank lines and lines starting with # are
+// skipped. Logs the line and returns false if one is malformed; out is
+// left empty then. Touches no engine state, so any thread can call it.
+bool ParseLevel(const std::string &text, const char *source, LevelData &out);
+
+// Binary scenes, written by tools/scene_compiler from level text. All
+// fields are little-endian. The header is followed by SceneName records
+// (types, then textures), then the LevelEntity and LevelTiles records at
+// their offsets, SCENE_ALIGN-aligned, so a loader reads them in place.
+inline constexpr uint32_t SCENE_MAGIC = 0x314e4353; // "SCN1"
+inline constexpr uint32_t SCENE_VERSION = 1;
+inline constexpr uint32_t SCENE_ALIGN = 16;
+inline constexpr uint32_t SCENE_NAME_LENGTH = 112;
+
+struct SceneHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t typeCount;
+  uint32_t textureCount;
+  uint32_t entityCount;
+  uint32_t tileCount;
+  uint64_t entitiesOffset; // from the start of the file
+  uint64_t tilesOffset;
+};
+
+struct SceneName {
+  char name[SCENE_NAME_LENGTH]; // NUL-terminated
+};
+
+static_assert(sizeof(SceneHeader) == 40, "SceneHeader layout");
+static_assert(sizeof(LevelEntity) == 28, "LevelEntity layout");
+static_assert(sizeof(LevelTiles) == 20, "LevelTiles layout");
+
+// Pointers into a scene's bytes; valid while they are.
+struct SceneView {
+  const SceneName *types = nullptr;
+  const SceneName *textures = nullptr;
+  const LevelEntity *entities = nullptr;
+  const LevelTiles *tiles = nullptr;
+  uint32_t typeCount = 0, textureCount = 0;
+  uint32_t entityCount = 0, tileCount = 0;
+};
+
+// Replaces out with data as a scene. Logs and returns false if a name is
+// too long to store.
+bool WriteScene(const LevelData &data, const char *source,
+                std::vector<uint8_t> &out);
+// Checks the header, the tables' bounds and the names, and points out at
+// them. Records aren't checked one by one; their type and texture indices
+// are checked where they're used. Logs and returns false if malformed.
+bool ReadScene(const uint8_t *bytes, size_t size, const char *source,
+               SceneView &out);
@@ -0,0 +1,333 @@
+#include "LevelStreamer.h"
+#include "GameEngine.h"
+#include "Profiler.h"
+#include <cmath>
+
+LevelStreamer::LevelStreamer(GameEngine &engine, const char *directory,
+                             float regionSize)
+    : engine(engine), directory(directory),
+      regionSize(std::max(1.0f, regionSize)) {
+  io = std::thread(&LevelStreamer::ReadLoop, this);
+}
+
+LevelStreamer::~LevelStreamer() {
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stopping = true;
+  }
+  wake.notify_all();
+  io.join();
+
+  // Their entities draw with the textures released below.
+  for (auto &[key, region] : regions)
+    if (region->state == RegionState::ACTIVE)
+      Unload(*region);
+}
+
+SDL_FRect LevelStreamer::RegionBounds(const Region &region) const {
+  return {(float)region.rx * regionSize, (float)region.ry * regionSize,
+          regionSize, regionSize};
+}
+
+// Along the larger axis, so the regions within a distance fill a square.
+float LevelStreamer::DistanceTo(const Region &region, vec2 focus) const {
+  const SDL_FRect b = RegionBounds(region);
+  const float dx = std::max({b.x - focus.x, focus.x - (b.x + b.w), 0.0f});
+  const float dy = std::max({b.y - focus.y, focus.y - (b.y + b.h), 0.0f});
+  return std::max(dx, dy);
+}
+
+bool LevelStreamer::TileRange(const Region &region, uint32_t &x0,
+                              uint32_t &y0, uint32_t &x1,
+                              uint32_t &y1) const {
+  const Tilemap *tiles = engine.GetTilemap();
+  if (!tiles)
+    return false;
+  // Both edges from the same formula, so neighbours share no tile.
+  const SDL_FRect b = RegionBounds(region);
+  const float size = tiles->GetTileSize();
+  auto edge = [&](float world, uint32_t limit) {
+    return (uint32_t)std::min((float)limit, std::floor(world / size));
+  };
+  x0 = edge(b.x, tiles->GetWidth());
+  y0 = edge(b.y, tiles->GetHeight());
+  x1 = edge(b.x + b.w, tiles->GetWidth());
+  y1 = edge(b.y + b.h, tiles->GetHeight());
+  return true;
+}
+
+void LevelStreamer::ReadLoop() {
+  PROFILE_THREAD("streaming");
+  for (;;) {
+    RegionPtr region;
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      wake.wait(guard, [&] { return stopping || !queue.empty(); });
+      if (stopping)
+        return;
+      region = std::move(queue.front());
+      queue.pop_front();
+      if (region->state != RegionState::QUEUED)
+        continue; // dropped while queued
+      region->state = RegionState::READING;
+    }
+
+    LevelData data;
+    {
+      PROFILE_SCOPE("LevelStreamer::Read");
+      const std::string path = directory + "/" + std::to_string(region->rx) +
+                               "_" + std::to_string(region->ry) + ".region";
+      size_t size = 0;
+      // No file is an empty region.
+      if (void *bytes = SDL_LoadFile(path.c_str(), &size)) {
+        ParseLevel(std::string((const char *)bytes, size), path.c_str(),
+                   data);
+        SDL_free(bytes);
+      }
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (region->state != RegionState::READING)
+      continue;
+    region->data = std::move(data);
+    region->state = RegionState::PARSED;
+    parsed.push_back(std::move(region));
+  }
+}
+
+void LevelStreamer::Resolve(Region &region) {
+  const LevelData &data = region.data;
+  std::vector<uint32_t> types(data.types.size());
+  for (size_t i = 0; i < types.size(); ++i) {
+    types[i] = engine.FindEntityType(data.types[i].c_str());
+    if (types[i] == ENTITY_TYPE_NONE)
+      SDL_Log("Region %d,%d: unknown entity type %s", region.rx, region.ry,
+              data.types[i].c_str());
+  }
+
+  const SDL_FRect b = RegionBounds(region);
+  region.descs.clear();
+  region.descs.reserve(data.entities.size());
+  region.bytes = 0;
+  for (const LevelEntity &e : data.entities) {
+    const uint32_t type = types[e.type];
+    if (type == ENTITY_TYPE_NONE)
+      continue;
+    SDL_Texture *texture = e.texture < region.textures.size()
+                               ? region.textures[e.texture].Get()
+                               : nullptr;
+    region.descs.push_back(
+        {.type = type,
+         .position = {.x = b.x + e.position.x, .y = b.y + e.position.y},
+         .dimensions = e.dimensions,
+         .texture = texture,
+         .param = e.param});
+    region.bytes += engine.GetEntityTypeSize(type) + sizeof(EntityHandle);
+  }
+  for (const LevelTiles &t : data.tiles)
+    region.bytes += (size_t)t.w * t.h * sizeof(uint16_t);
+}
+
+bool LevelStreamer::Activate(Region &region) {
+  PROFILE_SCOPE("LevelStreamer::Activate");
+  if (!region.tilesSet) {
+    region.tilesSet = true;
+    uint32_t x0, y0, x1, y1;
+    if (TileRange(region, x0, y0, x1, y1)) {
+      Tilemap *tiles = engine.GetTilemap();
+      for (const LevelTiles &t : region.data.tiles) {
+        // Clipped to the region, so it never writes over a neighbour.
+        const uint64_t x = (uint64_t)x0 + t.x, y = (uint64_t)y0 + t.y;
+        if (x >= x1 || y >= y1)
+          continue;
+        tiles->Fill((uint32_t)x, (uint32_t)y,
+                    (uint32_t)std::min<uint64_t>(t.w, x1 - x),
+                    (uint32_t)std::min<uint64_t>(t.h, y1 - y), t.id);
+      }
+    } else if (!region.data.tiles.empty()) {
+      SDL_Log("Region %d,%d: tiles skipped, there is no tilemap", region.rx,
+              region.ry);
+    }
+  }
+
+  const size_t count =
+      std::min(spawnsPerFrame, region.descs.size() - region.created);
+  region.entities.resize(region.created + count);
+  engine.CreateEntities(region.descs.data() + region.created, count,
+                        region.entities.data() + region.created);
+  region.created += count;
+  return region.created == region.descs.size();
+}
+
+void LevelStreamer::Unload(Region &region) {
+  PROFILE_SCOPE("LevelStreamer::Unload");
+  for (EntityHandle handle : region.entities)
+    engine.Despawn(handle); // stale if it's gone already
+  uint32_t x0, y0, x1, y1;
+  if (!region.data.tiles.empty() && TileRange(region, x0, y0, x1, y1))
+    engine.GetTilemap()->Fill(x0, y0, x1 - x0, y1 - y0, 0);
+  region.data.Clear();
+  region.droppedTick = engine.GetTick();
+}
+
+void LevelStreamer::Update(vec2 focus) {
+  PROFILE_SCOPE("LevelStreamer::Update");
+  // Regions the load distance reaches; the world starts at (0, 0).
+  auto first = [&](float world) {
+    return std::max(0, (int32_t)std::floor(world / regionSize));
+  };
+  auto last = [&](float world) {
+    return (int32_t)std::min(std::floor(world / regionSize), 1e9f);
+  };
+  const int32_t rx0 = first(focus.x - loadDistance);
+  const int32_t ry0 = first(focus.y - loadDistance);
+  const int32_t rx1 = last(focus.x + loadDistance);
+  const int32_t ry1 = last(focus.y + loadDistance);
+
+  requested.clear();
+  farthest.clear();
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    for (int32_t ry = ry0; ry <= ry1; ++ry) {
+      for (int32_t rx = rx0; rx <= rx1; ++rx) {
+        RegionPtr &slot = regions[Key(rx, ry)];
+        if (slot)
+          continue;
+        slot = std::make_shared<Region>();
+        slot->rx = rx;
+        slot->ry = ry;
+        requested.push_back(slot);
+      }
+    }
+    // Nearest first.
+    std::sort(requested.begin(), requested.end(),
+              [&](const RegionPtr &a, const RegionPtr &b) {
+                return DistanceTo(*a, focus) < DistanceTo(*b, focus);
+              });
+    queue.insert(queue.end(), requested.begin(), requested.end());
+
+    // Not yet created and out of reach: forget it. Created ones only go
+    // when over budget, below.
+    RegionPtr ready;
+    for (auto it = regions.begin(); it != regions.end();) {
+      const RegionPtr &region = it->second;
+      const float distance = DistanceTo(*region, focus);
+      if (distance > keepDistance) {
+        if (region->state != RegionState::ACTIVE) {
+          region->state = RegionState::DROPPED;
+          it = regions.erase(it);
+          continue;
+        }
+        if (region != activating)
+          farthest.push_back(region);
+      } else if (!activating && region->state == RegionState::READY &&
+                 (!ready || distance < DistanceTo(*ready, focus))) {
+        ready = region;
+      }
+      ++it;
+    }
+    if (ready) {
+      ready->state = RegionState::ACTIVE;
+      stats.residentBytes += ready->bytes;
+      ++stats.residentRegions;
+      activating = std::move(ready);
+    }
+  }
+  if (!requested.empty())
+    wake.notify_one();
+
+  if (activating) {
+    const Uint64 start = SDL_GetTicksNS();
+    const bool done = Activate(*activating);
+    const double ms = (double)(SDL_GetTicksNS() - start) / SDL_NS_PER_MS;
+    activating->activationMs += ms;
+    std::lock_guard<std::mutex> guard(lock);
+    stats.worstStallMs = std::max(stats.worstStallMs, ms);
+    if (done && (activating->created > 0 || activating->bytes > 0)) {
+      ++stats.activations;
+      stats.lastActivationMs = activating->activationMs;
+      SDL_Log("Region %d,%d: %zu entities in %.2f ms, %.1f MB resident",
+              activating->rx, activating->ry, activating->created,
+              activating->activationMs,
+              (double)stats.residentBytes / (1024.0 * 1024.0));
+    }
+    if (done) {
+      // Only the tiles are needed again, to clear them.
+      activating->data.entities = {};
+      activating->data.types = {};
+      activating->descs = {};
+      activating.reset();
+    }
+  }
+
+  // Farthest first, until back under budget. Empty regions cost nothing
+  // to bring back, so they always go.
+  std::sort(farthest.begin(), farthest.end(),
+            [&](const RegionPtr &a, const RegionPtr &b) {
+              return DistanceTo(*a, focus) > DistanceTo(*b, focus);
+            });
+  for (const RegionPtr &region : farthest) {
+    if (region->bytes > 0 && stats.residentBytes <= memoryBudget)
+      continue;
+    Unload(*region);
+    std::lock_guard<std::mutex> guard(lock);
+    region->state = RegionState::DROPPED;
+    regions.erase(Key(region->rx, region->ry));
+    stats.residentBytes -= region->bytes;
+    --stats.residentRegions;
+    ++stats.unloads;
+  }
+}
+
+void LevelStreamer::UpdateResources(uint64_t drawnTick) {
+  PROFILE_SCOPE("LevelStreamer::UpdateResources");
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    fresh.swap(parsed);
+  }
+  for (RegionPtr &region : fresh) {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      if (region->state != RegionState::PARSED)
+        continue;
+      region->state = RegionState::TEXTURES;
+    }
+    ResourceManager *resources = engine.GetResources();
+    region->textures.reserve(region->data.textures.size());
+    for (const std::string &path : region->data.textures)
+      region->textures.push_back(resources->LoadAsync(path));
+    holding.push_back(std::move(region));
+  }
+  fresh.clear();
+
+  for (size_t i = 0; i < holding.size();) {
+    Region &region = *holding[i];
+    RegionState state;
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      state = region.state;
+    }
+    if (state == RegionState::TEXTURES &&
+        std::none_of(region.textures.begin(), region.textures.end(),
+                     [](const TextureHandle &h) { return h.IsPending(); })) {
+      Resolve(region);
+      std::lock_guard<std::mutex> guard(lock);
+      if (region.state == RegionState::TEXTURES)
+        region.state = RegionState::READY;
+    } else if (state == RegionState::DROPPED &&
+               (region.created == 0 || region.droppedTick < drawnTick)) {
+      region.textures.clear();
+      holding[i] = std::move(holding.back());
+      holding.pop_back();
+      continue;
+    }
+    ++i;
+  }
+}
+
+StreamStats LevelStreamer::GetStats() {
+  std::lock_guard<std::mutex> guard(lock);
+  StreamStats out = stats;
+  out.pendingRegions = (uint32_t)(regions.size() - stats.residentRegions);
+  return out;
+}
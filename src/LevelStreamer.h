@@ -0,0 +1,142 @@
+#pragma once
+#include "Config.h"
+#include "Entity.h"
+#include "Level.h"
+#include "ResourceManager.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <vec2.h>
+
+class GameEngine;
+
+// Streaming counters, cumulative since the streamer was created.
+struct StreamStats {
+  uint32_t residentRegions = 0; // active or being activated
+  uint32_t pendingRegions = 0;  // reading, or waiting for textures
+  size_t residentBytes = 0;     // estimated, of the resident regions
+  uint64_t activations = 0;
+  uint64_t unloads = 0;
+  double lastActivationMs = 0.0; // stall the last region cost, all slices
+  double worstStallMs = 0.0;     // longest single frame-boundary stall
+};
+
+// Splits the world into square regions of regionSize world units, starting
+// at (0, 0), and keeps those near the focus resident. Region (rx, ry) is
+// the level text <directory>/<rx>_<ry>.region (see ParseLevel; a missing
+// file is an empty region), with positions relative to the region's corner
+// and tiles relative to its first tile.
+//
+// A background thread reads and parses regions, nearest first, as the
+// focus comes within cfg::STREAM_LOAD_DISTANCE. Their textures then load
+// through the ResourceManager, and once ready the region is created at
+// frame boundaries, cfg::STREAM_SPAWNS_PER_FRAME entities at a time.
+// While the resident regions' estimated memory exceeds the budget, those
+// beyond cfg::STREAM_KEEP_DISTANCE are unloaded, farthest first: the
+// entities they created are despawned wherever they went, their tiles are
+// cleared, and their textures released.
+class LevelStreamer {
+private:
+  enum class RegionState {
+    QUEUED,   // waiting for the I/O thread
+    READING,  // being read and parsed
+    PARSED,   // waiting for the main thread to request textures
+    TEXTURES, // textures loading
+    READY,    // waiting for a frame boundary
+    ACTIVE,   // created, or being created
+    DROPPED,  // cancelled or unloaded; textures go on the main thread
+  };
+
+  struct Region {
+    int32_t rx, ry;
+    RegionState state = RegionState::QUEUED; // guarded by lock
+    LevelData data;                          // until activated
+    std::vector<TextureHandle> textures;     // main thread only
+    std::vector<EntityDesc> descs;           // built with the textures
+    std::vector<EntityHandle> entities;      // created so far
+    size_t created = 0;                      // descs done
+    bool tilesSet = false;
+    size_t bytes = 0; // estimated with the descs
+    double activationMs = 0.0;
+    uint64_t droppedTick = 0; // engine tick when its entities went
+  };
+  using RegionPtr = std::shared_ptr<Region>;
+
+  GameEngine &engine;
+  std::string directory;
+  float regionSize;
+  float loadDistance = cfg::STREAM_LOAD_DISTANCE;
+  float keepDistance = cfg::STREAM_KEEP_DISTANCE;
+  size_t memoryBudget = cfg::STREAM_MEMORY_BUDGET;
+  size_t spawnsPerFrame = cfg::STREAM_SPAWNS_PER_FRAME;
+
+  std::mutex lock; // regions, queue, states and stats
+  std::condition_variable wake;
+  std::unordered_map<uint64_t, RegionPtr> regions; // not yet dropped
+  std::deque<RegionPtr> queue;                     // for the I/O thread
+  std::vector<RegionPtr> parsed;                   // for the main thread
+  bool stopping = false;
+  std::thread io;
+  StreamStats stats;
+
+  RegionPtr activating;             // simulation thread
+  std::vector<RegionPtr> requested; // simulation thread, Update scratch
+  std::vector<RegionPtr> farthest;  // simulation thread, Update scratch
+  std::vector<RegionPtr> holding;   // main thread: regions with textures
+  std::vector<RegionPtr> fresh;     // main thread, UpdateResources scratch
+
+  static uint64_t Key(int32_t rx, int32_t ry) {
+    return ((uint64_t)(uint32_t)ry << 32) | (uint32_t)rx;
+  }
+  SDL_FRect RegionBounds(const Region &region) const;
+  float DistanceTo(const Region &region, vec2 focus) const;
+
+  void ReadLoop();
+  // Builds descs from the loaded textures (main thread).
+  void Resolve(Region &region);
+  // Creates the next slice of the region; true once it's all there.
+  bool Activate(Region &region);
+  void Unload(Region &region);
+  // The region's tiles, [x0, x1) x [y0, y1); false without a tilemap.
+  bool TileRange(const Region &region, uint32_t &x0, uint32_t &y0,
+                 uint32_t &x1, uint32_t &y1) const;
+
+public:
+  LevelStreamer(GameEngine &engine, const char *directory, float regionSize);
+  // Joins the I/O thread, unloads the resident regions (their entities and
+  // tiles go with them), and releases the textures it holds. Between
+  // frames, like Despawn.
+  ~LevelStreamer();
+
+  LevelStreamer(const LevelStreamer &) = delete;
+  LevelStreamer &operator=(const LevelStreamer &) = delete;
+
+  void SetDistances(float load, float keep) {
+    loadDistance = load;
+    keepDistance = std::max(load, keep);
+  }
+  void SetMemoryBudget(size_t bytes) { memoryBudget = bytes; }
+  void SetSpawnsPerFrame(size_t count) {
+    spawnsPerFrame = std::max<size_t>(1, count);
+  }
+  float GetRegionSize() const { return regionSize; }
+
+  // Between ticks, on the thread that runs Step: requests regions near
+  // focus, creates the next slice of one that's ready, and unloads far
+  // ones while over budget.
+  void Update(vec2 focus);
+  // On the main thread: starts loading the textures of parsed regions,
+  // hands over regions whose textures are in, and releases the textures of
+  // regions dropped before drawnTick (the newest tick drawn).
+  void UpdateResources(uint64_t drawnTick);
+
+  StreamStats GetStats();
+};
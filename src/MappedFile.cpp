@@ -0,0 +1,96 @@
+#include "MappedFile.h"
+#include <SDL3/SDL.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() { Close(); }
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const char *path) {
+  Close();
+  HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                         OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (f == INVALID_HANDLE_VALUE) {
+    SDL_Log("Failed to open %s", path);
+    return false;
+  }
+  LARGE_INTEGER length;
+  if (!GetFileSizeEx(f, &length) || length.QuadPart == 0) {
+    SDL_Log("Failed to map %s: empty file", path);
+    CloseHandle(f);
+    return false;
+  }
+  HANDLE m = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  void *view = m ? MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0) : nullptr;
+  if (!view) {
+    SDL_Log("Failed to map %s", path);
+    if (m)
+      CloseHandle(m);
+    CloseHandle(f);
+    return false;
+  }
+  file = f;
+  mapping = m;
+  data = (const uint8_t *)view;
+  size = (size_t)length.QuadPart;
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data)
+    UnmapViewOfFile(data);
+  if (mapping)
+    CloseHandle((HANDLE)mapping);
+  if (file)
+    CloseHandle((HANDLE)file);
+  data = nullptr;
+  mapping = nullptr;
+  file = nullptr;
+  size = 0;
+}
+
+#else
+
+bool MappedFile::Open(const char *path) {
+  Close();
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    SDL_Log("Failed to open %s", path);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    SDL_Log("Failed to map %s: empty file", path);
+    close(fd);
+    return false;
+  }
+  void *view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); // the mapping keeps the file alive
+  if (view == MAP_FAILED) {
+    SDL_Log("Failed to map %s", path);
+    return false;
+  }
+  // Start readahead now; textures are created from it right after.
+  madvise(view, (size_t)st.st_size, MADV_WILLNEED);
+  data = (const uint8_t *)view;
+  size = (size_t)st.st_size;
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data)
+    munmap((void *)data, size);
+  data = nullptr;
+  size = 0;
+}
+
+#endif
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Read-only memory mapping of a whole file. Pages are loaded by the OS on
+// first touch, so opening is cheap and the data is never copied into the
+// process heap.
+class MappedFile {
+private:
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+#ifdef _WIN32
+  void *file = nullptr;
+  void *mapping = nullptr;
+#endif
+
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  // Maps path, replacing any previous mapping. Logs and returns false on
+  // failure (missing or empty file).
+  bool Open(const char *path);
+  void Close();
+
+  bool IsOpen() const { return data != nullptr; }
+  const uint8_t *Data() const { return data; }
+  size_t Size() const { return size; }
+};
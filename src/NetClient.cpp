@@ -0,0 +1,296 @@
+#include "NetClient.h"
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+NetClient::NetClient() : history(cfg::NET_SNAPSHOT_HISTORY) {
+  conditioner.Attach(&socket);
+}
+
+NetClient::~NetClient() { Disconnect(); }
+
+bool NetClient::Connect(const NetAddress &address, uint64_t nowNS) {
+  Disconnect();
+  if (!socket.Open(0))
+    return false;
+
+  server = address;
+  state = NetClientState::CONNECTING;
+  // Tells this connection attempt apart from an earlier one on the same port.
+  nonce = (uint32_t)(nowNS ^ (nowNS >> 32)) ^
+          ((uint32_t)socket.GetPort() << 16);
+  clientId = -1;
+  lastHeardNS = nowNS;
+  for (Snapshot &s : history)
+    s.sequence = 0;
+  for (Assembly &a : assemblies)
+    a.sequence = 0;
+  latestSequence = 0;
+  latestTick = 0;
+  inputCount = 0;
+  clockStarted = false;
+  SendConnect(nowNS);
+  return true;
+}
+
+void NetClient::Disconnect() {
+  if (state == NetClientState::CONNECTED) {
+    packet.clear();
+    NetWriter out(packet);
+    out.Header(NetMessage::DISCONNECT);
+    out.U8((uint8_t)clientId);
+    // Straight out: anything still delayed is dropped with the socket.
+    socket.Send(server, packet.data(), packet.size());
+  }
+  conditioner.Clear();
+  socket.Close();
+  state = NetClientState::DISCONNECTED;
+}
+
+void NetClient::SendConnect(uint64_t nowNS) {
+  packet.clear();
+  NetWriter out(packet);
+  out.Header(NetMessage::CONNECT);
+  out.U32(nonce);
+  conditioner.Send(server, packet.data(), packet.size(), nowNS);
+  lastConnectNS = nowNS;
+}
+
+void NetClient::SendInput(uint32_t tick, uint32_t buttons, uint64_t nowNS) {
+  if (state == NetClientState::CONNECTING &&
+      nowNS - lastConnectNS >=
+          (uint64_t)(cfg::NET_CONNECT_RETRY_MS * (double)SDL_NS_PER_MS)) {
+    SendConnect(nowNS);
+  }
+  if (state != NetClientState::CONNECTED) {
+    conditioner.Flush(nowNS);
+    return;
+  }
+
+  const int keep = std::min(inputCount + 1, cfg::NET_INPUT_REDUNDANCY);
+  for (int i = keep - 1; i > 0; --i)
+    inputs[i] = inputs[i - 1];
+  inputs[0] = {.tick = tick, .buttons = buttons};
+  inputCount = keep;
+
+  packet.clear();
+  NetWriter out(packet);
+  out.Header(NetMessage::INPUT);
+  out.U8((uint8_t)clientId);
+  out.VarU(latestSequence);
+  out.U8((uint8_t)inputCount);
+  for (int i = 0; i < inputCount; ++i) {
+    out.VarU(inputs[i].tick);
+    out.VarU(inputs[i].buttons);
+  }
+  conditioner.Send(server, packet.data(), packet.size(), nowNS);
+  conditioner.Flush(nowNS);
+  stats.bytesSent += packet.size();
+  ++stats.packetsSent;
+}
+
+void NetClient::ReceivePackets(uint64_t nowNS) {
+  if (!socket.IsOpen())
+    return;
+  conditioner.Flush(nowNS);
+  NetAddress from;
+  int size;
+  while ((size = socket.Receive(from, receiveBuffer, sizeof(receiveBuffer))) >
+         0) {
+    if (from == server)
+      HandlePacket(receiveBuffer, (size_t)size, nowNS);
+  }
+
+  if (state == NetClientState::CONNECTED &&
+      nowNS - lastHeardNS >
+          (uint64_t)(cfg::NET_TIMEOUT_MS * (double)SDL_NS_PER_MS)) {
+    SDL_Log("Connection to server timed out");
+    Disconnect();
+  }
+}
+
+void NetClient::HandlePacket(const uint8_t *data, size_t size,
+                             uint64_t nowNS) {
+  NetReader in(data, size);
+  const NetMessage type = in.Header();
+  if (type == NetMessage::ACCEPT || type == NetMessage::REJECT) {
+    const uint32_t replyNonce = in.U32();
+    if (!in.Ok() || replyNonce != nonce ||
+        state != NetClientState::CONNECTING)
+      return;
+    if (type == NetMessage::REJECT) {
+      state = NetClientState::REJECTED;
+      return;
+    }
+    clientId = in.U8();
+    tickRate = in.U16();
+    if (!in.Ok())
+      return;
+    state = NetClientState::CONNECTED;
+    lastHeardNS = nowNS;
+    return;
+  }
+  if (type != NetMessage::SNAPSHOT || state != NetClientState::CONNECTED)
+    return;
+  lastHeardNS = nowNS;
+  stats.bytesReceived += size;
+  ++stats.packetsReceived;
+  HandleFragment(in);
+}
+
+void NetClient::HandleFragment(NetReader &in) {
+  const uint32_t sequence = in.VarU();
+  const int index = in.U8();
+  const int count = in.U8();
+  if (!in.Ok() || sequence == 0 || count == 0 || index >= count)
+    return;
+  // Too old to be useful, or already decoded.
+  if (latestSequence >= sequence &&
+      latestSequence - sequence >= history.size() - 1)
+    return;
+  if (history[sequence % history.size()].sequence == sequence)
+    return;
+
+  const size_t payload = in.Remaining();
+  if (payload > NET_FRAGMENT_PAYLOAD ||
+      (index < count - 1 && payload != NET_FRAGMENT_PAYLOAD))
+    return;
+
+  Assembly &a = assemblies[sequence % ASSEMBLY_SLOTS];
+  if (a.sequence != sequence) {
+    if (a.sequence > sequence)
+      return; // the slot already holds something newer
+    a.sequence = sequence;
+    a.count = count;
+    a.missing = count;
+    a.lastSize = 0;
+    a.received.assign((size_t)count, 0);
+    a.bytes.resize((size_t)count * NET_FRAGMENT_PAYLOAD);
+  }
+  if (a.count != count || a.received[index])
+    return;
+  a.received[index] = 1;
+  --a.missing;
+  memcpy(a.bytes.data() + (size_t)index * NET_FRAGMENT_PAYLOAD, in.Cursor(),
+         payload);
+  if (index == count - 1)
+    a.lastSize = payload;
+
+  if (a.missing == 0) {
+    const size_t size = (size_t)(count - 1) * NET_FRAGMENT_PAYLOAD + a.lastSize;
+    Decode(a.bytes.data(), size, sequence);
+    a.sequence = 0;
+  }
+}
+
+void NetClient::Decode(const uint8_t *body, size_t size, uint32_t sequence) {
+  uint32_t tick, baselineSequence;
+  if (!PeekSnapshot(body, size, tick, baselineSequence))
+    return;
+  const std::vector<NetEntityState> *baseline = nullptr;
+  if (baselineSequence) {
+    const Snapshot &b = history[baselineSequence % history.size()];
+    if (b.sequence != baselineSequence) {
+      ++stats.undecodable;
+      return;
+    }
+    baseline = &b.states;
+  }
+  if (!DecodeSnapshot(body, size, baseline, decodeScratch)) {
+    ++stats.undecodable;
+    return;
+  }
+
+  Snapshot &slot = history[sequence % history.size()];
+  slot.sequence = sequence;
+  slot.tick = tick;
+  slot.states.swap(decodeScratch);
+  ++stats.snapshots;
+  if (!baseline)
+    ++stats.fullSnapshots;
+  if (sequence > latestSequence) {
+    latestSequence = sequence;
+    latestTick = tick;
+  }
+}
+
+bool NetClient::Interpolate(uint64_t nowNS,
+                            std::vector<NetInterpolatedState> &out) {
+  out.clear();
+  if (latestSequence == 0)
+    return false;
+
+  // The render clock runs at the server's tick rate and is nudged towards
+  // the target instead of jumping with every snapshot, so motion stays
+  // smooth when snapshots arrive unevenly.
+  const double rate = tickRate > 0 ? tickRate : cfg::TICK_RATE;
+  const double target = (double)latestTick - cfg::NET_INTERP_TICKS;
+  if (!clockStarted) {
+    renderTick = target;
+    clockStarted = true;
+  } else {
+    renderTick +=
+        (double)(nowNS - lastInterpolateNS) / SDL_NS_PER_SECOND * rate;
+    const double error = target - renderTick;
+    if (std::fabs(error) > 4.0 * cfg::NET_INTERP_TICKS)
+      renderTick = target;
+    else
+      renderTick += error * 0.05;
+  }
+  lastInterpolateNS = nowNS;
+  if (renderTick >= (double)latestTick) {
+    renderTick = (double)latestTick;
+    ++starvedFrames;
+  }
+
+  // The snapshots just before and after the render time.
+  const Snapshot *from = nullptr, *to = nullptr;
+  for (const Snapshot &s : history) {
+    if (s.sequence == 0 || latestSequence - s.sequence >= history.size())
+      continue;
+    if ((double)s.tick <= renderTick) {
+      if (!from || s.tick > from->tick)
+        from = &s;
+    } else if (!to || s.tick < to->tick) {
+      to = &s;
+    }
+  }
+  if (!from) {
+    from = to; // render time is older than anything held
+    to = nullptr;
+  }
+  const float alpha =
+      to ? (float)((renderTick - from->tick) / (double)(to->tick - from->tick))
+         : 0.0f;
+
+  out.reserve(from->states.size());
+  size_t j = 0;
+  for (const NetEntityState &a : from->states) {
+    NetInterpolatedState s;
+    s.index = a.index;
+    s.generation = a.generation;
+    s.typeTag = a.typeTag;
+    s.flags = a.flags;
+    s.position = {.x = NetDequantize(a.x), .y = NetDequantize(a.y)};
+    s.dimensions = {.x = NetDequantize(a.w), .y = NetDequantize(a.h)};
+    s.velocity = {.x = NetDequantize(a.vx), .y = NetDequantize(a.vy)};
+    if (to) {
+      while (j < to->states.size() && to->states[j].index < a.index)
+        ++j;
+      if (j < to->states.size() && to->states[j].index == a.index &&
+          to->states[j].generation == a.generation) {
+        const NetEntityState &b = to->states[j];
+        const vec2 next = {.x = NetDequantize(b.x), .y = NetDequantize(b.y)};
+        const vec2 delta = sub(next, s.position);
+        // Teleports aren't smeared across the gap.
+        if (dot(delta, delta) <
+            cfg::INTERPOLATION_SNAP * cfg::INTERPOLATION_SNAP) {
+          s.position = add(s.position, mul(alpha, delta));
+        }
+      }
+    }
+    out.push_back(s);
+  }
+  return true;
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include "NetProtocol.h"
+#include "NetSocket.h"
+#include "vec2.h"
+#include <cstdint>
+#include <vector>
+
+enum class NetClientState { DISCONNECTED, CONNECTING, CONNECTED, REJECTED };
+
+// An entity as the client should draw it this frame.
+struct NetInterpolatedState {
+  uint32_t index = 0;
+  uint32_t generation = 0;
+  uint32_t typeTag = 0;
+  uint8_t flags = 0;
+  vec2 position;
+  vec2 dimensions;
+  vec2 velocity;
+};
+
+// Remote side of replication. Sends its input every tick (repeating the last
+// few, so a lost datagram costs nothing) along with the newest snapshot it
+// decoded, and renders cfg::NET_INTERP_TICKS behind the server by
+// interpolating between the two snapshots around that time.
+//
+// Per frame: ReceivePackets, SendInput, then Interpolate.
+class NetClient {
+private:
+  struct Snapshot {
+    uint32_t sequence = 0; // 0 = empty slot
+    uint32_t tick = 0;
+    std::vector<NetEntityState> states; // sorted by index
+  };
+  // Fragments of one snapshot still arriving.
+  struct Assembly {
+    uint32_t sequence = 0;
+    int count = 0;
+    int missing = 0;
+    size_t lastSize = 0;
+    std::vector<uint8_t> received; // per fragment
+    std::vector<uint8_t> bytes;    // fragment f at f * NET_FRAGMENT_PAYLOAD
+  };
+
+  NetSocket socket;
+  NetConditioner conditioner;
+  NetAddress server;
+  NetClientState state = NetClientState::DISCONNECTED;
+  uint32_t nonce = 0;
+  int clientId = -1;
+  int tickRate = 0;
+  uint64_t lastConnectNS = 0;
+  uint64_t lastHeardNS = 0;
+
+  std::vector<Snapshot> history; // ring, slot = sequence % size
+  // A few in flight at once, since jitter interleaves snapshots.
+  static constexpr uint32_t ASSEMBLY_SLOTS = 4;
+  Assembly assemblies[ASSEMBLY_SLOTS]; // slot = sequence % ASSEMBLY_SLOTS
+  uint32_t latestSequence = 0;
+  uint32_t latestTick = 0;
+  std::vector<NetEntityState> decodeScratch;
+
+  NetInput inputs[cfg::NET_INPUT_REDUNDANCY]; // newest first
+  int inputCount = 0;
+
+  double renderTick = 0.0;
+  uint64_t lastInterpolateNS = 0;
+  bool clockStarted = false;
+  uint64_t starvedFrames = 0;
+
+  NetTrafficStats stats;
+  std::vector<uint8_t> packet;
+  uint8_t receiveBuffer[cfg::NET_MAX_PACKET];
+
+  void HandlePacket(const uint8_t *data, size_t size, uint64_t nowNS);
+  void HandleFragment(NetReader &in);
+  void Decode(const uint8_t *body, size_t size, uint32_t sequence);
+  void SendConnect(uint64_t nowNS);
+
+public:
+  NetClient();
+  ~NetClient();
+
+  NetClient(const NetClient &) = delete;
+  NetClient &operator=(const NetClient &) = delete;
+
+  // Opens a local socket and starts connecting; ReceivePackets completes it.
+  bool Connect(const NetAddress &server, uint64_t nowNS);
+  // Tells the server (once, unreliably) and closes the socket.
+  void Disconnect();
+
+  // Applied to everything the client sends.
+  void SetConditions(const NetConditions &conditions, uint32_t seed = 1) {
+    conditioner.SetConditions(conditions, seed);
+  }
+
+  void ReceivePackets(uint64_t nowNS);
+  // Input for the given local tick; also carries the ack. While connecting
+  // it retries the connect request instead.
+  void SendInput(uint32_t tick, uint32_t buttons, uint64_t nowNS);
+
+  // States at the render time, which advances with nowNS and is pulled
+  // towards the newest snapshot's tick minus cfg::NET_INTERP_TICKS. Returns
+  // false until a snapshot has arrived.
+  bool Interpolate(uint64_t nowNS, std::vector<NetInterpolatedState> &out);
+
+  NetClientState GetState() const { return state; }
+  int GetClientId() const { return clientId; }
+  uint32_t GetLatestTick() const { return latestTick; }
+  // Frames that reached the newest snapshot and had to hold it.
+  uint64_t GetStarvedFrames() const { return starvedFrames; }
+  const NetTrafficStats &GetStats() const { return stats; }
+};
@@ -0,0 +1,324 @@
+#include "NetProtocol.h"
+#include <cstring>
+
+// Which fields of an entity follow its mask byte in a snapshot.
+enum NetStateField : uint8_t {
+  NET_FIELD_NEW = 1u << 0, // generation and tag follow; others are absolute
+  NET_FIELD_X = 1u << 1,
+  NET_FIELD_Y = 1u << 2,
+  NET_FIELD_SIZE = 1u << 3,
+  NET_FIELD_VELOCITY = 1u << 4,
+  NET_FIELD_FLAGS = 1u << 5,
+};
+
+NetEntityState CaptureNetState(const Entity *entity) {
+  NetEntityState s;
+  s.index = entity->GetHandle().index;
+  s.generation = entity->GetHandle().generation;
+  s.typeTag = entity->typeTag;
+  s.flags = (entity->isVisible ? NET_STATE_VISIBLE : 0) |
+            (entity->sleeping ? NET_STATE_SLEEPING : 0) |
+            (entity->grounded ? NET_STATE_GROUNDED : 0);
+  s.x = NetQuantize(entity->position.x);
+  s.y = NetQuantize(entity->position.y);
+  s.w = NetQuantize(entity->dimensions.x);
+  s.h = NetQuantize(entity->dimensions.y);
+  s.vx = NetQuantize(entity->velocity.x);
+  s.vy = NetQuantize(entity->velocity.y);
+  return s;
+}
+
+void NetWriter::U16(uint16_t v) {
+  out.push_back((uint8_t)v);
+  out.push_back((uint8_t)(v >> 8));
+}
+
+void NetWriter::U32(uint32_t v) {
+  for (int i = 0; i < 4; ++i)
+    out.push_back((uint8_t)(v >> (8 * i)));
+}
+
+void NetWriter::VarU(uint32_t v) {
+  while (v >= 0x80) {
+    out.push_back((uint8_t)(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back((uint8_t)v);
+}
+
+void NetWriter::VarS(int32_t v) {
+  VarU(((uint32_t)v << 1) ^ (uint32_t)(v >> 31));
+}
+
+void NetWriter::Bytes(const void *data, size_t size) {
+  const uint8_t *bytes = (const uint8_t *)data;
+  out.insert(out.end(), bytes, bytes + size);
+}
+
+void NetWriter::Header(NetMessage type) {
+  U16(NET_MAGIC);
+  U8(NET_VERSION);
+  U8((uint8_t)type);
+}
+
+uint8_t NetReader::U8() {
+  if (cursor >= end) {
+    ok = false;
+    return 0;
+  }
+  return *cursor++;
+}
+
+uint16_t NetReader::U16() {
+  const uint16_t lo = U8();
+  return (uint16_t)(lo | (U8() << 8));
+}
+
+uint32_t NetReader::U32() {
+  uint32_t v = 0;
+  for (int i = 0; i < 4; ++i)
+    v |= (uint32_t)U8() << (8 * i);
+  return v;
+}
+
+uint32_t NetReader::VarU() {
+  uint32_t v = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    const uint8_t byte = U8();
+    v |= (uint32_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return v;
+  }
+  ok = false; // more than 5 bytes
+  return 0;
+}
+
+int32_t NetReader::VarS() {
+  const uint32_t v = VarU();
+  return (int32_t)((v >> 1) ^ (~(v & 1) + 1));
+}
+
+NetMessage NetReader::Header() {
+  const uint16_t magic = U16();
+  const uint8_t version = U8();
+  const uint8_t type = U8();
+  if (!ok || magic != NET_MAGIC || version != NET_VERSION)
+    return NetMessage(0);
+  return NetMessage(type);
+}
+
+// Differences wrap instead of overflowing; decoding wraps back.
+static int32_t Diff(int32_t a, int32_t b) {
+  return (int32_t)((uint32_t)a - (uint32_t)b);
+}
+static int32_t Apply(int32_t base, int32_t diff) {
+  return (int32_t)((uint32_t)base + (uint32_t)diff);
+}
+
+static uint8_t ChangedFields(const NetEntityState &base,
+                             const NetEntityState &s) {
+  uint8_t mask = 0;
+  if (s.x != base.x)
+    mask |= NET_FIELD_X;
+  if (s.y != base.y)
+    mask |= NET_FIELD_Y;
+  if (s.w != base.w || s.h != base.h)
+    mask |= NET_FIELD_SIZE;
+  if (s.vx != base.vx || s.vy != base.vy)
+    mask |= NET_FIELD_VELOCITY;
+  if (s.flags != base.flags)
+    mask |= NET_FIELD_FLAGS;
+  return mask;
+}
+
+static void WriteFields(const NetEntityState &base, const NetEntityState &s,
+                        uint8_t mask, NetWriter &out) {
+  out.U8(mask);
+  if (mask & NET_FIELD_NEW) {
+    out.VarU(s.generation);
+    out.VarU(s.typeTag);
+  }
+  if (mask & NET_FIELD_X)
+    out.VarS(Diff(s.x, base.x));
+  if (mask & NET_FIELD_Y)
+    out.VarS(Diff(s.y, base.y));
+  if (mask & NET_FIELD_SIZE) {
+    out.VarS(Diff(s.w, base.w));
+    out.VarS(Diff(s.h, base.h));
+  }
+  if (mask & NET_FIELD_VELOCITY) {
+    out.VarS(Diff(s.vx, base.vx));
+    out.VarS(Diff(s.vy, base.vy));
+  }
+  if (mask & NET_FIELD_FLAGS)
+    out.U8(s.flags);
+}
+
+static void ReadFields(const NetEntityState &base, uint8_t mask,
+                       NetReader &in, NetEntityState &s) {
+  s = base;
+  if (mask & NET_FIELD_NEW) {
+    s.generation = in.VarU();
+    s.typeTag = in.VarU();
+  }
+  if (mask & NET_FIELD_X)
+    s.x = Apply(base.x, in.VarS());
+  if (mask & NET_FIELD_Y)
+    s.y = Apply(base.y, in.VarS());
+  if (mask & NET_FIELD_SIZE) {
+    s.w = Apply(base.w, in.VarS());
+    s.h = Apply(base.h, in.VarS());
+  }
+  if (mask & NET_FIELD_VELOCITY) {
+    s.vx = Apply(base.vx, in.VarS());
+    s.vy = Apply(base.vy, in.VarS());
+  }
+  if (mask & NET_FIELD_FLAGS)
+    s.flags = in.U8();
+}
+
+// Walks baseline and current in index order. onRemoved(index) for entities
+// only in the baseline; onChanged(base, state, mask) for entities whose mask
+// isn't empty.
+template <typename Removed, typename Changed>
+static void Merge(const std::vector<NetEntityState> *baseline,
+                  const std::vector<NetEntityState> &current,
+                  Removed onRemoved, Changed onChanged) {
+  static const NetEntityState zero;
+  const size_t baseCount = baseline ? baseline->size() : 0;
+  size_t i = 0, j = 0;
+  while (i < baseCount || j < current.size()) {
+    const NetEntityState *b = i < baseCount ? &(*baseline)[i] : nullptr;
+    const NetEntityState *c = j < current.size() ? &current[j] : nullptr;
+    if (b && (!c || b->index < c->index)) {
+      onRemoved(b->index);
+      ++i;
+    } else if (!b || c->index < b->index) {
+      onChanged(zero, *c, (uint8_t)(NET_FIELD_NEW | ChangedFields(zero, *c)));
+      ++j;
+    } else {
+      const bool replaced =
+          b->generation != c->generation || b->typeTag != c->typeTag;
+      const uint8_t mask =
+          replaced ? (uint8_t)(NET_FIELD_NEW | ChangedFields(zero, *c))
+                   : ChangedFields(*b, *c);
+      if (mask)
+        onChanged(replaced ? zero : *b, *c, mask);
+      ++i;
+      ++j;
+    }
+  }
+}
+
+void EncodeSnapshot(uint32_t serverTick, uint32_t baselineSequence,
+                    const std::vector<NetEntityState> *baseline,
+                    const std::vector<NetEntityState> &current,
+                    NetWriter &out) {
+  out.VarU(serverTick);
+  out.VarU(baseline ? baselineSequence : 0);
+
+  uint32_t removed = 0, changed = 0;
+  Merge(
+      baseline, current, [&](uint32_t) { ++removed; },
+      [&](const NetEntityState &, const NetEntityState &, uint8_t) {
+        ++changed;
+      });
+
+  out.VarU(removed);
+  uint32_t next = 0;
+  Merge(
+      baseline, current,
+      [&](uint32_t index) {
+        out.VarU(index - next);
+        next = index + 1;
+      },
+      [](const NetEntityState &, const NetEntityState &, uint8_t) {});
+
+  out.VarU(changed);
+  next = 0;
+  Merge(
+      baseline, current, [](uint32_t) {},
+      [&](const NetEntityState &base, const NetEntityState &s, uint8_t mask) {
+        out.VarU(s.index - next);
+        next = s.index + 1;
+        WriteFields(base, s, mask, out);
+      });
+}
+
+bool PeekSnapshot(const uint8_t *data, size_t size, uint32_t &serverTick,
+                  uint32_t &baselineSequence) {
+  NetReader in(data, size);
+  serverTick = in.VarU();
+  baselineSequence = in.VarU();
+  return in.Ok();
+}
+
+bool DecodeSnapshot(const uint8_t *data, size_t size,
+                    const std::vector<NetEntityState> *baseline,
+                    std::vector<NetEntityState> &out) {
+  static const NetEntityState zero;
+  out.clear();
+
+  // Two cursors: one over the removed list, one over the changed list that
+  // follows it, merged with the baseline in index order.
+  NetReader removed(data, size);
+  removed.VarU(); // tick
+  removed.VarU(); // baseline sequence
+  uint32_t removedLeft = removed.VarU();
+  NetReader changed = removed;
+  for (uint32_t k = 0; k < removedLeft && changed.Ok(); ++k)
+    changed.VarU();
+  uint32_t changedLeft = changed.VarU();
+  if (!changed.Ok())
+    return false;
+
+  // Indices are gaps from one past the previous; UINT32_MAX = list done.
+  uint32_t nextRemoved = 0, nextChanged = 0;
+  auto readRemoved = [&]() {
+    if (removedLeft == 0)
+      return UINT32_MAX;
+    --removedLeft;
+    const uint32_t index = nextRemoved + removed.VarU();
+    nextRemoved = index + 1;
+    return index;
+  };
+  auto readChanged = [&]() {
+    if (changedLeft == 0)
+      return UINT32_MAX;
+    --changedLeft;
+    const uint32_t index = nextChanged + changed.VarU();
+    nextChanged = index + 1;
+    return index;
+  };
+  uint32_t removedIndex = readRemoved();
+  uint32_t changedIndex = readChanged();
+
+  const size_t baseCount = baseline ? baseline->size() : 0;
+  size_t i = 0;
+  while ((i < baseCount || changedIndex != UINT32_MAX) && changed.Ok()) {
+    const NetEntityState *b = i < baseCount ? &(*baseline)[i] : nullptr;
+    if (b && b->index < changedIndex) {
+      while (removedIndex < b->index)
+        removedIndex = readRemoved();
+      if (removedIndex == b->index)
+        removedIndex = readRemoved();
+      else
+        out.push_back(*b);
+      ++i;
+      continue;
+    }
+
+    const uint8_t mask = changed.U8();
+    const bool sameEntity = b && b->index == changedIndex;
+    if (!(mask & NET_FIELD_NEW) && !sameEntity)
+      return false; // delta against an entity the baseline doesn't have
+    NetEntityState s;
+    ReadFields((mask & NET_FIELD_NEW) ? zero : *b, mask, changed, s);
+    s.index = changedIndex;
+    out.push_back(s);
+    if (sameEntity)
+      ++i;
+    changedIndex = readChanged();
+  }
+  return changed.Ok() && removed.Ok();
+}
@@ -0,0 +1,148 @@
+#pragma once
+#include "Config.h"
+#include "Entity.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Wire format shared by NetServer and NetClient. Every datagram starts with
+// NET_MAGIC, NET_VERSION and a NetMessage byte; integers are little endian
+// or LEB128 varints, signed ones zig-zag encoded.
+//
+//   CONNECT     client nonce (u32)
+//   ACCEPT      nonce (u32), client id (u8), tick rate (u16)
+//   REJECT      nonce (u32)
+//   INPUT       client id (u8), last complete snapshot (varint), count (u8),
+//               newest-first NetInput { tick, buttons } (varints)
+//   SNAPSHOT    sequence (varint), fragment index (u8), fragment count (u8),
+//               a slice of the snapshot body
+//   DISCONNECT  client id (u8), only from clients
+//
+// The snapshot body is a delta against an earlier snapshot the client has
+// acknowledged (or against nothing):
+//
+//   server tick, baseline sequence (0 = none)
+//   removed count, then ascending entity indices as gaps
+//   changed count, then per entity: index gap, NetStateField mask, and each
+//   field in the mask as a difference from the baseline
+inline constexpr uint16_t NET_MAGIC = 0x4e47; // "GN"
+inline constexpr uint8_t NET_VERSION = 1;
+
+enum class NetMessage : uint8_t {
+  CONNECT = 1,
+  ACCEPT,
+  REJECT,
+  INPUT,
+  SNAPSHOT,
+  DISCONNECT
+};
+
+// Bytes before a fragment's payload: header (4) + sequence (<= 5) + 2.
+inline constexpr size_t NET_FRAGMENT_HEADER = 11;
+inline constexpr size_t NET_FRAGMENT_PAYLOAD =
+    cfg::NET_MAX_PACKET - NET_FRAGMENT_HEADER;
+
+// Client input for one tick. Button bits are up to the game.
+struct NetInput {
+  uint32_t tick = 0;
+  uint32_t buttons = 0;
+};
+
+enum NetStateFlags : uint8_t {
+  NET_STATE_VISIBLE = 1u << 0,
+  NET_STATE_SLEEPING = 1u << 1,
+  NET_STATE_GROUNDED = 1u << 2,
+};
+
+// Replicated, quantized state of one entity. Positions, sizes and
+// velocities are in 1/cfg::NET_POSITION_SCALE pixel (per second) steps.
+struct NetEntityState {
+  uint32_t index = 0; // EntityHandle index
+  uint32_t generation = 0;
+  uint32_t typeTag = 0;
+  uint8_t flags = 0;
+  int32_t x = 0, y = 0;
+  int32_t w = 0, h = 0;
+  int32_t vx = 0, vy = 0;
+};
+
+// Traffic counters for one peer. Bytes are UDP payload only.
+struct NetTrafficStats {
+  uint64_t bytesSent = 0;
+  uint64_t packetsSent = 0;
+  uint64_t bytesReceived = 0;
+  uint64_t packetsReceived = 0;
+  uint64_t snapshots = 0;     // sent (server) or decoded (client)
+  uint64_t fullSnapshots = 0; // sent or decoded without a baseline
+  uint64_t undecodable = 0;   // client: baseline no longer held
+};
+
+inline int32_t NetQuantize(float value) {
+  return (int32_t)std::lrint(value * cfg::NET_POSITION_SCALE);
+}
+inline float NetDequantize(int32_t value) {
+  return (float)value / cfg::NET_POSITION_SCALE;
+}
+
+NetEntityState CaptureNetState(const Entity *entity);
+
+// Appends to a byte vector it doesn't own.
+class NetWriter {
+private:
+  std::vector<uint8_t> &out;
+
+public:
+  explicit NetWriter(std::vector<uint8_t> &target) : out(target) {}
+
+  void U8(uint8_t v) { out.push_back(v); }
+  void U16(uint16_t v);
+  void U32(uint32_t v);
+  void VarU(uint32_t v);
+  void VarS(int32_t v);
+  void Bytes(const void *data, size_t size);
+  void Header(NetMessage type);
+
+  size_t Size() const { return out.size(); }
+};
+
+// Reads until it runs out; after that every read returns 0 and Ok() is
+// false, so callers check once at the end.
+class NetReader {
+private:
+  const uint8_t *cursor;
+  const uint8_t *end;
+  bool ok = true;
+
+public:
+  NetReader(const uint8_t *data, size_t size)
+      : cursor(data), end(data + size) {}
+
+  uint8_t U8();
+  uint16_t U16();
+  uint32_t U32();
+  uint32_t VarU();
+  int32_t VarS();
+  // Validates magic and version; NetMessage(0) if they don't match.
+  NetMessage Header();
+
+  const uint8_t *Cursor() const { return cursor; }
+  size_t Remaining() const { return (size_t)(end - cursor); }
+  bool Ok() const { return ok; }
+};
+
+// Encodes current (sorted by index) as a delta against baseline (sorted by
+// index, or null for a full snapshot).
+void EncodeSnapshot(uint32_t serverTick, uint32_t baselineSequence,
+                    const std::vector<NetEntityState> *baseline,
+                    const std::vector<NetEntityState> &current,
+                    NetWriter &out);
+// Reads the tick and baseline sequence that open a snapshot body, so the
+// caller can find the baseline before decoding.
+bool PeekSnapshot(const uint8_t *data, size_t size, uint32_t &serverTick,
+                  uint32_t &baselineSequence);
+// Rebuilds the snapshot into out (sorted by index). Returns false on
+// malformed input.
+bool DecodeSnapshot(const uint8_t *data, size_t size,
+                    const std::vector<NetEntityState> *baseline,
+                    std::vector<NetEntityState> &out);
@@ -0,0 +1,209 @@
+#include "NetServer.h"
+#include "GameEngine.h"
+#include "Profiler.h"
+#include <algorithm>
+
+NetServer::NetServer(GameEngine &engine)
+    : engine(engine), clients(cfg::NET_MAX_CLIENTS),
+      history(cfg::NET_SNAPSHOT_HISTORY) {
+  conditioner.Attach(&socket);
+}
+
+bool NetServer::Start(uint16_t port, bool anyInterface) {
+  Stop();
+  return socket.Open(port, anyInterface);
+}
+
+void NetServer::Stop() {
+  for (int i = 0; i < (int)clients.size(); ++i)
+    if (clients[i].connected)
+      Drop(i);
+  conditioner.Clear();
+  socket.Close();
+}
+
+int NetServer::GetClientCount() const {
+  int count = 0;
+  for (const Client &c : clients)
+    count += c.connected ? 1 : 0;
+  return count;
+}
+
+void NetServer::Drop(int client) {
+  clients[client].connected = false;
+  if (onClientChanged)
+    onClientChanged(client, false);
+}
+
+void NetServer::ReceivePackets(uint64_t nowNS) {
+  PROFILE_SCOPE("NetReceive");
+  conditioner.Flush(nowNS);
+  NetAddress from;
+  int size;
+  while ((size = socket.Receive(from, receiveBuffer, sizeof(receiveBuffer))) >
+         0) {
+    HandlePacket(from, receiveBuffer, (size_t)size, nowNS);
+  }
+
+  const uint64_t timeoutNS =
+      (uint64_t)(cfg::NET_TIMEOUT_MS * (double)SDL_NS_PER_MS);
+  for (int i = 0; i < (int)clients.size(); ++i) {
+    if (clients[i].connected && nowNS - clients[i].lastHeardNS > timeoutNS) {
+      SDL_Log("Client %d timed out", i);
+      Drop(i);
+    }
+  }
+}
+
+void NetServer::HandlePacket(const NetAddress &from, const uint8_t *data,
+                             size_t size, uint64_t nowNS) {
+  NetReader in(data, size);
+  const NetMessage type = in.Header();
+
+  if (type == NetMessage::CONNECT) {
+    const uint32_t nonce = in.U32();
+    if (!in.Ok())
+      return;
+    // A retry from a client we already accepted gets the same answer.
+    int id = -1;
+    for (int i = 0; i < (int)clients.size() && id < 0; ++i)
+      if (clients[i].connected && clients[i].address == from &&
+          clients[i].nonce == nonce)
+        id = i;
+    for (int i = 0; i < (int)clients.size() && id < 0; ++i) {
+      if (!clients[i].connected) {
+        id = i;
+        clients[i] = Client();
+        clients[i].connected = true;
+        clients[i].address = from;
+        clients[i].nonce = nonce;
+        clients[i].lastHeardNS = nowNS;
+        if (onClientChanged)
+          onClientChanged(i, true);
+      }
+    }
+    packet.clear();
+    NetWriter out(packet);
+    out.Header(id >= 0 ? NetMessage::ACCEPT : NetMessage::REJECT);
+    out.U32(nonce);
+    if (id >= 0) {
+      out.U8((uint8_t)id);
+      out.U16((uint16_t)engine.GetTickRate());
+    }
+    conditioner.Send(from, packet.data(), packet.size(), nowNS);
+    return;
+  }
+
+  if (type != NetMessage::INPUT && type != NetMessage::DISCONNECT)
+    return;
+  const uint8_t id = in.U8();
+  if (!in.Ok() || id >= clients.size() || !clients[id].connected ||
+      !(clients[id].address == from))
+    return;
+  Client &c = clients[id];
+  c.lastHeardNS = nowNS;
+  c.stats.bytesReceived += size;
+  ++c.stats.packetsReceived;
+
+  if (type == NetMessage::DISCONNECT) {
+    Drop(id);
+    return;
+  }
+
+  const uint32_t acked = in.VarU();
+  const uint8_t count = in.U8();
+  for (uint8_t k = 0; k < count && in.Ok(); ++k) {
+    NetInput input;
+    input.tick = in.VarU();
+    input.buttons = in.VarU();
+    if (in.Ok() && input.tick > c.input.tick)
+      c.input = input;
+  }
+  if (in.Ok() && acked > c.ackedSequence && acked <= sequence)
+    c.ackedSequence = acked;
+}
+
+void NetServer::SendSnapshots(uint64_t nowNS) {
+  ++tick;
+  if (tick % cfg::NET_SNAPSHOT_INTERVAL != 0 || GetClientCount() == 0) {
+    conditioner.Flush(nowNS);
+    return;
+  }
+
+  {
+    PROFILE_SCOPE("NetCapture");
+    Snapshot &snap = history[++sequence % history.size()];
+    snap.sequence = sequence;
+    snap.tick = tick;
+    snap.states.clear();
+    for (const Entity *e : engine.GetEntities())
+      snap.states.push_back(CaptureNetState(e));
+    std::sort(snap.states.begin(), snap.states.end(),
+              [](const NetEntityState &a, const NetEntityState &b) {
+                return a.index < b.index;
+              });
+  }
+
+  PROFILE_SCOPE("NetSend");
+  encodedCount = 0;
+  for (Client &c : clients)
+    if (c.connected)
+      Send(c, nowNS);
+  conditioner.Flush(nowNS);
+}
+
+const std::vector<uint8_t> &NetServer::EncodeFor(const Snapshot *baseline,
+                                                 const Snapshot &current) {
+  const uint32_t key = baseline ? baseline->sequence : 0;
+  for (size_t i = 0; i < encodedCount; ++i)
+    if (encoded[i].baseline == key)
+      return encoded[i].body;
+
+  if (encodedCount == encoded.size())
+    encoded.emplace_back();
+  Encoded &e = encoded[encodedCount++];
+  e.baseline = key;
+  e.body.clear();
+  NetWriter out(e.body);
+  EncodeSnapshot(current.tick, key, baseline ? &baseline->states : nullptr,
+                 current.states, out);
+  return e.body;
+}
+
+void NetServer::Send(Client &c, uint64_t nowNS) {
+  const Snapshot &current = history[sequence % history.size()];
+  const Snapshot *baseline = nullptr;
+  if (c.ackedSequence && sequence - c.ackedSequence < history.size()) {
+    const Snapshot &candidate = history[c.ackedSequence % history.size()];
+    if (candidate.sequence == c.ackedSequence)
+      baseline = &candidate;
+  }
+  const std::vector<uint8_t> &body = EncodeFor(baseline, current);
+
+  const size_t fragments =
+      std::max<size_t>(1, (body.size() + NET_FRAGMENT_PAYLOAD - 1) /
+                              NET_FRAGMENT_PAYLOAD);
+  if (fragments > (size_t)cfg::NET_MAX_FRAGMENTS) {
+    SDL_Log("Snapshot %u too large to send (%zu bytes)", sequence,
+            body.size());
+    return;
+  }
+
+  for (size_t f = 0; f < fragments; ++f) {
+    const size_t offset = f * NET_FRAGMENT_PAYLOAD;
+    const size_t length = std::min(NET_FRAGMENT_PAYLOAD, body.size() - offset);
+    packet.clear();
+    NetWriter out(packet);
+    out.Header(NetMessage::SNAPSHOT);
+    out.VarU(sequence);
+    out.U8((uint8_t)f);
+    out.U8((uint8_t)fragments);
+    out.Bytes(body.data() + offset, length);
+    conditioner.Send(c.address, packet.data(), packet.size(), nowNS);
+    c.stats.bytesSent += packet.size();
+    ++c.stats.packetsSent;
+  }
+  ++c.stats.snapshots;
+  if (!baseline)
+    ++c.stats.fullSnapshots;
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include "NetProtocol.h"
+#include "NetSocket.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class GameEngine;
+
+// Authoritative side of replication. Each snapshot captures every entity
+// registered with the engine and is sent to each client as a delta against
+// the newest snapshot that client has acknowledged, so entities that didn't
+// change (resting or static bodies) cost nothing after the first one
+// arrives. Lost snapshots need no resend: the next one is encoded against
+// the older baseline.
+//
+// Per tick: ReceivePackets, then engine.Step(), then SendSnapshots.
+class NetServer {
+private:
+  struct Client {
+    bool connected = false;
+    NetAddress address;
+    uint32_t nonce = 0;
+    uint32_t ackedSequence = 0; // newest snapshot the client decoded
+    uint64_t lastHeardNS = 0;
+    NetInput input; // newest received
+    NetTrafficStats stats;
+  };
+  struct Snapshot {
+    uint32_t sequence = 0; // 0 = empty slot
+    uint32_t tick = 0;
+    std::vector<NetEntityState> states; // sorted by index
+  };
+  // This snapshot's encoding against one baseline, shared by every client
+  // that acked the same one.
+  struct Encoded {
+    uint32_t baseline = 0;
+    std::vector<uint8_t> body;
+  };
+
+  GameEngine &engine;
+  NetSocket socket;
+  NetConditioner conditioner;
+  std::vector<Client> clients;   // index = client id
+  std::vector<Snapshot> history; // ring, slot = sequence % size
+  std::vector<Encoded> encoded;
+  size_t encodedCount = 0;
+  uint32_t sequence = 0; // last snapshot taken
+  uint32_t tick = 0;
+  std::vector<uint8_t> packet;
+  uint8_t receiveBuffer[cfg::NET_MAX_PACKET];
+  std::function<void(int, bool)> onClientChanged;
+
+  void HandlePacket(const NetAddress &from, const uint8_t *data, size_t size,
+                    uint64_t nowNS);
+  void Drop(int client);
+  const std::vector<uint8_t> &EncodeFor(const Snapshot *baseline,
+                                        const Snapshot &current);
+  void Send(Client &client, uint64_t nowNS);
+
+public:
+  explicit NetServer(GameEngine &engine);
+
+  NetServer(const NetServer &) = delete;
+  NetServer &operator=(const NetServer &) = delete;
+
+  // Listens on port (loopback only unless anyInterface).
+  bool Start(uint16_t port = cfg::NET_DEFAULT_PORT, bool anyInterface = false);
+  void Stop();
+  uint16_t GetPort() const { return socket.GetPort(); }
+
+  // Applied to everything the server sends.
+  void SetConditions(const NetConditions &conditions, uint32_t seed = 1) {
+    conditioner.SetConditions(conditions, seed);
+  }
+
+  // Handles connects, inputs and acks, and drops clients that went silent.
+  void ReceivePackets(uint64_t nowNS);
+  // Call once per engine tick; takes and sends a snapshot every
+  // cfg::NET_SNAPSHOT_INTERVAL ticks.
+  void SendSnapshots(uint64_t nowNS);
+
+  // Called with (client id, true) on connect and (id, false) on disconnect
+  // or timeout, from ReceivePackets.
+  void SetClientCallback(std::function<void(int, bool)> callback) {
+    onClientChanged = std::move(callback);
+  }
+
+  bool IsConnected(int client) const { return clients[client].connected; }
+  int GetClientCount() const;
+  // Buttons stay as last received until a newer input arrives.
+  const NetInput &GetInput(int client) const { return clients[client].input; }
+  const NetTrafficStats &GetStats(int client) const {
+    return clients[client].stats;
+  }
+  uint32_t GetTick() const { return tick; }
+};
@@ -0,0 +1,192 @@
+#include "NetSocket.h"
+#include <SDL3/SDL.h>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "ws2_32.lib")
+#endif
+typedef int socklen_t;
+typedef SOCKET NativeSocket;
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int NativeSocket;
+#endif
+
+#ifdef _WIN32
+// Winsock is reference counted by WSAStartup / WSACleanup; one reference per
+// open socket.
+static bool StartWinsock() {
+  WSADATA data;
+  return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+}
+static void StopWinsock() { WSACleanup(); }
+static void CloseSocket(NativeSocket s) { closesocket(s); }
+static bool WouldBlock() { return WSAGetLastError() == WSAEWOULDBLOCK; }
+// An earlier send to a closed port is reported on a later receive; UDP
+// doesn't care.
+static bool PeerGone() { return WSAGetLastError() == WSAECONNRESET; }
+#else
+static bool StartWinsock() { return true; }
+static void StopWinsock() {}
+static void CloseSocket(NativeSocket s) { close(s); }
+static bool WouldBlock() { return errno == EAGAIN || errno == EWOULDBLOCK; }
+static bool PeerGone() { return errno == ECONNREFUSED; }
+#endif
+
+NetSocket::~NetSocket() { Close(); }
+
+bool NetSocket::Open(uint16_t requestedPort, bool anyInterface) {
+  Close();
+  if (!StartWinsock()) {
+    SDL_Log("Failed to start Winsock");
+    return false;
+  }
+
+  const NativeSocket s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+#ifdef _WIN32
+  const bool created = s != INVALID_SOCKET;
+#else
+  const bool created = s >= 0;
+#endif
+  if (!created) {
+    SDL_Log("Failed to create UDP socket");
+    StopWinsock();
+    return false;
+  }
+  handle = (intptr_t)s;
+
+  sockaddr_in local;
+  memset(&local, 0, sizeof(local));
+  local.sin_family = AF_INET;
+  local.sin_port = htons(requestedPort);
+  local.sin_addr.s_addr = htonl(anyInterface ? INADDR_ANY : NET_LOCALHOST);
+  bool ok = bind(s, (const sockaddr *)&local, sizeof(local)) == 0;
+
+#ifdef _WIN32
+  u_long nonBlocking = 1;
+  ok = ok && ioctlsocket(s, FIONBIO, &nonBlocking) == 0;
+#else
+  ok = ok && fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK) == 0;
+#endif
+
+  // Snapshots for many clients go out in bursts; give the kernel room.
+  const int bufferBytes = 1 << 20;
+  setsockopt(s, SOL_SOCKET, SO_SNDBUF, (const char *)&bufferBytes,
+             sizeof(bufferBytes));
+  setsockopt(s, SOL_SOCKET, SO_RCVBUF, (const char *)&bufferBytes,
+             sizeof(bufferBytes));
+
+  socklen_t length = sizeof(local);
+  ok = ok && getsockname(s, (sockaddr *)&local, &length) == 0;
+  if (!ok) {
+    SDL_Log("Failed to bind UDP port %u", (unsigned)requestedPort);
+    Close();
+    return false;
+  }
+  port = ntohs(local.sin_port);
+  return true;
+}
+
+void NetSocket::Close() {
+  if (handle == -1)
+    return;
+  CloseSocket((NativeSocket)handle);
+  StopWinsock();
+  handle = -1;
+  port = 0;
+}
+
+bool NetSocket::Send(const NetAddress &to, const void *data, size_t size) {
+  if (handle == -1)
+    return false;
+  sockaddr_in remote;
+  memset(&remote, 0, sizeof(remote));
+  remote.sin_family = AF_INET;
+  remote.sin_port = htons(to.port);
+  remote.sin_addr.s_addr = htonl(to.ip);
+  const auto sent =
+      sendto((NativeSocket)handle, (const char *)data, (int)size, 0,
+             (const sockaddr *)&remote, sizeof(remote));
+  return sent >= 0 && (size_t)sent == size;
+}
+
+int NetSocket::Receive(NetAddress &from, void *buffer, size_t capacity) {
+  if (handle == -1)
+    return -1;
+  for (;;) {
+    sockaddr_in remote;
+    socklen_t length = sizeof(remote);
+    const auto received =
+        recvfrom((NativeSocket)handle, (char *)buffer, (int)capacity, 0,
+                 (sockaddr *)&remote, &length);
+    if (received >= 0) {
+      from.ip = ntohl(remote.sin_addr.s_addr);
+      from.port = ntohs(remote.sin_port);
+      return (int)received;
+    }
+    if (PeerGone())
+      continue;
+    return WouldBlock() ? 0 : -1;
+  }
+}
+
+float NetConditioner::NextUnit() {
+  rng = rng * 1664525u + 1013904223u;
+  return (float)(rng >> 8) / 16777216.0f;
+}
+
+void NetConditioner::SetConditions(const NetConditions &settings,
+                                   uint32_t seed) {
+  conditions = settings;
+  rng = seed ? seed : 1;
+}
+
+void NetConditioner::Send(const NetAddress &to, const void *data, size_t size,
+                          uint64_t nowNS) {
+  if (!socket || size > cfg::NET_MAX_PACKET)
+    return;
+  if (conditions.lossPercent > 0.0f &&
+      NextUnit() * 100.0f < conditions.lossPercent) {
+    ++dropped;
+    return;
+  }
+  float delayMs = conditions.latencyMs;
+  if (conditions.jitterMs > 0.0f)
+    delayMs += (NextUnit() * 2.0f - 1.0f) * conditions.jitterMs;
+  if (delayMs <= 0.0f) {
+    socket->Send(to, data, size);
+    return;
+  }
+
+  if (queued == queue.size())
+    queue.emplace_back();
+  Delayed &d = queue[queued++];
+  d.deliverAtNS = nowNS + (uint64_t)(delayMs * (float)SDL_NS_PER_MS);
+  d.to = to;
+  d.size = (uint16_t)size;
+  memcpy(d.data, data, size);
+}
+
+void NetConditioner::Flush(uint64_t nowNS) {
+  size_t i = 0;
+  while (i < queued) {
+    Delayed &d = queue[i];
+    if (d.deliverAtNS > nowNS) {
+      ++i;
+      continue;
+    }
+    if (socket)
+      socket->Send(d.to, d.data, d.size);
+    if (i != --queued)
+      queue[i] = queue[queued];
+  }
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include "Config.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// IPv4 address and port, in host byte order.
+struct NetAddress {
+  uint32_t ip = 0;
+  uint16_t port = 0;
+
+  bool operator==(const NetAddress &) const = default;
+};
+
+inline constexpr uint32_t NET_LOCALHOST = 0x7f000001u;
+
+// Non-blocking UDP socket.
+class NetSocket {
+private:
+  intptr_t handle = -1; // SOCKET on Windows, a file descriptor elsewhere
+  uint16_t port = 0;
+
+public:
+  NetSocket() = default;
+  ~NetSocket();
+
+  NetSocket(const NetSocket &) = delete;
+  NetSocket &operator=(const NetSocket &) = delete;
+
+  // Binds to port (0 picks a free one) on the loopback interface, or on all
+  // interfaces if anyInterface. Logs and returns false on failure.
+  bool Open(uint16_t port, bool anyInterface = false);
+  void Close();
+
+  bool IsOpen() const { return handle != -1; }
+  uint16_t GetPort() const { return port; }
+
+  bool Send(const NetAddress &to, const void *data, size_t size);
+  // Size of the datagram read into buffer, 0 when nothing is waiting, -1 on
+  // error. Datagrams larger than capacity are truncated.
+  int Receive(NetAddress &from, void *buffer, size_t capacity);
+};
+
+// Simulated network conditions for outgoing datagrams.
+struct NetConditions {
+  float lossPercent = 0.0f;
+  float latencyMs = 0.0f; // one way
+  float jitterMs = 0.0f;  // +- around latencyMs; can reorder datagrams
+};
+
+// Sits between a sender and its socket to test over localhost as if over a
+// real network: drops a share of datagrams and delays the rest. With the
+// default (perfect) conditions datagrams go straight out.
+class NetConditioner {
+private:
+  struct Delayed {
+    uint64_t deliverAtNS;
+    NetAddress to;
+    uint16_t size;
+    uint8_t data[cfg::NET_MAX_PACKET];
+  };
+
+  NetSocket *socket = nullptr;
+  NetConditions conditions;
+  uint32_t rng = 1;
+  std::vector<Delayed> queue; // unordered; Flush scans it
+  size_t queued = 0;
+  uint64_t dropped = 0;
+
+  float NextUnit(); // [0, 1)
+
+public:
+  void Attach(NetSocket *target) { socket = target; }
+  void SetConditions(const NetConditions &settings, uint32_t seed = 1);
+  const NetConditions &GetConditions() const { return conditions; }
+
+  void Send(const NetAddress &to, const void *data, size_t size,
+            uint64_t nowNS);
+  // Sends every delayed datagram that is due.
+  void Flush(uint64_t nowNS);
+  void Clear() { queued = 0; }
+
+  uint64_t GetDropped() const { return dropped; }
+};
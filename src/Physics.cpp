@@ -1,8 +1,28 @@
 #include "Physics.h"
+#include "Config.h"
 #include "Entity.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||           \
+    defined(_M_IX86)
+#define ENGINE_X86_KERNELS 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define ENGINE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define ENGINE_TARGET_AVX2
+#endif
+#endif
+
+PhysicsSystem::PhysicsSystem()
+    : kernel(IntegratorKernel::SCALAR), sleepEnabled(true) {
+  SetKernel(IntegratorKernel::AVX2);
+}
 
 void PhysicsSystem::ApplyPhysics(Entity *entity, float deltaTime) {
-  if (!entity->hasPhysics || entity->isStatic)
+  if (!entity->hasPhysics || entity->isStatic || entity->sleeping)
     return;
 
   // entity->prevPosition = entity->position;
@@ -19,3 +39,243 @@ void PhysicsSystem::ApplyPhysics(Entity *entity, float deltaTime) {
   // entity->x += entity->velocityX * deltaTime;
   // entity->y += entity->velocityY * deltaTime;
 }
+
+static inline bool Integrates(const uint8_t *flags, size_t i) {
+  return !flags || (flags[i] & (BODY_HAS_PHYSICS | BODY_STATIC |
+                                BODY_SLEEPING)) == BODY_HAS_PHYSICS;
+}
+
+static void IntegrateScalar(vec2 *position, vec2 *velocity, const vec2 *force,
+                            const uint8_t *flags, size_t begin, size_t end,
+                            float dt) {
+  for (size_t i = begin; i < end; ++i) {
+    if (!Integrates(flags, i))
+      continue;
+    velocity[i].x = velocity[i].x + force[i].x * dt;
+    velocity[i].y = velocity[i].y + force[i].y * dt;
+    position[i].x = position[i].x + velocity[i].x * dt;
+    position[i].y = position[i].y + velocity[i].y * dt;
+  }
+}
+
+#ifdef ENGINE_X86_KERNELS
+// Two bodies (x, y, x, y) per register.
+static size_t IntegrateSSE2(vec2 *position, vec2 *velocity, const vec2 *force,
+                            const uint8_t *flags, size_t count, float dt) {
+  const __m128 vdt = _mm_set1_ps(dt);
+  size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    const __m128 p = _mm_loadu_ps(&position[i].x);
+    const __m128 v = _mm_loadu_ps(&velocity[i].x);
+    const __m128 f = _mm_loadu_ps(&force[i].x);
+
+    __m128 nv = _mm_add_ps(v, _mm_mul_ps(f, vdt));
+    __m128 np = _mm_add_ps(p, _mm_mul_ps(nv, vdt));
+
+    if (flags) {
+      const int m0 = Integrates(flags, i) ? -1 : 0;
+      const int m1 = Integrates(flags, i + 1) ? -1 : 0;
+      const __m128 mask = _mm_castsi128_ps(_mm_set_epi32(m1, m1, m0, m0));
+      nv = _mm_or_ps(_mm_and_ps(mask, nv), _mm_andnot_ps(mask, v));
+      np = _mm_or_ps(_mm_and_ps(mask, np), _mm_andnot_ps(mask, p));
+    }
+
+    _mm_storeu_ps(&velocity[i].x, nv);
+    _mm_storeu_ps(&position[i].x, np);
+  }
+  return i;
+}
+
+// Four bodies per register; each body's flag byte widens to a 64-bit lane,
+// which is exactly one (x, y) pair.
+ENGINE_TARGET_AVX2
+static size_t IntegrateAVX2(vec2 *position, vec2 *velocity, const vec2 *force,
+                            const uint8_t *flags, size_t count, float dt) {
+  const __m256 vdt = _mm256_set1_ps(dt);
+  const __m256i activeBits =
+      _mm256_set1_epi64x(BODY_HAS_PHYSICS | BODY_STATIC | BODY_SLEEPING);
+  const __m256i activeValue = _mm256_set1_epi64x(BODY_HAS_PHYSICS);
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const __m256 p = _mm256_loadu_ps(&position[i].x);
+    const __m256 v = _mm256_loadu_ps(&velocity[i].x);
+    const __m256 f = _mm256_loadu_ps(&force[i].x);
+
+    __m256 nv = _mm256_add_ps(v, _mm256_mul_ps(f, vdt));
+    __m256 np = _mm256_add_ps(p, _mm256_mul_ps(nv, vdt));
+
+    if (flags) {
+      int packed;
+      memcpy(&packed, flags + i, sizeof(packed));
+      const __m256i lanes = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(packed));
+      const __m256 mask = _mm256_castsi256_ps(_mm256_cmpeq_epi64(
+          _mm256_and_si256(lanes, activeBits), activeValue));
+      nv = _mm256_blendv_ps(v, nv, mask);
+      np = _mm256_blendv_ps(p, np, mask);
+    }
+
+    _mm256_storeu_ps(&velocity[i].x, nv);
+    _mm256_storeu_ps(&position[i].x, np);
+  }
+  return i;
+}
+#endif
+
+void PhysicsSystem::IntegrateBatch(vec2 *position, vec2 *velocity,
+                                   const vec2 *force, const uint8_t *flags,
+                                   size_t count, float deltaTime) const {
+  size_t done = 0;
+#ifdef ENGINE_X86_KERNELS
+  if (kernel == IntegratorKernel::AVX2) {
+    done = IntegrateAVX2(position, velocity, force, flags, count, deltaTime);
+  } else if (kernel == IntegratorKernel::SSE2) {
+    done = IntegrateSSE2(position, velocity, force, flags, count, deltaTime);
+  }
+#endif
+  IntegrateScalar(position, velocity, force, flags, done, count, deltaTime);
+}
+
+void PhysicsSystem::Integrate(World &world, float deltaTime,
+                              JobSystem *jobs) {
+  world.Each(COMPONENT_TRANSFORM | COMPONENT_MOTION, 0, [&](Archetype &arch) {
+    const uint8_t *flags =
+        (arch.mask & COMPONENT_FLAGS) ? arch.flags.data() : nullptr;
+    auto integrateRange = [&](size_t begin, size_t end) {
+      PROFILE_SCOPE("IntegrateChunk");
+      IntegrateBatch(arch.position.data() + begin,
+                     arch.velocity.data() + begin, arch.force.data() + begin,
+                     flags ? flags + begin : nullptr, end - begin, deltaTime);
+    };
+    if (jobs) {
+      jobs->ParallelFor(arch.Size(), cfg::INTEGRATE_CHUNK, integrateRange);
+    } else {
+      integrateRange(0, arch.Size());
+    }
+  });
+}
+
+uint32_t PhysicsSystem::Find(uint32_t i) {
+  while (islandParent[i] != i) {
+    islandParent[i] = islandParent[islandParent[i]];
+    i = islandParent[i];
+  }
+  return i;
+}
+
+void PhysicsSystem::UpdateSleep(std::vector<Entity *> &entities,
+                                const std::vector<uint64_t> &touchingPairs,
+                                float deltaTime) {
+  PROFILE_SCOPE("Sleep");
+  const uint32_t n = (uint32_t)entities.size();
+
+  // Islands with a member that woke up (contact, teleport, impulse, or moved
+  // by its Update) wake entirely. Ids are reused once nobody sleeps in them.
+  bool anyWoken = false;
+  islandWoken.assign(islandCount, 0);
+  for (Entity *e : entities) {
+    if (e->sleepIsland != UINT32_MAX && (!e->sleeping || !sleepEnabled)) {
+      islandWoken[e->sleepIsland] = 1;
+      anyWoken = true;
+    }
+  }
+  if (anyWoken) {
+    for (Entity *e : entities) {
+      if (e->sleepIsland != UINT32_MAX && islandWoken[e->sleepIsland]) {
+        e->Wake();
+        e->sleepIsland = UINT32_MAX;
+      }
+    }
+    for (uint32_t id = 0; id < islandCount; ++id)
+      if (islandWoken[id])
+        freeIslands.push_back(id);
+  }
+  if (!sleepEnabled)
+    return;
+
+  // Rest timers of awake bodies; bodies that can't sleep keep their island
+  // awake.
+  const float limit = cfg::SLEEP_VELOCITY * cfg::SLEEP_VELOCITY;
+  islandParent.resize(n);
+  islandRest.resize(n);
+  islandOfRoot.assign(n, UINT32_MAX);
+  for (uint32_t i = 0; i < n; ++i) {
+    Entity *e = entities[i];
+    islandParent[i] = i;
+    if (e->isStatic || e->sleeping || !e->hasPhysics) {
+      islandRest[i] = 0.0f;
+      continue;
+    }
+    const bool resting = e->canSleep && dot(e->velocity, e->velocity) < limit;
+    e->restTime = resting ? e->restTime + deltaTime : 0.0f;
+    islandRest[i] = e->restTime;
+  }
+
+  // Each root ends up with the shortest rest time in its island.
+  for (uint64_t pair : touchingPairs) {
+    const uint32_t a = Find((uint32_t)(pair >> 32));
+    const uint32_t b = Find((uint32_t)(pair & 0xffffffffu));
+    if (a == b)
+      continue;
+    islandParent[b] = a;
+    islandRest[a] = std::min(islandRest[a], islandRest[b]);
+  }
+
+  for (uint32_t i = 0; i < n; ++i) {
+    Entity *e = entities[i];
+    if (e->isStatic || e->sleeping || !e->hasPhysics)
+      continue;
+    const uint32_t root = Find(i);
+    if (islandRest[root] < cfg::SLEEP_TIME)
+      continue;
+    if (islandOfRoot[root] == UINT32_MAX) {
+      if (!freeIslands.empty()) {
+        islandOfRoot[root] = freeIslands.back();
+        freeIslands.pop_back();
+      } else {
+        islandOfRoot[root] = islandCount++;
+      }
+    }
+    e->sleeping = true;
+    e->velocity = {.x = 0.0f, .y = 0.0f};
+    e->sleepIsland = islandOfRoot[root];
+  }
+}
+
+void PhysicsSystem::SaveState(StateWriter &out) const {
+  out.Write(islandCount);
+  out.Write((uint32_t)freeIslands.size());
+  out.Write(freeIslands.data(), freeIslands.size() * sizeof(uint32_t));
+}
+
+bool PhysicsSystem::LoadState(StateReader &in) {
+  islandCount = in.Read<uint32_t>();
+  const uint32_t freeCount = in.Read<uint32_t>();
+  if (!in.Ok() || freeCount > islandCount)
+    return false;
+  freeIslands.resize(freeCount);
+  in.Read(freeIslands.data(), freeCount * sizeof(uint32_t));
+  return in.Ok();
+}
+
+bool PhysicsSystem::IsKernelSupported(IntegratorKernel candidate) {
+  switch (candidate) {
+  case IntegratorKernel::SCALAR:
+    return true;
+#ifdef ENGINE_X86_KERNELS
+  case IntegratorKernel::SSE2:
+    return SDL_HasSSE2();
+  case IntegratorKernel::AVX2:
+    return SDL_HasAVX() && SDL_HasAVX2();
+#endif
+  default:
+    return false;
+  }
+}
+
+void PhysicsSystem::SetKernel(IntegratorKernel requested) {
+  if (requested == IntegratorKernel::AVX2 && !IsKernelSupported(requested))
+    requested = IntegratorKernel::SSE2;
+  if (requested == IntegratorKernel::SSE2 && !IsKernelSupported(requested))
+    requested = IntegratorKernel::SCALAR;
+  kernel = requested;
+}
@@ -1,9 +1,70 @@
 #pragma once
 #include "Entity.h"
+#include "JobSystem.h"
+#include "StateBuffer.h"
+#include "World.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class IntegratorKernel {
+  SCALAR, // Portable fallback, also the reference for validation
+  SSE2,   // 2 bodies per step
+  AVX2    // 4 bodies per step
+};
 
 class PhysicsSystem {
+private:
+  IntegratorKernel kernel;
+  bool sleepEnabled;
+
+  // UpdateSleep scratch: union-find over the entity list, and which islands
+  // had a member woken this tick.
+  std::vector<uint32_t> islandParent;
+  std::vector<float> islandRest;
+  std::vector<uint32_t> islandOfRoot; // island id given to each root
+  std::vector<uint8_t> islandWoken;
+  std::vector<uint32_t> freeIslands;
+  uint32_t islandCount = 0;
+  uint32_t Find(uint32_t i);
+
 public:
-  PhysicsSystem() = default;
+  // Picks the widest kernel the CPU supports.
+  PhysicsSystem();
 
   void ApplyPhysics(Entity *entity, float deltaTime);
+
+  // Semi-implicit Euler over contiguous arrays: v += f * dt, p += v * dt.
+  // Bodies whose flags aren't exactly BODY_HAS_PHYSICS (i.e. static or
+  // without physics) are left untouched; flags may be null to integrate all.
+  // Every kernel performs the same separately rounded multiply and add per
+  // component, so results are bit-identical to ApplyPhysics.
+  void IntegrateBatch(vec2 *position, vec2 *velocity, const vec2 *force,
+                      const uint8_t *flags, size_t count,
+                      float deltaTime) const;
+
+  // Integrates every world row with a transform and motion, skipping rows
+  // flagged static or without physics.
+  // With a job system the rows are split into chunks across its threads.
+  void Integrate(World &world, float deltaTime, JobSystem *jobs = nullptr);
+
+  // Sleep pass, after collisions. Bodies touching each other (pairs of
+  // indices into entities, from CollisionSystem::GetTouchingPairs) form an
+  // island; an island whose members have all moved slower than
+  // cfg::SLEEP_VELOCITY for cfg::SLEEP_TIME falls asleep together, and when
+  // any member is woken the rest of its island wakes too.
+  void UpdateSleep(std::vector<Entity *> &entities,
+                   const std::vector<uint64_t> &touchingPairs,
+                   float deltaTime);
+  // Island id allocation, which entities' sleepIsland values refer to.
+  void SaveState(StateWriter &out) const;
+  bool LoadState(StateReader &in);
+  // Disabling wakes everything on the next UpdateSleep.
+  void SetSleepEnabled(bool enabled) { sleepEnabled = enabled; }
+  bool IsSleepEnabled() const { return sleepEnabled; }
+
+  // Requests a kernel; unsupported ones fall back to the best available.
+  void SetKernel(IntegratorKernel requested);
+  IntegratorKernel GetKernel() const { return kernel; }
+  static bool IsKernelSupported(IntegratorKernel candidate);
 };
@@ -0,0 +1,238 @@
+#include "Profiler.h"
+#include "Config.h"
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+
+// Fields are relaxed atomics so the main thread may read a slot while its
+// owner overwrites it; ReadSince throws such slots away.
+struct Event {
+  std::atomic<const char *> name{nullptr};
+  std::atomic<uint64_t> start{0};
+  std::atomic<uint64_t> end{0};
+  std::atomic<uint32_t> depth{0};
+};
+
+struct Sample {
+  const char *name;
+  uint64_t start;
+  uint64_t end;
+  uint32_t depth;
+};
+
+struct ThreadBuffer {
+  std::unique_ptr<Event[]> events{new Event[cfg::PROFILE_RING_EVENTS]};
+  std::atomic<uint64_t> head{0}; // events ever written
+  uint64_t aggregated = 0;       // main thread: consumed by EndFrame
+  uint32_t tid = 0;
+  std::string name;
+
+  // Copies the events with index >= from that are still intact and returns
+  // the index to continue from next time.
+  uint64_t ReadSince(uint64_t from, std::vector<Sample> &out) const {
+    const uint64_t cap = cfg::PROFILE_RING_EVENTS;
+    const uint64_t before = head.load(std::memory_order_acquire);
+    const size_t first = out.size();
+    for (uint64_t i = std::max(from, before > cap ? before - cap : 0);
+         i < before; ++i) {
+      const Event &e = events[i % cap];
+      out.push_back({e.name.load(std::memory_order_relaxed),
+                     e.start.load(std::memory_order_relaxed),
+                     e.end.load(std::memory_order_relaxed),
+                     e.depth.load(std::memory_order_relaxed)});
+    }
+    // The owner may have lapped us meanwhile, and may be halfway through
+    // the slot after the last one it published.
+    const uint64_t after = head.load(std::memory_order_acquire);
+    const uint64_t oldestSafe = after + 1 > cap ? after + 1 - cap : 0;
+    const uint64_t oldestRead =
+        std::max(from, before > cap ? before - cap : 0);
+    if (oldestSafe > oldestRead) {
+      const size_t lost = (size_t)std::min<uint64_t>(oldestSafe - oldestRead,
+                                                     out.size() - first);
+      out.erase(out.begin() + first, out.begin() + first + lost);
+    }
+    return std::max(from, before);
+  }
+};
+
+struct History {
+  std::vector<double> frames; // ring of per-frame totals, ms
+  size_t next = 0;
+  double current = 0.0;       // accumulating for the frame being folded
+  double last = 0.0;
+  bool touched = false;
+};
+
+std::mutex registryLock;
+std::vector<std::unique_ptr<ThreadBuffer>> buffers; // never shrinks
+
+// Main thread only.
+std::unordered_map<std::string_view, History> histories;
+std::vector<std::string> markerOrder;
+std::vector<Sample> scratch;
+
+thread_local ThreadBuffer *threadBuffer = nullptr;
+thread_local uint32_t threadDepth = 0;
+
+ThreadBuffer &LocalBuffer() {
+  if (!threadBuffer) {
+    auto buffer = std::make_unique<ThreadBuffer>();
+    std::lock_guard<std::mutex> guard(registryLock);
+    buffer->tid = (uint32_t)buffers.size();
+    buffer->name = "thread " + std::to_string(buffer->tid);
+    threadBuffer = buffer.get();
+    buffers.push_back(std::move(buffer));
+  }
+  return *threadBuffer;
+}
+
+void WriteJsonString(FILE *out, const char *s) {
+  fputc('"', out);
+  for (; *s; ++s) {
+    if (*s == '"' || *s == '\\')
+      fputc('\\', out);
+    if ((unsigned char)*s >= 0x20)
+      fputc(*s, out);
+  }
+  fputc('"', out);
+}
+
+} // namespace
+
+#if ENGINE_PROFILE
+
+ProfileScope::ProfileScope(const char *name)
+    : name(name), start(SDL_GetTicksNS()), depth(threadDepth++) {}
+
+ProfileScope::~ProfileScope() {
+  --threadDepth;
+  Profiler::Record(name, start, SDL_GetTicksNS(), depth);
+}
+
+#endif
+
+void Profiler::Record(const char *name, uint64_t startNS, uint64_t endNS,
+                      uint32_t depth) {
+  ThreadBuffer &b = LocalBuffer();
+  const uint64_t index = b.head.load(std::memory_order_relaxed);
+  Event &e = b.events[index % cfg::PROFILE_RING_EVENTS];
+  e.name.store(name, std::memory_order_relaxed);
+  e.start.store(startNS, std::memory_order_relaxed);
+  e.end.store(endNS, std::memory_order_relaxed);
+  e.depth.store(depth, std::memory_order_relaxed);
+  b.head.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::SetThreadName(const char *name) {
+  ThreadBuffer &b = LocalBuffer();
+  std::lock_guard<std::mutex> guard(registryLock);
+  b.name = name;
+}
+
+void Profiler::EndFrame() {
+  scratch.clear();
+  {
+    std::lock_guard<std::mutex> guard(registryLock);
+    for (auto &b : buffers)
+      b->aggregated = b->ReadSince(b->aggregated, scratch);
+  }
+
+  for (const Sample &s : scratch) {
+    if (!s.name)
+      continue;
+    auto it = histories.find(s.name);
+    if (it == histories.end()) {
+      markerOrder.emplace_back(s.name);
+      it = histories.emplace(s.name, History{}).first;
+      it->second.frames.reserve(cfg::PROFILE_HISTORY_FRAMES);
+    }
+    it->second.current += (double)(s.end - s.start) / SDL_NS_PER_MS;
+    it->second.touched = true;
+  }
+
+  // Markers that didn't fire this frame record a zero, so averages stay
+  // per frame.
+  for (auto &kv : histories) {
+    History &h = kv.second;
+    const double total = h.touched ? h.current : 0.0;
+    if (h.frames.size() < cfg::PROFILE_HISTORY_FRAMES) {
+      h.frames.push_back(total);
+    } else {
+      h.frames[h.next] = total;
+    }
+    h.next = (h.next + 1) % cfg::PROFILE_HISTORY_FRAMES;
+    h.last = total;
+    h.current = 0.0;
+    h.touched = false;
+  }
+}
+
+ProfileStats Profiler::GetStats(const char *name) {
+  ProfileStats stats;
+  auto it = histories.find(name);
+  if (it == histories.end() || it->second.frames.empty())
+    return stats;
+
+  std::vector<double> sorted = it->second.frames;
+  std::sort(sorted.begin(), sorted.end());
+  double sum = 0.0;
+  for (double v : sorted)
+    sum += v;
+  stats.minMs = sorted.front();
+  stats.avgMs = sum / (double)sorted.size();
+  stats.p99Ms = sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)];
+  stats.lastMs = it->second.last;
+  stats.frames = (uint32_t)sorted.size();
+  return stats;
+}
+
+std::vector<std::string> Profiler::GetMarkers() { return markerOrder; }
+
+bool Profiler::WriteChromeTrace(const char *path) {
+  FILE *out = fopen(path, "w");
+  if (!out) {
+    SDL_Log("Failed to open %s for the trace", path);
+    return false;
+  }
+
+  std::vector<Sample> samples;
+  size_t written = 0;
+  fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", out);
+  std::lock_guard<std::mutex> guard(registryLock);
+  for (auto &b : buffers) {
+    if (written++)
+      fputs(",\n", out);
+    fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,"
+                 "\"args\":{\"name\":",
+            b->tid);
+    WriteJsonString(out, b->name.c_str());
+    fputs("}}", out);
+
+    samples.clear();
+    b->ReadSince(0, samples);
+    for (const Sample &s : samples) {
+      if (!s.name)
+        continue;
+      fputs(",\n{\"name\":", out);
+      WriteJsonString(out, s.name);
+      fprintf(out,
+              ",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,"
+              "\"args\":{\"depth\":%u}}",
+              b->tid, (double)s.start / 1000.0,
+              (double)(s.end - s.start) / 1000.0, s.depth);
+    }
+  }
+  fputs("\n]}\n", out);
+  const bool ok = fclose(out) == 0;
+  if (ok)
+    SDL_Log("Wrote profile trace to %s", path);
+  return ok;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Scoped timing markers. Each thread records into its own ring buffer with
+// no locking; the main thread aggregates per-frame totals in EndFrame and
+// can export the buffers as a Chrome trace (chrome://tracing, Perfetto).
+//
+// Build with ENGINE_PROFILE=0 (CMake option ENGINE_PROFILING=OFF) to
+// compile the markers out; the query API then reports nothing.
+#ifndef ENGINE_PROFILE
+#define ENGINE_PROFILE 1
+#endif
+
+// Min/avg/p99 of a marker's per-frame total over the recent history.
+struct ProfileStats {
+  double minMs = 0.0;
+  double avgMs = 0.0;
+  double p99Ms = 0.0;
+  double lastMs = 0.0;
+  uint32_t frames = 0; // frames in the window
+};
+
+class Profiler {
+public:
+  // Called by ProfileScope; name must outlive the profiler (a literal).
+  static void Record(const char *name, uint64_t startNS, uint64_t endNS,
+                     uint32_t depth);
+  // Label used for the calling thread in exported traces.
+  static void SetThreadName(const char *name);
+
+  // Folds everything recorded since the previous call into the per-marker
+  // history. Call once per frame from the main thread.
+  static void EndFrame();
+
+  static ProfileStats GetStats(const char *name);
+  // Marker names seen so far, in first-seen order.
+  static std::vector<std::string> GetMarkers();
+
+  // Writes whatever is still in the ring buffers as trace_event JSON.
+  static bool WriteChromeTrace(const char *path);
+};
+
+#if ENGINE_PROFILE
+
+class ProfileScope {
+private:
+  const char *name;
+  uint64_t start;
+  uint32_t depth;
+
+public:
+  explicit ProfileScope(const char *name);
+  ~ProfileScope();
+
+  ProfileScope(const ProfileScope &) = delete;
+  ProfileScope &operator=(const ProfileScope &) = delete;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name)                                                    \
+  ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+#define PROFILE_THREAD(name) Profiler::SetThreadName(name)
+
+#else
+
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+
+#endif
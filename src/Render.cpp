@@ -1,4 +1,6 @@
 #include "Render.h"
+#include "Config.h"
+#include "Profiler.h"
 #include <SDL3/SDL.h>
 #include <vec2.h>
 
@@ -6,15 +8,18 @@
 RenderSystem::RenderSystem(SDL_Renderer *renderer)
     : renderer(renderer), currentMode(ScalingMode::CONSTANT_SIZE),
       baseWidth(1920.0f),
-      baseHeight(1080.0f), 
-      screenWidth(baseWidth),
+      baseHeight(1080.0f), interpolationAlpha(1.0f), frameScale({1.0f, 1.0f}),
+      camera(baseWidth, baseHeight), frameView(camera.GetViewBounds()),
+      clipped(false), staticLayers(renderer), screenWidth(baseWidth),
       screenHeight(baseHeight) {}
 
 RenderSystem::RenderSystem(SDL_Renderer *renderer, int width, int height)
     : renderer(renderer), currentMode(ScalingMode::CONSTANT_SIZE),
       baseWidth((float)width),
-      baseHeight((float)height),
-      screenWidth(baseWidth),
+      baseHeight((float)height), interpolationAlpha(1.0f),
+      frameScale({1.0f, 1.0f}), camera(baseWidth, baseHeight),
+      frameView(camera.GetViewBounds()), clipped(false),
+      staticLayers(renderer), screenWidth(baseWidth),
       screenHeight(baseHeight)  {}
 
 void RenderSystem::SetScalingMode(ScalingMode mode) {
@@ -34,6 +39,68 @@ void RenderSystem::ToggleScalingMode() {
                                                     : "Proportional");
 }
 
+void RenderSystem::BeginFrame() {
+  stats = RenderStats{};
+  batch.Clear();
+  if (currentMode == ScalingMode::PROPORTIONAL) {
+    frameScale = {.x = screenWidth / baseWidth, .y = screenHeight / baseHeight};
+  } else {
+    frameScale = {.x = 1.0f, .y = 1.0f};
+  }
+  frameView = camera.GetViewBounds();
+
+  // Only clip when the viewport is a part of the screen (split screen,
+  // minimap), so the default camera draws exactly as before.
+  const SDL_FRect &vp = camera.viewport;
+  clipped = vp.x != 0.0f || vp.y != 0.0f || vp.w != baseWidth ||
+            vp.h != baseHeight;
+  if (clipped) {
+    const SDL_Rect clip = {(int)(vp.x * frameScale.x),
+                           (int)(vp.y * frameScale.y),
+                           (int)(vp.w * frameScale.x),
+                           (int)(vp.h * frameScale.y)};
+    SDL_SetRenderClipRect(renderer, &clip);
+  }
+}
+
+bool RenderSystem::SubmitEntity(const Entity *entity) {
+  if (!entity || !entity->tex.sheet)
+    return false;
+  const vec2 pos = Interpolate(entity->prevPosition, entity->position);
+  if (!InView(pos, entity->dimensions)) {
+    ++stats.culled;
+    return false;
+  }
+  SDL_FRect src;
+  const bool hasSource = entity->GetSourceRect(src);
+  Submit(entity->tex.sheet, hasSource ? &src : nullptr,
+         CalculateRenderRect(pos, entity->dimensions), entity->layer);
+  return true;
+}
+
+SDL_FRect RenderSystem::CullBounds(const Camera &camera) {
+  const SDL_FRect view = camera.GetViewBounds();
+  const float m = cfg::INTERPOLATION_SNAP;
+  return {view.x - m, view.y - m, view.w + 2.0f * m, view.h + 2.0f * m};
+}
+
+bool RenderSystem::InView(vec2 pos, vec2 dims) const {
+  return pos.x <= frameView.x + frameView.w && pos.x + dims.x >= frameView.x &&
+         pos.y <= frameView.y + frameView.h && pos.y + dims.y >= frameView.y;
+}
+
+void RenderSystem::Submit(SDL_Texture *texture, const SDL_FRect *src,
+                          const SDL_FRect &dst, int layer) {
+  batch.Add(texture, src, dst, layer);
+  ++stats.sprites;
+}
+
+void RenderSystem::EndFrame() {
+  stats.drawCalls += batch.Flush(renderer);
+  if (clipped)
+    SDL_SetRenderClipRect(renderer, nullptr);
+}
+
 void RenderSystem::RenderEntity(const Entity *entity) {
   if (!entity)
     return;
@@ -53,6 +120,8 @@ void RenderSystem::RenderEntity(const Entity *entity) {
   }
 
   SDL_RenderTexture(renderer, tex, psrc, &dst);
+  ++stats.drawCalls;
+  ++stats.sprites;
 }
 
 void RenderSystem::RenderEntity(const Entity *entity,
@@ -65,19 +134,29 @@ void RenderSystem::RenderEntity(const Entity *entity,
 
   SDL_FRect dst = CalculateRenderRect(entity);
   SDL_RenderTexture(renderer, tex, sourceRect, &dst);
+  ++stats.drawCalls;
+  ++stats.sprites;
 }
 
 SDL_FRect RenderSystem::CalculateRenderRect(const Entity *entity) {
+  return CalculateRenderRect(
+      Interpolate(entity->prevPosition, entity->position), entity->dimensions);
+}
 
-  vec2 pos = entity->position;
-  vec2 dims = entity->dimensions;
+vec2 RenderSystem::Interpolate(vec2 prev, vec2 current) const {
+  vec2 delta = sub(current, prev);
+  // Respawns and other teleports snap instead of sweeping across the screen.
+  if (dot(delta, delta) > cfg::INTERPOLATION_SNAP * cfg::INTERPOLATION_SNAP)
+    return current;
+  return add(prev, mul(interpolationAlpha, delta));
+}
 
+SDL_FRect RenderSystem::CalculateRenderRect(vec2 pos, vec2 dims) {
+  pos = camera.WorldToViewport(pos);
+  dims = mul(camera.zoom, dims);
   if (currentMode == ScalingMode::PROPORTIONAL) {
-    const float scaleX = screenWidth / baseWidth;
-    const float scaleY = screenHeight / baseHeight;
-    vec2 scale = {.x = scaleX, .y = scaleY};
-    pos = mulv(pos, scale);
-    dims = mulv(dims, scale);
+    pos = mulv(pos, frameScale);
+    dims = mulv(dims, frameScale);
   }
 
   SDL_FRect rect = {.x = pos.x, .y = pos.y, .w = dims.x, .h = dims.y};
@@ -85,13 +164,96 @@ SDL_FRect RenderSystem::CalculateRenderRect(const Entity *entity) {
   return (SDL_FRect)rect;
 }
 
+void RenderSystem::RenderWorld(World &world) {
+  world.Each(COMPONENT_TRANSFORM | COMPONENT_BOUNDS | COMPONENT_SPRITE,
+             COMPONENT_LEGACY, [&](Archetype &arch) {
+               const bool hasFlags = (arch.mask & COMPONENT_FLAGS) != 0;
+               for (size_t i = 0; i < arch.Size(); ++i) {
+                 const Sprite &sprite = arch.sprite[i];
+                 if (!sprite.sheet ||
+                     (hasFlags && !(arch.flags[i] & BODY_VISIBLE)))
+                   continue;
+                 const vec2 pos =
+                     Interpolate(arch.prevPosition[i], arch.position[i]);
+                 if (!InView(pos, arch.size[i])) {
+                   ++stats.culled;
+                   continue;
+                 }
+                 SDL_FRect dst = CalculateRenderRect(pos, arch.size[i]);
+                 Submit(sprite.sheet,
+                        sprite.useSource ? &sprite.source : nullptr, dst,
+                        sprite.layer);
+               }
+             });
+}
+
+void RenderSystem::SubmitList(const RenderList &list) {
+  stats.culled += list.culled;
+  for (const RenderCommand &c : list.commands) {
+    const vec2 pos = Interpolate(c.prevPosition, c.position);
+    if (!InView(pos, c.size)) {
+      ++stats.culled;
+      continue;
+    }
+    Submit(c.texture, c.src.w >= 0.0f ? &c.src : nullptr,
+           CalculateRenderRect(pos, c.size), c.layer);
+  }
+}
+
+void RenderSystem::SubmitStaticLayers(const StaticScene &scene) {
+  stats.staticRedraws += staticLayers.Update(scene);
+  if (!staticLayers.IsUsable()) {
+    for (const StaticSprite &s : staticLayers.GetSprites()) {
+      const vec2 pos = {s.bounds.x, s.bounds.y};
+      const vec2 dims = {s.bounds.w, s.bounds.h};
+      if (!InView(pos, dims)) {
+        ++stats.culled;
+        continue;
+      }
+      Submit(s.texture, s.src.w >= 0.0f ? &s.src : nullptr,
+             CalculateRenderRect(pos, dims), s.layer);
+    }
+    return;
+  }
+  for (const StaticLayerCache::Chunk &chunk : staticLayers.GetChunks()) {
+    const vec2 pos = {chunk.bounds.x, chunk.bounds.y};
+    const vec2 dims = {chunk.bounds.w, chunk.bounds.h};
+    if (!InView(pos, dims))
+      continue;
+    Submit(chunk.target, nullptr, CalculateRenderRect(pos, dims), chunk.layer);
+    ++stats.staticChunks;
+  }
+}
+
+void RenderSystem::SubmitTiles(
+    const std::vector<std::shared_ptr<const TileMesh>> &meshes) {
+  // Camera and scaling are affine, so the transform of the unit box gives
+  // every vertex's.
+  const SDL_FRect unit =
+      CalculateRenderRect({.x = 0.0f, .y = 0.0f}, {.x = 1.0f, .y = 1.0f});
+  const SDL_FPoint scale = {unit.w, unit.h};
+  const SDL_FPoint offset = {unit.x, unit.y};
+  for (const std::shared_ptr<const TileMesh> &mesh : meshes) {
+    if (!InView({.x = mesh->bounds.x, .y = mesh->bounds.y},
+                {.x = mesh->bounds.w, .y = mesh->bounds.h}))
+      continue;
+    for (const TileMesh::Run &run : mesh->runs)
+      batch.AddMesh(run.texture, &mesh->vertices[4 * (size_t)run.first],
+                    run.count, scale, offset, mesh->layer);
+    ++stats.tileChunks;
+  }
+}
+
 void RenderSystem::SetBackgroundColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
   SDL_SetRenderDrawColor(renderer, r, g, b, a);
 }
 
 void RenderSystem::Clear() { SDL_RenderClear(renderer); }
 
-void RenderSystem::Present() { SDL_RenderPresent(renderer); }
+void RenderSystem::Present() {
+  PROFILE_SCOPE("Present");
+  SDL_RenderPresent(renderer);
+}
 
 SDL_Texture *LoadTexture(SDL_Renderer *renderer, const char *path) {
   SDL_Surface *surface = SDL_LoadBMP(path);
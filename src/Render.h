@@ -1,6 +1,15 @@
 #pragma once
+#include "Camera.h"
 #include "Entity.h"
+#include "RenderList.h"
+#include "SpriteBatch.h"
+#include "StaticLayerCache.h"
+#include "Tilemap.h"
+#include "World.h"
 #include <SDL3/SDL.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
 
 
 enum class ScalingMode {
@@ -8,12 +17,32 @@ enum class ScalingMode {
   PROPORTIONAL   // Percentage-based
 };
 
+// Per-frame counters, reset by BeginFrame.
+struct RenderStats {
+  uint32_t drawCalls = 0;
+  uint32_t sprites = 0; // drawn
+  uint32_t culled = 0;  // skipped because they were outside the view
+  uint32_t staticChunks = 0;   // cached static chunks composited
+  uint32_t staticRedraws = 0;  // chunks redrawn because their statics changed
+  uint32_t tileChunks = 0;     // tilemap chunks drawn
+};
+
 class RenderSystem {
 private:
   SDL_Renderer *renderer;
   ScalingMode currentMode;
   
   float baseWidth, baseHeight; // Reference resolution for proportional scaling
+  float interpolationAlpha;    // 0 = previous tick, 1 = current tick
+  vec2 frameScale;             // proportional scale, fixed for the frame
+
+  Camera camera;
+  SDL_FRect frameView;         // camera view bounds, fixed for the frame
+  bool clipped;                // viewport doesn't cover the whole screen
+
+  SpriteBatch batch;
+  RenderStats stats;
+  StaticLayerCache staticLayers;
 
 public:
   float screenWidth, screenHeight;
@@ -26,19 +55,73 @@ public:
   ScalingMode GetScalingMode() const { return currentMode; }
   void ToggleScalingMode();
 
-  // Auto: asks the entity for a source rect (frame) via GetSourceRect(...)
+  // Blend factor between the previous and current simulation tick.
+  void SetInterpolationAlpha(float alpha) { interpolationAlpha = alpha; }
+  float GetInterpolationAlpha() const { return interpolationAlpha; }
+
+  Camera &GetCamera() { return camera; }
+  const Camera &GetCamera() const { return camera; }
+
+  // Batched drawing: BeginFrame resets the counters and fixes the scale and
+  // the view, Submit* queue sprites, EndFrame sorts them by layer and texture
+  // and draws each run with a single SDL_RenderGeometry call.
+  void BeginFrame();
+  // Returns false (and counts it as culled) if the entity is out of view.
+  bool SubmitEntity(const Entity *entity);
+  void Submit(SDL_Texture *texture, const SDL_FRect *src, const SDL_FRect &dst,
+              int layer);
+  void EndFrame();
+  const RenderStats &GetStats() const { return stats; }
+
+  // World-space area whose bodies may be visible this frame. Interpolated
+  // positions lag the current ones by at most cfg::INTERPOLATION_SNAP, so
+  // the camera view is grown by that much; query a spatial index with it.
+  SDL_FRect GetCullBounds() const { return CullBounds(camera); }
+  static SDL_FRect CullBounds(const Camera &camera);
+  // Bodies a spatial query already ruled out.
+  void AddCulled(uint32_t count) { stats.culled += count; }
+
+  // Auto: draws the entity's current frame (tex.source)
   void RenderEntity(const Entity *entity);
 
   // Manual: render with an explicit source rect (or nullptr for full texture)
   void RenderEntity(const Entity *entity, const SDL_FRect *sourceRect);
 
+  // Submits world rows that carry a sprite and are in view. Adopted entities
+  // are skipped; they are submitted like any other Entity.
+  void RenderWorld(World &world);
+
+  // Submits a list recorded by the simulation thread, interpolated by the
+  // current alpha.
+  void SubmitList(const RenderList &list);
+
+  // Updates the cached static layers from scene (redrawing only chunks whose
+  // sprites changed) and submits the chunks in view, one quad each, on the
+  // layer of their sprites. Draws the sprites directly if the renderer has
+  // no render targets.
+  void SubmitStaticLayers(const StaticScene &scene);
+  // Frees the cached layers' targets; before the renderer goes away.
+  void ReleaseStaticLayers() { staticLayers.Release(); }
+
+  // Submits the tilemap chunks in view, each with its prebuilt geometry
+  // (see Tilemap::CollectMeshes).
+  void SubmitTiles(const std::vector<std::shared_ptr<const TileMesh>> &meshes);
+
   void SetBackgroundColor(Uint8 r, Uint8 g, Uint8 b, Uint8 a = 255);
   void Clear();
   void Present();
 
   
-private:
+  // Screen rectangle for an entity (interpolated) or a world-space box,
+  // after the camera and the current scaling mode.
   SDL_FRect CalculateRenderRect(const Entity *entity);
+  SDL_FRect CalculateRenderRect(vec2 pos, vec2 dims);
+
+private:
+  vec2 Interpolate(vec2 prev, vec2 current) const;
+  bool InView(vec2 pos, vec2 dims) const;
 };
 
+// Decodes and uploads synchronously; the caller owns the texture. Prefer
+// ResourceManager, which caches, decodes off-thread and frees textures.
 SDL_Texture *LoadTexture(SDL_Renderer *renderer, const char *path);
@@ -0,0 +1,119 @@
+#include "RenderList.h"
+#include <algorithm>
+
+void RenderList::Clear() {
+  commands.clear();
+  tick = 0;
+  tickTimeNS = 0;
+  hasFocus = false;
+  culled = 0;
+  statics.reset();
+  tiles.clear();
+}
+
+void RenderList::AddEntity(const Entity *entity) {
+  if (!entity || !entity->tex.sheet)
+    return;
+  RenderCommand c;
+  c.texture = entity->tex.sheet;
+  c.src = entity->tex.source;
+  c.prevPosition = entity->prevPosition;
+  c.position = entity->position;
+  c.size = entity->dimensions;
+  c.layer = entity->layer;
+  commands.push_back(c);
+}
+
+void RenderList::AddWorld(World &world, const SDL_FRect &region) {
+  world.Each(COMPONENT_TRANSFORM | COMPONENT_BOUNDS | COMPONENT_SPRITE,
+             COMPONENT_LEGACY, [&](Archetype &arch) {
+               const bool hasFlags = (arch.mask & COMPONENT_FLAGS) != 0;
+               for (size_t i = 0; i < arch.Size(); ++i) {
+                 const Sprite &sprite = arch.sprite[i];
+                 if (!sprite.sheet ||
+                     (hasFlags && !(arch.flags[i] & BODY_VISIBLE)))
+                   continue;
+                 const vec2 p = arch.position[i];
+                 const vec2 s = arch.size[i];
+                 if (p.x > region.x + region.w || p.x + s.x < region.x ||
+                     p.y > region.y + region.h || p.y + s.y < region.y) {
+                   ++culled;
+                   continue;
+                 }
+                 RenderCommand c;
+                 c.texture = sprite.sheet;
+                 c.src = sprite.useSource ? sprite.source
+                                          : SDL_FRect{0.0f, 0.0f, -1.0f, -1.0f};
+                 c.prevPosition = arch.prevPosition[i];
+                 c.position = p;
+                 c.size = s;
+                 c.layer = sprite.layer;
+                 commands.push_back(c);
+               }
+             });
+}
+
+RenderPipeline::RenderPipeline(size_t bufferCount)
+    : buffers(std::max<size_t>(bufferCount, 2)) {}
+
+RenderList &RenderPipeline::BeginWrite() {
+  std::lock_guard<std::mutex> guard(lock);
+  // The reader holds at most one buffer and this side at most one more, so
+  // with two or more there is always a free or an unclaimed one.
+  Buffer *target = nullptr;
+  for (Buffer &b : buffers) {
+    if (b.state == BufferState::FREE) {
+      target = &b;
+      break;
+    }
+    if (b.state == BufferState::READY &&
+        (!target || b.sequence < target->sequence))
+      target = &b;
+  }
+  if (target->state == BufferState::READY)
+    ++dropped;
+  target->state = BufferState::WRITING;
+  return target->list;
+}
+
+void RenderPipeline::Publish(RenderList &list) {
+  std::lock_guard<std::mutex> guard(lock);
+  for (Buffer &b : buffers) {
+    if (&b.list == &list) {
+      b.state = BufferState::READY;
+      b.sequence = ++published;
+      return;
+    }
+  }
+}
+
+const RenderList *RenderPipeline::Acquire() {
+  std::lock_guard<std::mutex> guard(lock);
+  Buffer *newest = nullptr;
+  Buffer *held = nullptr;
+  for (Buffer &b : buffers) {
+    if (b.state == BufferState::READING)
+      held = &b;
+    else if (b.state == BufferState::READY &&
+             (!newest || b.sequence > newest->sequence))
+      newest = &b;
+  }
+  if (!newest)
+    return held ? &held->list : nullptr;
+
+  for (Buffer &b : buffers) {
+    if (b.state == BufferState::READY && &b != newest) {
+      b.state = BufferState::FREE; // superseded before anyone drew it
+      ++dropped;
+    }
+  }
+  if (held)
+    held->state = BufferState::FREE;
+  newest->state = BufferState::READING;
+  return &newest->list;
+}
+
+uint64_t RenderPipeline::GetDropped() {
+  std::lock_guard<std::mutex> guard(lock);
+  return dropped;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "Entity.h"
+#include "StaticLayerCache.h"
+#include "Tilemap.h"
+#include "World.h"
+#include <SDL3/SDL.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// One sprite in world space at the last two ticks. The render thread
+// interpolates it, applies the camera and batches it.
+struct RenderCommand {
+  SDL_Texture *texture;
+  SDL_FRect src; // pixels; w < 0 means the whole texture
+  vec2 prevPosition;
+  vec2 position;
+  vec2 size;
+  int layer;
+};
+
+// Everything presentation needs from one simulation tick, so it can draw
+// while the next tick runs.
+struct RenderList {
+  std::vector<RenderCommand> commands;
+  uint64_t tick = 0;
+  Uint64 tickTimeNS = 0;  // simulated time the tick ends at; alpha counts
+                          // from here
+  bool hasFocus = false;  // camera target, centre at both ticks
+  vec2 prevFocus{};
+  vec2 focus{};
+  uint32_t culled = 0;    // left out by the simulation's view query
+  // Cached statics; shared with the lists before it until they change.
+  std::shared_ptr<const StaticScene> statics;
+  // Tilemap chunks near the view.
+  std::vector<std::shared_ptr<const TileMesh>> tiles;
+
+  void Clear();
+  // Skipped without a texture.
+  void AddEntity(const Entity *entity);
+  // World rows with a sprite inside region; adopted entities are skipped
+  // like in RenderSystem::RenderWorld.
+  void AddWorld(World &world, const SDL_FRect &region);
+};
+
+// Hands render lists from the simulation thread to the render thread.
+// Neither side waits for the other: the writer reuses a free buffer, or
+// overwrites the oldest list nobody has picked up yet, and the reader takes
+// the newest finished list or keeps the one it holds. With two buffers a
+// slow reader sees lists get replaced while it draws the previous one; a
+// third keeps a finished spare so it always has something newer to take.
+class RenderPipeline {
+private:
+  enum class BufferState { FREE, WRITING, READY, READING };
+  struct Buffer {
+    RenderList list;
+    BufferState state = BufferState::FREE;
+    uint64_t sequence = 0; // publish order
+  };
+
+  std::vector<Buffer> buffers;
+  std::mutex lock; // held only to change states
+  uint64_t published = 0;
+  uint64_t dropped = 0; // lists overwritten or skipped before being drawn
+
+public:
+  explicit RenderPipeline(size_t bufferCount);
+
+  // Simulation side: fill the list, then publish it. One list at a time.
+  RenderList &BeginWrite();
+  void Publish(RenderList &list);
+
+  // Render side: the newest published list (releasing the one held), the
+  // held one if nothing newer is ready, or nullptr before the first.
+  const RenderList *Acquire();
+
+  size_t GetBufferCount() const { return buffers.size(); }
+  uint64_t GetDropped();
+};
@@ -0,0 +1,201 @@
+#include "ResourceManager.h"
+#include "Profiler.h"
+#include <utility>
+
+TextureHandle::TextureHandle(ResourceManager *owner, uint32_t slot,
+                             uint32_t generation)
+    : owner(owner), slot(slot), generation(generation) {
+  owner->AddRef(slot, generation);
+}
+
+TextureHandle::TextureHandle(const TextureHandle &other)
+    : owner(other.owner), slot(other.slot), generation(other.generation) {
+  if (owner)
+    owner->AddRef(slot, generation);
+}
+
+TextureHandle::TextureHandle(TextureHandle &&other) noexcept
+    : owner(other.owner), slot(other.slot), generation(other.generation) {
+  other.owner = nullptr;
+}
+
+TextureHandle &TextureHandle::operator=(const TextureHandle &other) {
+  if (this != &other) {
+    TextureHandle copy(other);
+    *this = std::move(copy);
+  }
+  return *this;
+}
+
+TextureHandle &TextureHandle::operator=(TextureHandle &&other) noexcept {
+  if (this != &other) {
+    Reset();
+    owner = other.owner;
+    slot = other.slot;
+    generation = other.generation;
+    other.owner = nullptr;
+  }
+  return *this;
+}
+
+TextureHandle::~TextureHandle() { Reset(); }
+
+SDL_Texture *TextureHandle::Get() const {
+  return owner ? owner->Resolve(slot, generation) : nullptr;
+}
+
+bool TextureHandle::IsPending() const {
+  return owner && owner->IsPending(slot, generation);
+}
+
+void TextureHandle::Reset() {
+  if (owner)
+    owner->Release(slot, generation);
+  owner = nullptr;
+}
+
+ResourceManager::ResourceManager(SDL_Renderer *renderer, JobSystem *jobs)
+    : renderer(renderer), jobs(jobs) {}
+
+ResourceManager::~ResourceManager() { Clear(); }
+
+TextureHandle ResourceManager::Load(const std::string &path) {
+  TextureHandle handle = LoadAsync(path);
+  Finish();
+  return handle;
+}
+
+TextureHandle ResourceManager::LoadAsync(const std::string &path) {
+  auto it = byPath.find(path);
+  if (it != byPath.end())
+    return TextureHandle(this, it->second, slots[it->second].generation);
+
+  uint32_t id;
+  if (!freeSlots.empty()) {
+    id = freeSlots.back();
+    freeSlots.pop_back();
+  } else {
+    id = (uint32_t)slots.size();
+    slots.emplace_back();
+  }
+  Slot &s = slots[id];
+  s.path = path;
+  s.live = true;
+  byPath.emplace(path, id);
+
+  const uint32_t generation = s.generation;
+  if (archive && archive->Find(path)) {
+    s.texture = archive->CreateTexture(renderer, path);
+    return TextureHandle(this, id, generation);
+  }
+
+  s.pending = true;
+  auto decode = [this, id, generation, path] {
+    PROFILE_SCOPE("DecodeBMP");
+    SDL_Surface *surface = SDL_LoadBMP(path.c_str());
+    if (!surface)
+      SDL_Log("Failed to load %s: %s", path.c_str(), SDL_GetError());
+    std::lock_guard<std::mutex> guard(decodedLock);
+    decoded.push_back({id, generation, surface});
+  };
+  if (jobs && jobs->GetWorkerCount() > 0) {
+    jobs->Schedule(decode, &decodes);
+  } else {
+    decode();
+  }
+  return TextureHandle(this, id, generation);
+}
+
+std::vector<TextureHandle>
+ResourceManager::Preload(const std::vector<std::string> &paths) {
+  std::vector<TextureHandle> handles;
+  handles.reserve(paths.size());
+  for (const std::string &path : paths)
+    handles.push_back(LoadAsync(path));
+  Finish();
+  return handles;
+}
+
+void ResourceManager::Update() {
+  PROFILE_SCOPE("UploadTextures");
+  std::vector<Decoded> ready;
+  {
+    std::lock_guard<std::mutex> guard(decodedLock);
+    ready.swap(decoded);
+  }
+  for (const Decoded &d : ready)
+    Upload(d);
+}
+
+void ResourceManager::Finish() {
+  if (jobs)
+    jobs->Wait(decodes);
+  Update();
+}
+
+void ResourceManager::Clear() {
+  Finish();
+  for (uint32_t id = 0; id < slots.size(); ++id) {
+    Slot &s = slots[id];
+    if (s.live)
+      FreeSlot(id);
+  }
+  byPath.clear();
+}
+
+void ResourceManager::AddRef(uint32_t slot, uint32_t generation) {
+  if (slot < slots.size() && slots[slot].generation == generation)
+    ++slots[slot].refs;
+}
+
+void ResourceManager::Release(uint32_t slot, uint32_t generation) {
+  if (slot >= slots.size() || slots[slot].generation != generation)
+    return; // cleared since the handle was made
+  Slot &s = slots[slot];
+  if (--s.refs > 0)
+    return;
+
+  byPath.erase(s.path);
+  FreeSlot(slot);
+}
+
+// Bumping the generation invalidates outstanding handles, and makes Upload
+// drop a decode that was still in flight for this slot.
+void ResourceManager::FreeSlot(uint32_t slot) {
+  Slot &s = slots[slot];
+  if (s.texture)
+    SDL_DestroyTexture(s.texture);
+  const uint32_t next = s.generation + 1;
+  s = Slot();
+  s.generation = next;
+  freeSlots.push_back(slot);
+}
+
+SDL_Texture *ResourceManager::Resolve(uint32_t slot,
+                                      uint32_t generation) const {
+  if (slot >= slots.size() || slots[slot].generation != generation)
+    return nullptr;
+  return slots[slot].texture;
+}
+
+bool ResourceManager::IsPending(uint32_t slot, uint32_t generation) const {
+  return slot < slots.size() && slots[slot].generation == generation &&
+         slots[slot].pending;
+}
+
+void ResourceManager::Upload(const Decoded &d) {
+  if (d.slot >= slots.size() || slots[d.slot].generation != d.generation) {
+    if (d.surface)
+      SDL_DestroySurface(d.surface);
+    return;
+  }
+  Slot &s = slots[d.slot];
+  s.pending = false;
+  if (!d.surface)
+    return;
+  s.texture = SDL_CreateTextureFromSurface(renderer, d.surface);
+  if (!s.texture)
+    SDL_Log("Failed to create texture for %s: %s", s.path.c_str(),
+            SDL_GetError());
+  SDL_DestroySurface(d.surface);
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include "AssetArchive.h"
+#include "JobSystem.h"
+#include <SDL3/SDL.h>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ResourceManager;
+
+// Counted reference to a cached texture. Copies share the texture; it is
+// destroyed when the last handle goes away. Handles must be created, copied
+// and dropped on the main thread and must not outlive their manager.
+class TextureHandle {
+private:
+  friend class ResourceManager;
+  ResourceManager *owner = nullptr;
+  uint32_t slot = 0;
+  uint32_t generation = 0;
+
+  TextureHandle(ResourceManager *owner, uint32_t slot, uint32_t generation);
+
+public:
+  TextureHandle() = default;
+  TextureHandle(const TextureHandle &other);
+  TextureHandle(TextureHandle &&other) noexcept;
+  TextureHandle &operator=(const TextureHandle &other);
+  TextureHandle &operator=(TextureHandle &&other) noexcept;
+  ~TextureHandle();
+
+  // nullptr while the file is still decoding, if it failed to load, or
+  // after the manager was cleared.
+  SDL_Texture *Get() const;
+  bool IsReady() const { return Get() != nullptr; }
+  // True until the decode has been uploaded (or has failed).
+  bool IsPending() const;
+  explicit operator bool() const { return owner != nullptr; }
+  void Reset();
+};
+
+// Texture cache keyed by path. Paths found in the mounted archive are
+// created straight from its mapping. Other files are decoded to surfaces on
+// the job system's workers; surfaces are uploaded to the renderer on the
+// main thread (SDL renderers are single-threaded) by Update or Finish.
+class ResourceManager {
+private:
+  friend class TextureHandle;
+
+  struct Slot {
+    std::string path;
+    SDL_Texture *texture = nullptr;
+    uint32_t refs = 0;
+    uint32_t generation = 0;
+    bool live = false;
+    bool pending = false; // decode not uploaded yet
+  };
+  struct Decoded {
+    uint32_t slot;
+    uint32_t generation;
+    SDL_Surface *surface;
+  };
+
+  SDL_Renderer *renderer;
+  JobSystem *jobs;
+  const AssetArchive *archive = nullptr;
+
+  std::vector<Slot> slots;
+  std::vector<uint32_t> freeSlots;
+  std::unordered_map<std::string, uint32_t> byPath;
+
+  JobCounter decodes;
+  std::mutex decodedLock;
+  std::vector<Decoded> decoded; // filled by workers, drained by Update
+
+public:
+  ResourceManager(SDL_Renderer *renderer, JobSystem *jobs);
+  ~ResourceManager();
+
+  ResourceManager(const ResourceManager &) = delete;
+  ResourceManager &operator=(const ResourceManager &) = delete;
+
+  // Pool used for decoding; nullptr (or a pool without workers) decodes
+  // inline.
+  void SetJobSystem(JobSystem *jobSystem) { jobs = jobSystem; }
+  // Checked before the filesystem; nullptr loads everything from files.
+  void SetArchive(const AssetArchive *assets) { archive = assets; }
+
+  // Returns the cached texture for path, decoding it first if needed. Blocks
+  // until every pending decode has finished and been uploaded.
+  TextureHandle Load(const std::string &path);
+  // Queues the decode and returns at once; the handle becomes ready after a
+  // later Update or Finish.
+  TextureHandle LoadAsync(const std::string &path);
+  // Decodes every path in parallel and uploads them before returning.
+  std::vector<TextureHandle> Preload(const std::vector<std::string> &paths);
+
+  // Uploads whatever finished decoding. Call once per frame.
+  void Update();
+  // Waits for all pending decodes, then uploads them.
+  void Finish();
+
+  // Destroys every texture. Existing handles stay safe to drop but no
+  // longer resolve. Call before the renderer goes away.
+  void Clear();
+
+  size_t Count() const { return byPath.size(); }
+
+private:
+  void AddRef(uint32_t slot, uint32_t generation);
+  void Release(uint32_t slot, uint32_t generation);
+  SDL_Texture *Resolve(uint32_t slot, uint32_t generation) const;
+  bool IsPending(uint32_t slot, uint32_t generation) const;
+  void FreeSlot(uint32_t slot);
+  void Upload(const Decoded &d);
+};
@@ -0,0 +1,101 @@
+#include "Scene.h"
+#include "GameEngine.h"
+#include "MappedFile.h"
+#include "Profiler.h"
+
+bool Scene::Load(GameEngine &engine, const char *path) {
+  PROFILE_SCOPE("Scene::Load");
+  const Uint64 start = SDL_GetTicksNS();
+  MappedFile file;
+  SceneView view;
+  if (!file.Open(path) || !ReadScene(file.Data(), file.Size(), path, view))
+    return false;
+  const bool ok = Create(engine, view, path);
+  loadMs = (double)(SDL_GetTicksNS() - start) / SDL_NS_PER_MS;
+  return ok;
+}
+
+bool Scene::LoadText(GameEngine &engine, const char *path) {
+  PROFILE_SCOPE("Scene::LoadText");
+  const Uint64 start = SDL_GetTicksNS();
+  size_t size = 0;
+  void *text = SDL_LoadFile(path, &size);
+  if (!text) {
+    SDL_Log("Failed to read %s: %s", path, SDL_GetError());
+    return false;
+  }
+  LevelData data;
+  const bool parsed =
+      ParseLevel(std::string((const char *)text, size), path, data);
+  SDL_free(text);
+  std::vector<uint8_t> bytes;
+  SceneView view;
+  if (!parsed || !WriteScene(data, path, bytes) ||
+      !ReadScene(bytes.data(), bytes.size(), path, view))
+    return false;
+  const bool ok = Create(engine, view, path);
+  loadMs = (double)(SDL_GetTicksNS() - start) / SDL_NS_PER_MS;
+  return ok;
+}
+
+bool Scene::Create(GameEngine &engine, const SceneView &view,
+                   const char *source) {
+  typeIds.resize(view.typeCount);
+  for (uint32_t i = 0; i < view.typeCount; ++i) {
+    typeIds[i] = engine.FindEntityType(view.types[i].name);
+    if (typeIds[i] == ENTITY_TYPE_NONE)
+      SDL_Log("%s: unknown entity type %s", source, view.types[i].name);
+  }
+  // Checked before anything is created or loaded.
+  for (uint32_t i = 0; i < view.entityCount; ++i) {
+    const LevelEntity &e = view.entities[i];
+    if (e.type >= view.typeCount ||
+        (e.texture != LEVEL_NO_TEXTURE && e.texture >= view.textureCount)) {
+      SDL_Log("%s: entity %u refers to a missing type or texture", source, i);
+      return false;
+    }
+  }
+
+  // Each texture once, decoded in parallel.
+  paths.clear();
+  for (uint32_t i = 0; i < view.textureCount; ++i)
+    paths.emplace_back(view.textures[i].name);
+  const size_t firstTexture = textures.size();
+  for (TextureHandle &handle : engine.GetResources()->Preload(paths))
+    textures.push_back(std::move(handle));
+  const TextureHandle *table = textures.data() + firstTexture;
+
+  descs.resize(view.entityCount);
+  for (uint32_t i = 0; i < view.entityCount; ++i) {
+    const LevelEntity &e = view.entities[i];
+    descs[i] = {.type = typeIds[e.type],
+                .position = e.position,
+                .dimensions = e.dimensions,
+                .texture = e.texture == LEVEL_NO_TEXTURE
+                               ? nullptr
+                               : table[e.texture].Get(),
+                .param = e.param};
+  }
+  const size_t firstEntity = entities.size();
+  entities.resize(firstEntity + view.entityCount);
+  engine.CreateEntities(descs.data(), descs.size(),
+                        entities.data() + firstEntity);
+  descs.clear();
+
+  if (Tilemap *tiles = engine.GetTilemap()) {
+    for (uint32_t i = 0; i < view.tileCount; ++i) {
+      const LevelTiles &t = view.tiles[i];
+      tiles->Fill(t.x, t.y, t.w, t.h, t.id);
+    }
+  } else if (view.tileCount > 0) {
+    SDL_Log("%s: tiles skipped, there is no tilemap", source);
+  }
+  return true;
+}
+
+void Scene::Unload(GameEngine &engine) {
+  for (EntityHandle handle : entities)
+    engine.Despawn(handle); // stale if it's gone already
+  entities.clear();
+  textures.clear();
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "Entity.h"
+#include "Level.h"
+#include "ResourceManager.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class GameEngine;
+
+// The entities, tiles and textures created from one scene. Keeps the
+// textures loaded while its entities may draw them.
+class Scene {
+private:
+  std::vector<TextureHandle> textures; // by index into the file's table
+  std::vector<EntityHandle> entities;
+  std::vector<EntityDesc> descs;  // Create scratch
+  std::vector<uint32_t> typeIds;  // Create scratch, by file type index
+  std::vector<std::string> paths; // Create scratch
+  double loadMs = 0.0;
+
+  bool Create(GameEngine &engine, const SceneView &view, const char *source);
+
+public:
+  // Maps a scene written by scene_compiler and creates its entities, all
+  // in one CreateEntities call, and its tiles (into the engine's tilemap,
+  // if any). Types are looked up by name (see RegisterEntityType); each
+  // texture is loaded once, through the ResourceManager. Logs and returns
+  // false if the file is missing or malformed; nothing is created then.
+  // Adds to whatever this scene already holds. Not during Step.
+  bool Load(GameEngine &engine, const char *path);
+  // The same from level text (see ParseLevel), converted in memory; for
+  // levels that haven't been compiled.
+  bool LoadText(GameEngine &engine, const char *path);
+  // Despawns its entities (those still alive) and releases its textures.
+  // Tiles stay.
+  void Unload(GameEngine &engine);
+
+  const std::vector<EntityHandle> &GetEntities() const { return entities; }
+  // Time the last load took, from opening the file to the last entity.
+  double GetLoadMs() const { return loadMs; }
+};
@@ -0,0 +1,97 @@
+#include "SpatialGrid.h"
+#include <algorithm>
+#include <cmath>
+
+static int32_t ToCell(float v, float cellSize) {
+  float c = std::floor(v / cellSize);
+  // Keep far-away or degenerate coordinates inside the representable range.
+  c = std::clamp(c, -1073741824.0f, 1073741824.0f);
+  return (int32_t)c;
+}
+
+SpatialGrid::SpatialGrid(float cellSize) : cellSize(cellSize) {}
+
+void SpatialGrid::SetCellSize(float size) {
+  cellSize = size;
+  cells.clear();
+}
+
+void SpatialGrid::CellRange(const SDL_FRect &bounds, int32_t &x0, int32_t &y0,
+                            int32_t &x1, int32_t &y1) const {
+  const float minX = std::min(bounds.x, bounds.x + bounds.w);
+  const float maxX = std::max(bounds.x, bounds.x + bounds.w);
+  const float minY = std::min(bounds.y, bounds.y + bounds.h);
+  const float maxY = std::max(bounds.y, bounds.y + bounds.h);
+  x0 = ToCell(minX, cellSize);
+  y0 = ToCell(minY, cellSize);
+  x1 = ToCell(maxX, cellSize);
+  y1 = ToCell(maxY, cellSize);
+}
+
+void SpatialGrid::Insert(uint32_t item, const SDL_FRect &bounds) {
+  int32_t x0, y0, x1, y1;
+  CellRange(bounds, x0, y0, x1, y1);
+  for (int32_t cy = y0; cy <= y1; ++cy) {
+    for (int32_t cx = x0; cx <= x1; ++cx) {
+      cells[CellKey(cx, cy)].push_back(item);
+    }
+  }
+}
+
+void SpatialGrid::Remove(uint32_t item, const SDL_FRect &bounds) {
+  int32_t x0, y0, x1, y1;
+  CellRange(bounds, x0, y0, x1, y1);
+  for (int32_t cy = y0; cy <= y1; ++cy) {
+    for (int32_t cx = x0; cx <= x1; ++cx) {
+      auto it = cells.find(CellKey(cx, cy));
+      if (it == cells.end())
+        continue;
+      std::vector<uint32_t> &cell = it->second;
+      auto pos = std::find(cell.begin(), cell.end(), item);
+      if (pos != cell.end()) {
+        *pos = cell.back();
+        cell.pop_back();
+      }
+    }
+  }
+}
+
+bool SpatialGrid::SameCells(const SDL_FRect &a, const SDL_FRect &b) const {
+  int32_t ax0, ay0, ax1, ay1, bx0, by0, bx1, by1;
+  CellRange(a, ax0, ay0, ax1, ay1);
+  CellRange(b, bx0, by0, bx1, by1);
+  return ax0 == bx0 && ay0 == by0 && ax1 == bx1 && ay1 == by1;
+}
+
+void SpatialGrid::Query(const SDL_FRect &bounds,
+                        std::vector<uint32_t> &out) const {
+  int32_t x0, y0, x1, y1;
+  CellRange(bounds, x0, y0, x1, y1);
+  for (int32_t cy = y0; cy <= y1; ++cy) {
+    for (int32_t cx = x0; cx <= x1; ++cx) {
+      auto it = cells.find(CellKey(cx, cy));
+      if (it != cells.end())
+        out.insert(out.end(), it->second.begin(), it->second.end());
+    }
+  }
+}
+
+const std::vector<uint32_t> *SpatialGrid::GetCell(uint64_t key) const {
+  auto it = cells.find(key);
+  if (it == cells.end() || it->second.empty())
+    return nullptr;
+  return &it->second;
+}
+
+void SpatialGrid::Clear() {
+  // Cells that stayed empty for a whole frame are dropped so a roaming
+  // population doesn't grow the table forever; the rest keep their storage.
+  for (auto it = cells.begin(); it != cells.end();) {
+    if (it->second.empty()) {
+      it = cells.erase(it);
+    } else {
+      it->second.clear();
+      ++it;
+    }
+  }
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Uniform grid keyed by cell coordinate. Items are plain integer ids; callers
+// map them back to whatever they index (entity slots, proxies, ...).
+class SpatialGrid {
+private:
+  float cellSize;
+  std::unordered_map<uint64_t, std::vector<uint32_t>> cells;
+
+public:
+  explicit SpatialGrid(float cellSize);
+
+  void SetCellSize(float size);
+  float GetCellSize() const { return cellSize; }
+
+  // Inserts the item into every cell the bounds overlap (edges inclusive).
+  void Insert(uint32_t item, const SDL_FRect &bounds);
+  // Bounds must be the ones the item was inserted with.
+  void Remove(uint32_t item, const SDL_FRect &bounds);
+
+  // True if both bounds cover exactly the same cells.
+  bool SameCells(const SDL_FRect &a, const SDL_FRect &b) const;
+
+  // Appends every item sharing a cell with bounds. May contain duplicates.
+  void Query(const SDL_FRect &bounds, std::vector<uint32_t> &out) const;
+
+  // Items stored in a single cell, or nullptr if the cell is empty.
+  const std::vector<uint32_t> *GetCell(uint64_t key) const;
+
+  // Empties all cells but keeps their storage for the next frame.
+  void Clear();
+
+  template <typename Fn> void ForEachCell(Fn &&fn) const {
+    for (const auto &kv : cells)
+      if (!kv.second.empty())
+        fn(kv.first, kv.second);
+  }
+
+  static uint64_t CellKey(int32_t cx, int32_t cy) {
+    return ((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy;
+  }
+
+private:
+  void CellRange(const SDL_FRect &bounds, int32_t &x0, int32_t &y0,
+                 int32_t &x1, int32_t &y1) const;
+};
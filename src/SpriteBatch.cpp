@@ -0,0 +1,118 @@
+#include "SpriteBatch.h"
+#include "Profiler.h"
+#include <algorithm>
+
+uint32_t SpriteBatch::TextureRank(SDL_Texture *texture) {
+  // Runs of the same texture are the common case.
+  if (texture != lastTexture || ranks.empty()) {
+    lastTexture = texture;
+    lastRank = ranks.emplace(texture, (uint32_t)ranks.size()).first->second;
+  }
+  return lastRank;
+}
+
+void SpriteBatch::Add(SDL_Texture *texture, const SDL_FRect *src,
+                      const SDL_FRect &dst, int layer) {
+  Quad q;
+  q.texture = texture;
+  q.src = src ? *src : SDL_FRect{0.0f, 0.0f, -1.0f, -1.0f};
+  q.dst = dst;
+  q.layer = layer;
+  q.rank = TextureRank(texture);
+  q.order = (uint32_t)quads.size();
+  quads.push_back(q);
+}
+
+void SpriteBatch::AddMesh(SDL_Texture *texture, const SDL_Vertex *vertices,
+                          uint32_t quadCount, SDL_FPoint scale,
+                          SDL_FPoint offset, int layer) {
+  if (quadCount == 0)
+    return;
+  meshes.push_back({texture, vertices, quadCount, scale, offset, layer,
+                    TextureRank(texture), (uint32_t)meshes.size()});
+}
+
+uint32_t SpriteBatch::Flush(SDL_Renderer *renderer) {
+  PROFILE_SCOPE("SpriteBatch::Flush");
+  if (quads.empty() && meshes.empty())
+    return 0;
+
+  auto byKey = [](const auto &a, const auto &b) {
+    if (a.layer != b.layer)
+      return a.layer < b.layer;
+    if (a.rank != b.rank)
+      return a.rank < b.rank;
+    return a.order < b.order;
+  };
+  std::sort(quads.begin(), quads.end(), byKey);
+  std::sort(meshes.begin(), meshes.end(), byKey);
+
+  // Walks both sorted lists together, one run per (layer, texture).
+  auto before = [](const auto &a, const auto &b) {
+    return a.layer != b.layer ? a.layer < b.layer : a.rank < b.rank;
+  };
+  const SDL_FColor white = {1.0f, 1.0f, 1.0f, 1.0f};
+  uint32_t drawCalls = 0;
+  size_t q = 0, m = 0;
+  while (q < quads.size() || m < meshes.size()) {
+    int layer;
+    SDL_Texture *texture;
+    if (m == meshes.size() ||
+        (q < quads.size() && before(quads[q], meshes[m]))) {
+      layer = quads[q].layer;
+      texture = quads[q].texture;
+    } else {
+      layer = meshes[m].layer;
+      texture = meshes[m].texture;
+    }
+
+    vertices.clear();
+    for (; m < meshes.size() && meshes[m].layer == layer &&
+           meshes[m].texture == texture;
+         ++m) {
+      const Mesh &mesh = meshes[m];
+      for (uint32_t v = 0; v < mesh.quadCount * 4; ++v) {
+        SDL_Vertex vertex = mesh.vertices[v];
+        vertex.position.x = vertex.position.x * mesh.scale.x + mesh.offset.x;
+        vertex.position.y = vertex.position.y * mesh.scale.y + mesh.offset.y;
+        vertices.push_back(vertex);
+      }
+    }
+
+    float texW = 1.0f, texH = 1.0f;
+    if (q < quads.size() && quads[q].layer == layer &&
+        quads[q].texture == texture)
+      SDL_GetTextureSize(texture, &texW, &texH);
+    for (; q < quads.size() && quads[q].layer == layer &&
+           quads[q].texture == texture;
+         ++q) {
+      const Quad &quad = quads[q];
+      float u0 = 0.0f, v0 = 0.0f, u1 = 1.0f, v1 = 1.0f;
+      if (quad.src.w >= 0.0f) {
+        u0 = quad.src.x / texW;
+        v0 = quad.src.y / texH;
+        u1 = (quad.src.x + quad.src.w) / texW;
+        v1 = (quad.src.y + quad.src.h) / texH;
+      }
+      const float x0 = quad.dst.x, y0 = quad.dst.y;
+      const float x1 = quad.dst.x + quad.dst.w, y1 = quad.dst.y + quad.dst.h;
+      vertices.push_back({{x0, y0}, white, {u0, v0}});
+      vertices.push_back({{x1, y0}, white, {u1, v0}});
+      vertices.push_back({{x1, y1}, white, {u1, v1}});
+      vertices.push_back({{x0, y1}, white, {u0, v1}});
+    }
+
+    const size_t count = vertices.size() / 4;
+    while (indices.size() < count * 6) {
+      const int base = (int)(indices.size() / 6) * 4;
+      indices.insert(indices.end(),
+                     {base, base + 1, base + 2, base, base + 2, base + 3});
+    }
+    SDL_RenderGeometry(renderer, texture, vertices.data(),
+                       (int)vertices.size(), indices.data(), (int)count * 6);
+    ++drawCalls;
+  }
+
+  Clear();
+  return drawCalls;
+}
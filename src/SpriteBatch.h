@@ -0,0 +1,63 @@
+#pragma once
+#include <SDL3/SDL.h>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Collects the frame's textured quads and submits them grouped by layer and
+// texture: one SDL_RenderGeometry call per run of quads sharing both.
+// Within a layer, textures draw in the order they were first added, so the
+// result doesn't depend on where the textures happen to be allocated.
+class SpriteBatch {
+private:
+  struct Quad {
+    SDL_Texture *texture;
+    SDL_FRect src; // pixels; w < 0 means the whole texture
+    SDL_FRect dst;
+    int layer;
+    uint32_t rank;  // the texture's, see TextureRank
+    uint32_t order; // submission order, keeps sorting stable
+  };
+
+  // Quads built elsewhere, in world space; placed on screen at Flush.
+  struct Mesh {
+    SDL_Texture *texture;
+    const SDL_Vertex *vertices; // 4 per quad
+    uint32_t quadCount;
+    SDL_FPoint scale, offset; // screen = world * scale + offset
+    int layer;
+    uint32_t rank;
+    uint32_t order;
+  };
+
+  std::vector<Quad> quads;
+  std::vector<Mesh> meshes;
+  std::vector<SDL_Vertex> vertices;
+  std::vector<int> indices; // shared quad pattern, grown on demand
+  std::unordered_map<SDL_Texture *, uint32_t> ranks; // cleared by Flush
+  SDL_Texture *lastTexture = nullptr;
+  uint32_t lastRank = 0;
+
+  // Textures numbered in the order they were first added since the flush.
+  uint32_t TextureRank(SDL_Texture *texture);
+
+public:
+  void Clear() {
+    quads.clear();
+    meshes.clear();
+    ranks.clear();
+    lastTexture = nullptr;
+  }
+  void Add(SDL_Texture *texture, const SDL_FRect *src, const SDL_FRect &dst,
+           int layer);
+  // Draws quadCount quads from vertices (which must outlive the Flush) with
+  // the quads of the same layer and texture, underneath them.
+  void AddMesh(SDL_Texture *texture, const SDL_Vertex *vertices,
+               uint32_t quadCount, SDL_FPoint scale, SDL_FPoint offset,
+               int layer);
+
+  size_t Size() const { return quads.size(); }
+
+  // Draws everything added since Clear() and returns the draw calls issued.
+  uint32_t Flush(SDL_Renderer *renderer);
+};
@@ -0,0 +1,25 @@
+#include "StateBuffer.h"
+
+static inline uint64_t Mix(uint64_t k) {
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdull;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ull;
+  k ^= k >> 33;
+  return k;
+}
+
+uint64_t HashState(const uint8_t *data, size_t size) {
+  uint64_t h = 0x9e3779b97f4a7c15ull ^ (uint64_t)size;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    memcpy(&word, data + i, 8);
+    h = (h ^ (word * 0x87c37b91114253d5ull)) * 0x4cf5ad432745937full;
+    h = (h << 31) | (h >> 33);
+  }
+  uint64_t tail = 0;
+  memcpy(&tail, data + i, size - i);
+  h ^= tail * 0x87c37b91114253d5ull;
+  return Mix(h);
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// Byte buffers for simulation snapshots (GameEngine::SaveState). Only plain
+// values go in, never pointers, so a snapshot can be restored into objects
+// at different addresses. Values are copied with their in-memory layout, so
+// a snapshot is only meant for the build that wrote it.
+class StateWriter {
+private:
+  std::vector<uint8_t> &out;
+
+public:
+  explicit StateWriter(std::vector<uint8_t> &target) : out(target) {}
+
+  template <typename T> void Write(const T &value) {
+    static_assert(std::is_trivially_copyable_v<T> && !std::is_pointer_v<T>,
+                  "snapshots hold plain values only");
+    Write(&value, sizeof(T));
+  }
+  void Write(const void *data, size_t size) {
+    if (size == 0)
+      return;
+    const size_t at = out.size();
+    out.resize(at + size);
+    memcpy(out.data() + at, data, size);
+  }
+
+  size_t Size() const { return out.size(); }
+};
+
+// Reading past the end yields zeroes and clears Ok(), so callers check once.
+class StateReader {
+private:
+  const uint8_t *cursor;
+  const uint8_t *end;
+  bool ok = true;
+
+public:
+  StateReader(const uint8_t *data, size_t size)
+      : cursor(data), end(data + size) {}
+
+  template <typename T> void Read(T &value) {
+    static_assert(std::is_trivially_copyable_v<T> && !std::is_pointer_v<T>,
+                  "snapshots hold plain values only");
+    Read(&value, sizeof(T));
+  }
+  template <typename T> T Read() {
+    T value{};
+    Read(value);
+    return value;
+  }
+  void Read(void *data, size_t size) {
+    if (size == 0)
+      return;
+    if ((size_t)(end - cursor) < size) {
+      memset(data, 0, size);
+      cursor = end;
+      ok = false;
+      return;
+    }
+    memcpy(data, cursor, size);
+    cursor += size;
+  }
+  void Skip(size_t size) {
+    if ((size_t)(end - cursor) < size) {
+      cursor = end;
+      ok = false;
+      return;
+    }
+    cursor += size;
+  }
+
+  const uint8_t *Cursor() const { return cursor; }
+  size_t Remaining() const { return (size_t)(end - cursor); }
+  bool Ok() const { return ok; }
+};
+
+// 64-bit hash of a snapshot, for comparing states across peers or runs.
+// Reads 8 bytes per step; not cryptographic.
+uint64_t HashState(const uint8_t *data, size_t size);
@@ -0,0 +1,40 @@
+#include "StateRing.h"
+#include "GameEngine.h"
+#include "StateBuffer.h"
+
+StateRing::StateRing(size_t capacity) : entries(capacity ? capacity : 1) {}
+
+uint64_t StateRing::Save(const GameEngine &engine) {
+  const uint64_t tick = engine.GetTick();
+  Entry &entry = entries[tick % entries.size()];
+  engine.SaveState(entry.bytes);
+  entry.tick = tick;
+  entry.hash = HashState(entry.bytes.data(), entry.bytes.size());
+  entry.valid = true;
+  return entry.hash;
+}
+
+bool StateRing::Has(uint64_t tick) const {
+  const Entry &entry = entries[tick % entries.size()];
+  return entry.valid && entry.tick == tick;
+}
+
+bool StateRing::Restore(GameEngine &engine, uint64_t tick) const {
+  if (!Has(tick))
+    return false;
+  const Entry &entry = entries[tick % entries.size()];
+  return engine.LoadState(entry.bytes.data(), entry.bytes.size());
+}
+
+uint64_t StateRing::GetHash(uint64_t tick) const {
+  return Has(tick) ? entries[tick % entries.size()].hash : 0;
+}
+
+size_t StateRing::GetSize(uint64_t tick) const {
+  return Has(tick) ? entries[tick % entries.size()].bytes.size() : 0;
+}
+
+void StateRing::Clear() {
+  for (Entry &entry : entries)
+    entry.valid = false;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "Config.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class GameEngine;
+
+// The last few ticks' snapshots, for rolling back when a late input
+// arrives. Entry buffers are reused, so once they've grown to the
+// snapshot size saving doesn't allocate.
+class StateRing {
+private:
+  struct Entry {
+    uint64_t tick = 0;
+    uint64_t hash = 0;
+    bool valid = false;
+    std::vector<uint8_t> bytes;
+  };
+  std::vector<Entry> entries; // by tick % size
+
+public:
+  explicit StateRing(size_t capacity = cfg::STATE_RING_TICKS);
+
+  // Snapshots the engine under its current tick, replacing whatever held
+  // that slot, and returns the state hash.
+  uint64_t Save(const GameEngine &engine);
+  bool Has(uint64_t tick) const;
+  // Returns the engine to `tick`; false if it isn't held or didn't load.
+  bool Restore(GameEngine &engine, uint64_t tick) const;
+  // Hash of the state at `tick`, or 0 if it isn't held.
+  uint64_t GetHash(uint64_t tick) const;
+  // Bytes of the snapshot at `tick`, or 0 if it isn't held.
+  size_t GetSize(uint64_t tick) const;
+  void Clear();
+
+  size_t Capacity() const { return entries.size(); }
+};
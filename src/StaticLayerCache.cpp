@@ -0,0 +1,189 @@
+#include "StaticLayerCache.h"
+#include "Config.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+void StaticScene::Add(const Entity *entity) {
+  StaticSprite s;
+  s.texture = entity->tex.sheet;
+  s.src = entity->tex.source;
+  s.bounds = entity->GetBounds();
+  s.layer = entity->layer;
+  sprites.push_back(s);
+}
+
+StaticLayerCache::StaticLayerCache(SDL_Renderer *renderer)
+    : renderer(renderer), chunkSize(cfg::STATIC_CHUNK_SIZE) {}
+
+StaticLayerCache::~StaticLayerCache() { Release(); }
+
+void StaticLayerCache::Release() {
+  for (Chunk &chunk : chunks) {
+    if (chunk.target)
+      SDL_DestroyTexture(chunk.target);
+    chunk.target = nullptr;
+  }
+  chunks.clear();
+  sprites.clear();
+  order.clear();
+  built = false;
+}
+
+SDL_Texture *StaticLayerCache::CreateTarget() {
+  const int size = (int)chunkSize;
+  SDL_Texture *target =
+      SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                        SDL_TEXTUREACCESS_TARGET, size, size);
+  if (!target) {
+    SDL_Log("Static layer cache disabled, can't create a render target: %s",
+            SDL_GetError());
+    return nullptr;
+  }
+  // Sprites blended onto transparent black leave premultiplied colour.
+  SDL_SetTextureBlendMode(target, SDL_BLENDMODE_BLEND_PREMULTIPLIED);
+  // Neighbouring chunks meet without filtered seams.
+  SDL_SetTextureScaleMode(target, SDL_SCALEMODE_NEAREST);
+  return target;
+}
+
+void StaticLayerCache::Redraw(const Chunk &chunk) {
+  SDL_Texture *previous = SDL_GetRenderTarget(renderer);
+  Uint8 r, g, b, a;
+  SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+
+  SDL_SetRenderTarget(renderer, chunk.target);
+  SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+  SDL_RenderClear(renderer);
+  batch.Clear();
+  for (size_t k = chunk.first; k < chunk.last; ++k) {
+    const StaticSprite &s = sprites[order[k]];
+    const SDL_FRect dst = {s.bounds.x - chunk.bounds.x,
+                           s.bounds.y - chunk.bounds.y, s.bounds.w,
+                           s.bounds.h};
+    batch.Add(s.texture, s.src.w >= 0.0f ? &s.src : nullptr, dst, 0);
+  }
+  batch.Flush(renderer);
+
+  SDL_SetRenderTarget(renderer, previous);
+  SDL_SetRenderDrawColor(renderer, r, g, b, a);
+}
+
+uint32_t StaticLayerCache::Update(const StaticScene &scene) {
+  if (built && scene.version == builtVersion)
+    return 0;
+  PROFILE_SCOPE("StaticLayerCache::Update");
+
+  // One entry per chunk a sprite touches, grouped by chunk. Within a chunk
+  // sprites are ordered by content, so a scene that only lists the same
+  // sprites in another order redraws nothing. Texture addresses change from
+  // run to run, so only sprites with identical rectangles fall back to
+  // scene order.
+  nextSprites = scene.sprites;
+  entries.clear();
+  for (uint32_t i = 0; i < (uint32_t)nextSprites.size(); ++i) {
+    const SDL_FRect &b = nextSprites[i].bounds;
+    const int x0 = (int)std::floor(b.x / chunkSize);
+    const int y0 = (int)std::floor(b.y / chunkSize);
+    const int x1 = std::max(x0, (int)std::ceil((b.x + b.w) / chunkSize) - 1);
+    const int y1 = std::max(y0, (int)std::ceil((b.y + b.h) / chunkSize) - 1);
+    for (int y = y0; y <= y1; ++y)
+      for (int x = x0; x <= x1; ++x)
+        entries.push_back({nextSprites[i].layer, y, x, i});
+  }
+  std::sort(entries.begin(), entries.end(),
+            [&](const Entry &l, const Entry &r) {
+              if (l.layer != r.layer || l.y != r.y || l.x != r.x)
+                return std::tie(l.layer, l.y, l.x) <
+                       std::tie(r.layer, r.y, r.x);
+              const StaticSprite &a = nextSprites[l.sprite];
+              const StaticSprite &b = nextSprites[r.sprite];
+              return std::tie(a.bounds.y, a.bounds.x, a.bounds.w, a.bounds.h,
+                              a.src.x, a.src.y, a.src.w, a.src.h, l.sprite) <
+                     std::tie(b.bounds.y, b.bounds.x, b.bounds.w, b.bounds.h,
+                              b.src.x, b.src.y, b.src.w, b.src.h, r.sprite);
+            });
+
+  nextOrder.clear();
+  nextChunks.clear();
+  for (size_t i = 0; i < entries.size();) {
+    const Entry &e = entries[i];
+    Chunk chunk;
+    chunk.layer = e.layer;
+    chunk.x = e.x;
+    chunk.y = e.y;
+    chunk.bounds = {(float)e.x * chunkSize, (float)e.y * chunkSize, chunkSize,
+                    chunkSize};
+    chunk.target = nullptr;
+    chunk.first = nextOrder.size();
+    for (; i < entries.size() && entries[i].layer == e.layer &&
+           entries[i].y == e.y && entries[i].x == e.x;
+         ++i)
+      nextOrder.push_back(entries[i].sprite);
+    chunk.last = nextOrder.size();
+    nextChunks.push_back(chunk);
+  }
+
+  // Both lists are sorted by chunk: keep the targets of chunks that are
+  // still there, release the rest, and mark new or changed ones.
+  auto key = [](const Chunk &c) { return std::tie(c.layer, c.y, c.x); };
+  auto same = [&](const Chunk &was, const Chunk &now) {
+    if (was.last - was.first != now.last - now.first)
+      return false;
+    for (size_t k = 0; k < now.last - now.first; ++k)
+      if (!(sprites[order[was.first + k]] ==
+            nextSprites[nextOrder[now.first + k]]))
+        return false;
+    return true;
+  };
+  dirty.clear();
+  size_t old = 0;
+  for (size_t i = 0; i < nextChunks.size(); ++i) {
+    Chunk &chunk = nextChunks[i];
+    while (old < chunks.size() && key(chunks[old]) < key(chunk)) {
+      if (chunks[old].target)
+        SDL_DestroyTexture(chunks[old].target);
+      ++old;
+    }
+    if (old < chunks.size() && key(chunks[old]) == key(chunk)) {
+      chunk.target = chunks[old].target;
+      if (!chunk.target || !same(chunks[old], chunk))
+        dirty.push_back(i);
+      ++old;
+    } else {
+      dirty.push_back(i);
+    }
+  }
+  for (; old < chunks.size(); ++old)
+    if (chunks[old].target)
+      SDL_DestroyTexture(chunks[old].target);
+
+  sprites.swap(nextSprites);
+  order.swap(nextOrder);
+  chunks.swap(nextChunks);
+  built = true;
+  builtVersion = scene.version;
+  if (!usable)
+    return 0;
+
+  uint32_t redrawn = 0;
+  for (size_t i : dirty) {
+    Chunk &chunk = chunks[i];
+    if (!chunk.target)
+      chunk.target = CreateTarget();
+    if (!chunk.target) {
+      // Without render targets every static sprite is drawn directly.
+      usable = false;
+      for (Chunk &c : chunks) {
+        if (c.target)
+          SDL_DestroyTexture(c.target);
+        c.target = nullptr;
+      }
+      return 0;
+    }
+    Redraw(chunk);
+    ++redrawn;
+  }
+  return redrawn;
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include "Entity.h"
+#include "SpriteBatch.h"
+#include <SDL3/SDL.h>
+#include <cstdint>
+#include <vector>
+
+// A static sprite as the cache draws it: world-space bounds, no
+// interpolation.
+struct StaticSprite {
+  SDL_Texture *texture;
+  SDL_FRect src;    // pixels; w < 0 means the whole texture
+  SDL_FRect bounds; // world space
+  int layer;
+
+  bool operator==(const StaticSprite &o) const {
+    return texture == o.texture && layer == o.layer && src.x == o.src.x &&
+           src.y == o.src.y && src.w == o.src.w && src.h == o.src.h &&
+           bounds.x == o.bounds.x && bounds.y == o.bounds.y &&
+           bounds.w == o.bounds.w && bounds.h == o.bounds.h;
+  }
+};
+
+// Every cached sprite at one point in time. Never changed once shared, so
+// the render thread can draw from one while the simulation builds the next;
+// version changes whenever the sprites do.
+struct StaticScene {
+  std::vector<StaticSprite> sprites;
+  uint64_t version = 0;
+
+  // Static, visible, textured, not animated and not moved this tick.
+  // Statics that move are drawn like any other sprite until they come to
+  // rest again.
+  static bool Caches(const Entity *entity) {
+    return entity->isStatic && entity->isVisible && entity->tex.sheet &&
+           entity->animation.clip == ANIMATION_NONE &&
+           entity->position.x == entity->prevPosition.x &&
+           entity->position.y == entity->prevPosition.y;
+  }
+  // Appends entity as it looks now; check Caches first.
+  void Add(const Entity *entity);
+};
+
+// Draws a StaticScene into offscreen render targets, one per chunk of
+// cfg::STATIC_CHUNK_SIZE world units and draw layer, at one pixel per world
+// unit. A chunk is only redrawn when the sprites touching it change, so a
+// frame composites each visible chunk with a single quad instead of
+// resubmitting every static sprite.
+class StaticLayerCache {
+public:
+  struct Chunk {
+    int layer;
+    int x, y;           // chunk coordinates
+    SDL_FRect bounds;   // world space
+    SDL_Texture *target;
+    size_t first, last; // its sprites: order[first, last)
+  };
+
+private:
+  SDL_Renderer *renderer;
+  float chunkSize;
+  bool usable = true;        // false once a target couldn't be created
+  bool built = false;
+  uint64_t builtVersion = 0;
+
+  std::vector<StaticSprite> sprites; // copy of the built scene
+  std::vector<uint32_t> order;       // sprite per chunk entry, by chunk
+  std::vector<Chunk> chunks;         // sorted by (layer, y, x)
+
+  // Update scratch.
+  struct Entry {
+    int layer, y, x;
+    uint32_t sprite;
+  };
+  std::vector<Entry> entries;
+  std::vector<StaticSprite> nextSprites;
+  std::vector<uint32_t> nextOrder;
+  std::vector<Chunk> nextChunks;
+  std::vector<size_t> dirty;
+  SpriteBatch batch;
+
+  SDL_Texture *CreateTarget();
+  void Redraw(const Chunk &chunk);
+
+public:
+  explicit StaticLayerCache(SDL_Renderer *renderer);
+  ~StaticLayerCache();
+  StaticLayerCache(const StaticLayerCache &) = delete;
+  StaticLayerCache &operator=(const StaticLayerCache &) = delete;
+
+  // Brings the targets up to date with scene: chunks whose sprites differ
+  // from the last build are redrawn, empty ones are released. Returns the
+  // number of chunks redrawn. Call on the renderer's thread, outside a
+  // SpriteBatch frame.
+  uint32_t Update(const StaticScene &scene);
+  // Destroys every target; the next Update rebuilds what it needs.
+  void Release();
+
+  // False if the renderer can't draw into textures; draw the sprites
+  // (GetSprites) directly then.
+  bool IsUsable() const { return usable; }
+  const std::vector<Chunk> &GetChunks() const { return chunks; }
+  const std::vector<StaticSprite> &GetSprites() const { return sprites; }
+};
@@ -0,0 +1,177 @@
+#include "Tilemap.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+
+Tilemap::Tilemap(uint32_t widthTiles, uint32_t heightTiles, float tileSize)
+    : width(widthTiles), height(heightTiles),
+      chunksX((widthTiles + CHUNK - 1) / CHUNK),
+      chunksY((heightTiles + CHUNK - 1) / CHUNK), tileSize(tileSize),
+      types(1), typeUV(1), typeFlags(1, 0), typeRank(1, 0),
+      chunks((size_t)chunksX * chunksY),
+      chunkEdited((size_t)chunksX * chunksY, 0) {}
+
+uint16_t Tilemap::AddTileType(const TileType &type) {
+  if (types.size() > UINT16_MAX)
+    return 0;
+  SDL_FRect uv = {0.0f, 0.0f, 1.0f, 1.0f};
+  float texW = 1.0f, texH = 1.0f;
+  if (type.texture && type.source.w >= 0.0f &&
+      SDL_GetTextureSize(type.texture, &texW, &texH))
+    uv = {type.source.x / texW, type.source.y / texH, type.source.w / texW,
+          type.source.h / texH};
+  // Meshes group tiles by texture in this order, not by address, so they
+  // come out the same every run.
+  uint16_t rank = (uint16_t)types.size();
+  for (uint16_t id = 0; id < (uint16_t)types.size(); ++id)
+    if (types[id].texture == type.texture) {
+      rank = typeRank[id];
+      break;
+    }
+  types.push_back(type);
+  typeRank.push_back(rank);
+  typeUV.push_back(uv);
+  typeFlags.push_back(type.flags);
+  return (uint16_t)(types.size() - 1);
+}
+
+void Tilemap::MarkEdited(uint32_t index) {
+  chunks[index].meshDirty = true;
+  if (!chunkEdited[index]) {
+    chunkEdited[index] = 1;
+    edited.push_back(index);
+  }
+}
+
+void Tilemap::SetTile(uint32_t x, uint32_t y, uint16_t id) {
+  if (x >= width || y >= height || id >= types.size())
+    return;
+  const uint32_t index = (y / CHUNK) * chunksX + x / CHUNK;
+  Chunk &chunk = chunks[index];
+  if (chunk.tiles.empty()) {
+    if (id == 0)
+      return;
+    chunk.tiles.assign((size_t)CHUNK * CHUNK, 0);
+  }
+  uint16_t &tile = chunk.tiles[(y % CHUNK) * CHUNK + x % CHUNK];
+  if (tile == id)
+    return;
+  if (tile == 0)
+    ++chunk.used;
+  else if (id == 0)
+    --chunk.used;
+  tile = id;
+  if (chunk.used == 0)
+    chunk.tiles = {}; // give the memory back
+  MarkEdited(index);
+}
+
+void Tilemap::Fill(uint32_t x, uint32_t y, uint32_t w, uint32_t h,
+                   uint16_t id) {
+  const uint32_t x1 = (uint32_t)std::min<uint64_t>((uint64_t)x + w, width);
+  const uint32_t y1 = (uint32_t)std::min<uint64_t>((uint64_t)y + h, height);
+  for (uint32_t ty = y; ty < y1; ++ty)
+    for (uint32_t tx = x; tx < x1; ++tx)
+      SetTile(tx, ty, id);
+}
+
+void Tilemap::SetLayer(int drawLayer) {
+  if (drawLayer == layer)
+    return;
+  layer = drawLayer;
+  for (Chunk &chunk : chunks)
+    if (chunk.used)
+      chunk.meshDirty = true;
+}
+
+void Tilemap::BuildMesh(uint32_t index) {
+  Chunk &chunk = chunks[index];
+  chunk.meshDirty = false;
+  chunk.mesh.reset();
+  if (!chunk.used)
+    return;
+  PROFILE_SCOPE("Tilemap::BuildMesh");
+
+  const uint32_t cx = index % chunksX, cy = index / chunksX;
+  // Tiles of the chunk grouped by texture, in row order within each.
+  std::vector<uint32_t> drawn;
+  drawn.reserve(chunk.used);
+  for (uint32_t i = 0; i < CHUNK * CHUNK; ++i)
+    if (chunk.tiles[i] && types[chunk.tiles[i]].texture)
+      drawn.push_back(i);
+  if (drawn.empty())
+    return;
+  std::stable_sort(drawn.begin(), drawn.end(), [&](uint32_t a, uint32_t b) {
+    return typeRank[chunk.tiles[a]] < typeRank[chunk.tiles[b]];
+  });
+
+  auto mesh = std::make_shared<TileMesh>();
+  mesh->bounds = {(float)(cx * CHUNK) * tileSize, (float)(cy * CHUNK) * tileSize,
+                  (float)CHUNK * tileSize, (float)CHUNK * tileSize};
+  mesh->layer = layer;
+  mesh->vertices.reserve(drawn.size() * 4);
+  const SDL_FColor white = {1.0f, 1.0f, 1.0f, 1.0f};
+  for (uint32_t k = 0; k < (uint32_t)drawn.size(); ++k) {
+    const uint32_t i = drawn[k];
+    const uint16_t id = chunk.tiles[i];
+    if (mesh->runs.empty() || mesh->runs.back().texture != types[id].texture)
+      mesh->runs.push_back({types[id].texture, k, 0});
+    ++mesh->runs.back().count;
+
+    // Neighbours compute shared edges from the same integers, so they meet
+    // exactly.
+    const float x0 = (float)(cx * CHUNK + i % CHUNK) * tileSize;
+    const float y0 = (float)(cy * CHUNK + i / CHUNK) * tileSize;
+    const float x1 = (float)(cx * CHUNK + i % CHUNK + 1) * tileSize;
+    const float y1 = (float)(cy * CHUNK + i / CHUNK + 1) * tileSize;
+    const SDL_FRect &uv = typeUV[id];
+    mesh->vertices.push_back({{x0, y0}, white, {uv.x, uv.y}});
+    mesh->vertices.push_back({{x1, y0}, white, {uv.x + uv.w, uv.y}});
+    mesh->vertices.push_back({{x1, y1}, white, {uv.x + uv.w, uv.y + uv.h}});
+    mesh->vertices.push_back({{x0, y1}, white, {uv.x, uv.y + uv.h}});
+  }
+  chunk.mesh = std::move(mesh);
+}
+
+void Tilemap::CollectMeshes(const SDL_FRect &region,
+                            std::vector<std::shared_ptr<const TileMesh>> &out) {
+  const float span = (float)CHUNK * tileSize;
+  const float right = region.x + region.w, bottom = region.y + region.h;
+  if (right < 0.0f || bottom < 0.0f || chunks.empty())
+    return;
+  const uint32_t x0 = (uint32_t)std::max(0.0f, std::floor(region.x / span));
+  const uint32_t y0 = (uint32_t)std::max(0.0f, std::floor(region.y / span));
+  const uint32_t x1 = std::min(chunksX - 1, (uint32_t)(right / span));
+  const uint32_t y1 = std::min(chunksY - 1, (uint32_t)(bottom / span));
+  for (uint32_t cy = y0; cy <= y1; ++cy) {
+    for (uint32_t cx = x0; cx <= x1; ++cx) {
+      const uint32_t index = cy * chunksX + cx;
+      if (chunks[index].meshDirty)
+        BuildMesh(index);
+      if (chunks[index].mesh)
+        out.push_back(chunks[index].mesh);
+    }
+  }
+}
+
+void Tilemap::TakeEdits(std::vector<SDL_FRect> &out) {
+  const float span = (float)CHUNK * tileSize;
+  for (uint32_t index : edited) {
+    out.push_back({(float)(index % chunksX) * span,
+                   (float)(index / chunksX) * span, span, span});
+    chunkEdited[index] = 0;
+  }
+  edited.clear();
+}
+
+size_t Tilemap::GetMemoryBytes() const {
+  size_t bytes = chunks.size() * sizeof(Chunk);
+  for (const Chunk &chunk : chunks) {
+    bytes += chunk.tiles.capacity() * sizeof(uint16_t);
+    if (chunk.mesh)
+      bytes += sizeof(TileMesh) +
+               chunk.mesh->vertices.capacity() * sizeof(SDL_Vertex) +
+               chunk.mesh->runs.capacity() * sizeof(TileMesh::Run);
+  }
+  return bytes;
+}
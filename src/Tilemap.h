@@ -0,0 +1,121 @@
+#pragma once
+#include "Config.h"
+#include "Entity.h"
+#include <SDL3/SDL.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+enum TileFlags : uint8_t {
+  TILE_SOLID = 1u << 0,
+  TILE_ONE_WAY = 1u << 1, // only stops bodies coming down onto its top
+};
+
+// What a tile id looks like and how it collides. Id 0 is always empty.
+struct TileType {
+  SDL_Texture *texture = nullptr; // not drawn if null
+  SDL_FRect source{0.0f, 0.0f, -1.0f, -1.0f}; // pixels; w < 0 = whole
+  uint8_t flags = 0;                          // TileFlags
+};
+
+// Prebuilt geometry of one chunk: a quad per drawn tile in world space,
+// grouped into one run per texture. Never changed once shared, so render
+// lists can hold on to it while the simulation edits the map.
+struct TileMesh {
+  struct Run {
+    SDL_Texture *texture;
+    uint32_t first, count; // quads: vertices[4 * first, 4 * (first + count))
+  };
+  std::vector<SDL_Vertex> vertices;
+  std::vector<Run> runs;
+  SDL_FRect bounds; // world space, the whole chunk
+  int layer;
+};
+
+// A grid of tiles covering the world from (0, 0), stored in square chunks
+// of cfg::TILE_CHUNK_TILES tiles. Chunks without a tile take no tile
+// memory. Each chunk's geometry is rebuilt only after it was edited, and
+// only when it is next in view; CollisionSystem stops bodies against solid
+// tiles by looking up the cells they overlap.
+class Tilemap {
+private:
+  struct Chunk {
+    std::vector<uint16_t> tiles; // empty while every tile is 0
+    uint32_t used = 0;           // non-empty tiles
+    bool meshDirty = false;
+    std::shared_ptr<const TileMesh> mesh; // null if nothing to draw
+  };
+
+  uint32_t width, height; // tiles
+  uint32_t chunksX, chunksY;
+  float tileSize;
+  int layer = 0;
+  uint32_t collisionLayer = COLLISION_LAYER_DEFAULT;
+
+  std::vector<TileType> types;
+  std::vector<SDL_FRect> typeUV; // by type, texture coordinates
+  std::vector<uint8_t> typeFlags;
+  std::vector<uint16_t> typeRank; // by type, the first type with its texture
+  std::vector<Chunk> chunks;     // by cy * chunksX + cx
+  std::vector<uint32_t> edited;  // chunks changed since TakeEdits
+  std::vector<uint8_t> chunkEdited;
+
+  static constexpr uint32_t CHUNK = cfg::TILE_CHUNK_TILES;
+
+  void BuildMesh(uint32_t index);
+  void MarkEdited(uint32_t index);
+
+public:
+  Tilemap(uint32_t widthTiles, uint32_t heightTiles, float tileSize);
+
+  // Returns the new type's id, or 0 once all 65535 are taken.
+  uint16_t AddTileType(const TileType &type);
+  const TileType &GetTileType(uint16_t id) const { return types[id]; }
+
+  // Out-of-range coordinates are ignored (Set) or empty (Get).
+  void SetTile(uint32_t x, uint32_t y, uint16_t id);
+  // Sets every tile of the rectangle, clipped to the map.
+  void Fill(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint16_t id);
+  uint16_t GetTile(uint32_t x, uint32_t y) const {
+    if (x >= width || y >= height)
+      return 0;
+    const Chunk &chunk = chunks[(y / CHUNK) * chunksX + x / CHUNK];
+    return chunk.tiles.empty()
+               ? 0
+               : chunk.tiles[(y % CHUNK) * CHUNK + x % CHUNK];
+  }
+  // TileFlags of the tile at (x, y); out of range is empty.
+  uint8_t GetFlags(uint32_t x, uint32_t y) const {
+    return typeFlags[GetTile(x, y)];
+  }
+
+  uint32_t GetWidth() const { return width; }
+  uint32_t GetHeight() const { return height; }
+  float GetTileSize() const { return tileSize; }
+  SDL_FRect GetTileBounds(uint32_t x, uint32_t y) const {
+    return {(float)x * tileSize, (float)y * tileSize, tileSize, tileSize};
+  }
+  SDL_FRect GetBounds() const {
+    return {0.0f, 0.0f, (float)width * tileSize, (float)height * tileSize};
+  }
+
+  // Draw layer of every tile (see Entity::layer).
+  void SetLayer(int drawLayer);
+  int GetLayer() const { return layer; }
+  // Bodies whose collisionMask includes this layer collide with the tiles.
+  void SetCollisionLayer(uint32_t bits) { collisionLayer = bits; }
+  uint32_t GetCollisionLayer() const { return collisionLayer; }
+
+  // Appends the meshes of chunks with something to draw that overlap
+  // region, rebuilding those edited since. Call from the simulation's
+  // thread; the meshes themselves can go anywhere.
+  void CollectMeshes(const SDL_FRect &region,
+                     std::vector<std::shared_ptr<const TileMesh>> &out);
+  // Appends the world bounds of every chunk edited since the last call, and
+  // forgets them; the collision pass wakes sleepers there.
+  void TakeEdits(std::vector<SDL_FRect> &out);
+
+  // Tile storage and geometry currently allocated.
+  size_t GetMemoryBytes() const;
+};
@@ -0,0 +1,224 @@
+#include "World.h"
+#include <algorithm>
+
+static uint8_t FlagsOf(const Entity *entity) {
+  uint8_t flags = 0;
+  if (entity->hasPhysics)
+    flags |= BODY_HAS_PHYSICS;
+  if (entity->isStatic)
+    flags |= BODY_STATIC;
+  if (entity->isVisible)
+    flags |= BODY_VISIBLE;
+  if (entity->sleeping)
+    flags |= BODY_SLEEPING;
+  return flags;
+}
+
+WorldEntity World::Create(uint32_t mask) {
+  uint32_t index;
+  if (!freeSlots.empty()) {
+    index = freeSlots.back();
+    freeSlots.pop_back();
+  } else {
+    index = (uint32_t)slots.size();
+    slots.emplace_back();
+  }
+
+  Slot &slot = slots[index];
+  const WorldEntity id = {.index = index, .generation = slot.generation};
+  slot.archetype = FindOrCreateArchetype(mask);
+  Archetype &arch = *archetypes[slot.archetype];
+  slot.row = (uint32_t)arch.Size();
+  slot.alive = true;
+  PushRow(arch, id);
+  ++liveCount;
+  return id;
+}
+
+void World::Destroy(WorldEntity entity) {
+  if (!IsAlive(entity))
+    return;
+  Slot &slot = slots[entity.index];
+  Archetype &arch = *archetypes[slot.archetype];
+  if (arch.mask & COMPONENT_LEGACY)
+    adopted.erase(arch.legacy[slot.row]);
+  SwapRemove(arch, slot.row);
+
+  slot.alive = false;
+  ++slot.generation; // invalidates outstanding handles
+  freeSlots.push_back(entity.index);
+  --liveCount;
+}
+
+bool World::IsAlive(WorldEntity entity) const {
+  return entity.index < slots.size() && slots[entity.index].alive &&
+         slots[entity.index].generation == entity.generation;
+}
+
+void World::SetComponents(WorldEntity entity, uint32_t mask) {
+  if (!IsAlive(entity))
+    return;
+  Slot &slot = slots[entity.index];
+  if (archetypes[slot.archetype]->mask == mask)
+    return;
+
+  const uint32_t target = FindOrCreateArchetype(mask);
+  Archetype &from = *archetypes[slot.archetype];
+  Archetype &to = *archetypes[target];
+  const size_t newRow = to.Size();
+  PushRow(to, entity);
+  CopyRow(from, slot.row, to, newRow);
+  SwapRemove(from, slot.row);
+
+  slot.archetype = target;
+  slot.row = (uint32_t)newRow;
+}
+
+Archetype *World::Locate(WorldEntity entity, size_t &row) {
+  if (!IsAlive(entity))
+    return nullptr;
+  row = slots[entity.index].row;
+  return archetypes[slots[entity.index].archetype].get();
+}
+
+WorldEntity World::Adopt(Entity *entity) {
+  auto it = adopted.find(entity);
+  if (it != adopted.end())
+    return it->second;
+
+  const WorldEntity id =
+      Create(COMPONENT_TRANSFORM | COMPONENT_MOTION | COMPONENT_BOUNDS |
+             COMPONENT_FLAGS | COMPONENT_LEGACY);
+  size_t row;
+  Archetype *arch = Locate(id, row);
+  arch->legacy[row] = entity;
+  arch->position[row] = entity->position;
+  arch->prevPosition[row] = entity->prevPosition;
+  arch->velocity[row] = entity->velocity;
+  arch->force[row] = entity->force;
+  arch->size[row] = entity->dimensions;
+  arch->flags[row] = FlagsOf(entity);
+  adopted[entity] = id;
+  return id;
+}
+
+void World::Release(const Entity *entity) {
+  auto it = adopted.find(entity);
+  if (it != adopted.end())
+    Destroy(it->second); // also erases the map entry
+}
+
+void World::ReleaseAllAdopted() {
+  while (!adopted.empty())
+    Destroy(adopted.begin()->second);
+}
+
+void World::PullAdopted() {
+  Each(COMPONENT_LEGACY, 0, [](Archetype &arch) {
+    for (size_t i = 0; i < arch.Size(); ++i) {
+      const Entity *e = arch.legacy[i];
+      arch.position[i] = e->position;
+      arch.velocity[i] = e->velocity;
+      arch.force[i] = e->force;
+      arch.size[i] = e->dimensions;
+      arch.flags[i] = FlagsOf(e);
+    }
+  });
+}
+
+void World::PushAdopted() {
+  Each(COMPONENT_LEGACY, 0, [](Archetype &arch) {
+    for (size_t i = 0; i < arch.Size(); ++i) {
+      Entity *e = arch.legacy[i];
+      e->position = arch.position[i];
+      e->velocity = arch.velocity[i];
+    }
+  });
+}
+
+void World::SnapshotPositions() {
+  Each(COMPONENT_TRANSFORM, 0, [](Archetype &arch) {
+    std::copy(arch.position.begin(), arch.position.end(),
+              arch.prevPosition.begin());
+  });
+}
+
+uint32_t World::FindOrCreateArchetype(uint32_t mask) {
+  for (uint32_t i = 0; i < archetypes.size(); ++i)
+    if (archetypes[i]->mask == mask)
+      return i;
+  auto arch = std::make_unique<Archetype>();
+  arch->mask = mask;
+  archetypes.push_back(std::move(arch));
+  return (uint32_t)archetypes.size() - 1;
+}
+
+void World::PushRow(Archetype &arch, WorldEntity id) {
+  const uint32_t m = arch.mask;
+  arch.ids.push_back(id);
+  if (m & COMPONENT_TRANSFORM) {
+    arch.position.push_back({0.0f, 0.0f});
+    arch.prevPosition.push_back({0.0f, 0.0f});
+  }
+  if (m & COMPONENT_MOTION) {
+    arch.velocity.push_back({0.0f, 0.0f});
+    arch.force.push_back({0.0f, 0.0f});
+  }
+  if (m & COMPONENT_BOUNDS)
+    arch.size.push_back({0.0f, 0.0f});
+  if (m & COMPONENT_SPRITE)
+    arch.sprite.push_back({nullptr, {0.0f, 0.0f, 0.0f, 0.0f}, false, 0});
+  if (m & COMPONENT_FLAGS)
+    arch.flags.push_back(BODY_HAS_PHYSICS | BODY_VISIBLE);
+  if (m & COMPONENT_LEGACY)
+    arch.legacy.push_back(nullptr);
+}
+
+void World::CopyRow(const Archetype &from, size_t fromRow, Archetype &to,
+                    size_t toRow) {
+  const uint32_t shared = from.mask & to.mask;
+  if (shared & COMPONENT_TRANSFORM) {
+    to.position[toRow] = from.position[fromRow];
+    to.prevPosition[toRow] = from.prevPosition[fromRow];
+  }
+  if (shared & COMPONENT_MOTION) {
+    to.velocity[toRow] = from.velocity[fromRow];
+    to.force[toRow] = from.force[fromRow];
+  }
+  if (shared & COMPONENT_BOUNDS)
+    to.size[toRow] = from.size[fromRow];
+  if (shared & COMPONENT_SPRITE)
+    to.sprite[toRow] = from.sprite[fromRow];
+  if (shared & COMPONENT_FLAGS)
+    to.flags[toRow] = from.flags[fromRow];
+  if (shared & COMPONENT_LEGACY)
+    to.legacy[toRow] = from.legacy[fromRow];
+}
+
+void World::SwapRemove(Archetype &arch, size_t row) {
+  const size_t last = arch.Size() - 1;
+  if (row != last) {
+    CopyRow(arch, last, arch, row);
+    arch.ids[row] = arch.ids[last];
+    slots[arch.ids[row].index].row = (uint32_t)row;
+  }
+
+  const uint32_t m = arch.mask;
+  arch.ids.pop_back();
+  if (m & COMPONENT_TRANSFORM) {
+    arch.position.pop_back();
+    arch.prevPosition.pop_back();
+  }
+  if (m & COMPONENT_MOTION) {
+    arch.velocity.pop_back();
+    arch.force.pop_back();
+  }
+  if (m & COMPONENT_BOUNDS)
+    arch.size.pop_back();
+  if (m & COMPONENT_SPRITE)
+    arch.sprite.pop_back();
+  if (m & COMPONENT_FLAGS)
+    arch.flags.pop_back();
+  if (m & COMPONENT_LEGACY)
+    arch.legacy.pop_back();
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include "Entity.h"
+#include <SDL3/SDL.h>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vec2.h>
+#include <vector>
+
+// Component bits. An archetype is the set of components its rows carry.
+enum ComponentBits : uint32_t {
+  COMPONENT_TRANSFORM = 1u << 0, // position + previous tick's position
+  COMPONENT_MOTION = 1u << 1,    // velocity + force
+  COMPONENT_BOUNDS = 1u << 2,    // AABB size
+  COMPONENT_SPRITE = 1u << 3,
+  COMPONENT_FLAGS = 1u << 4,
+  COMPONENT_LEGACY = 1u << 5, // row mirrors an adopted Entity
+};
+
+// Mirrors the Entity booleans the systems care about.
+enum BodyFlags : uint8_t {
+  BODY_HAS_PHYSICS = 1u << 0,
+  BODY_STATIC = 1u << 1,
+  BODY_VISIBLE = 1u << 2,
+  BODY_SLEEPING = 1u << 3, // not integrated until woken
+};
+
+typedef struct Sprite {
+  SDL_Texture *sheet;
+  SDL_FRect source;
+  bool useSource; // false draws the whole texture
+  int layer;
+} Sprite;
+
+typedef struct WorldEntity {
+  uint32_t index;
+  uint32_t generation;
+} WorldEntity;
+
+// Rows of one archetype. Every component lives in its own contiguous array
+// so systems walk exactly the data they touch; arrays for components the
+// archetype lacks stay empty.
+struct Archetype {
+  uint32_t mask;
+  std::vector<WorldEntity> ids;
+  std::vector<vec2> position;
+  std::vector<vec2> prevPosition;
+  std::vector<vec2> velocity;
+  std::vector<vec2> force;
+  std::vector<vec2> size;
+  std::vector<Sprite> sprite;
+  std::vector<uint8_t> flags;
+  std::vector<Entity *> legacy;
+
+  size_t Size() const { return ids.size(); }
+};
+
+// Opt-in component store. Plain bodies are created directly in it; existing
+// Entity subclasses are adopted, which keeps their virtual Update and
+// collision callbacks while their physics state is mirrored into the arrays.
+class World {
+private:
+  struct Slot {
+    uint32_t generation = 0;
+    uint32_t archetype = 0;
+    uint32_t row = 0;
+    bool alive = false;
+  };
+
+  std::vector<std::unique_ptr<Archetype>> archetypes;
+  std::vector<Slot> slots;
+  std::vector<uint32_t> freeSlots;
+  std::unordered_map<const Entity *, WorldEntity> adopted;
+  size_t liveCount = 0;
+
+public:
+  World() = default;
+
+  WorldEntity Create(uint32_t mask);
+  void Destroy(WorldEntity entity);
+  bool IsAlive(WorldEntity entity) const;
+
+  // Moves the row to the archetype for the new mask, keeping shared data.
+  void SetComponents(WorldEntity entity, uint32_t mask);
+
+  // Row lookup; returns nullptr for stale handles.
+  Archetype *Locate(WorldEntity entity, size_t &row);
+
+  // Adapter for Entity subclasses such as Player.
+  WorldEntity Adopt(Entity *entity);
+  void Release(const Entity *entity);
+  void ReleaseAllAdopted();
+  // Copies Entity fields into the arrays / integrated results back out.
+  void PullAdopted();
+  void PushAdopted();
+
+  // Records current positions as the previous tick's, for interpolation.
+  void SnapshotPositions();
+
+  size_t Count() const { return liveCount; }
+
+  // Visits every non-empty archetype that has all `required` components and
+  // none of the `excluded` ones.
+  template <typename Fn>
+  void Each(uint32_t required, uint32_t excluded, Fn &&fn) {
+    for (auto &arch : archetypes)
+      if ((arch->mask & required) == required &&
+          (arch->mask & excluded) == 0 && arch->Size() > 0)
+        fn(*arch);
+  }
+
+private:
+  uint32_t FindOrCreateArchetype(uint32_t mask);
+  static void PushRow(Archetype &arch, WorldEntity id);
+  static void CopyRow(const Archetype &from, size_t fromRow, Archetype &to,
+                      size_t toRow);
+  void SwapRemove(Archetype &arch, size_t row);
+};
@@ -0,0 +1,110 @@
+// Packs BMP files into a single .pak (see src/AssetArchive.h) with pixels
+// already converted to the texture format the engine uploads, so startup
+// only maps the file instead of opening and decoding every image.
+//
+//   asset_packer <output.pak> <image.bmp>...
+//
+// Entries are named by the paths given on the command line.
+#include "AssetArchive.h"
+#include <SDL3/SDL.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static constexpr SDL_PixelFormat PACK_FORMAT = SDL_PIXELFORMAT_ARGB8888;
+
+struct Image {
+  PakEntry entry;
+  SDL_Surface *surface;
+};
+
+static uint64_t AlignUp(uint64_t value) {
+  return (value + PAK_ALIGN - 1) / PAK_ALIGN * PAK_ALIGN;
+}
+
+static bool WritePadding(FILE *out, uint64_t from, uint64_t to) {
+  static const char zeros[PAK_ALIGN] = {};
+  return fwrite(zeros, 1, (size_t)(to - from), out) == to - from;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s <output.pak> <image.bmp>...\n", argv[0]);
+    return 1;
+  }
+
+  std::vector<Image> images;
+  uint64_t offset = AlignUp(sizeof(PakHeader) +
+                            sizeof(PakEntry) * (uint64_t)(argc - 2));
+  for (int i = 2; i < argc; ++i) {
+    const char *path = argv[i];
+    if (strlen(path) >= PAK_NAME_LENGTH) {
+      fprintf(stderr, "%s: name longer than %u bytes\n", path,
+              PAK_NAME_LENGTH - 1);
+      return 1;
+    }
+    SDL_Surface *loaded = SDL_LoadBMP(path);
+    if (!loaded) {
+      fprintf(stderr, "%s: %s\n", path, SDL_GetError());
+      return 1;
+    }
+    const bool blend = SDL_ISPIXELFORMAT_ALPHA(loaded->format) ||
+                       SDL_SurfaceHasColorKey(loaded);
+    SDL_Surface *converted = SDL_ConvertSurface(loaded, PACK_FORMAT);
+    SDL_DestroySurface(loaded);
+    if (!converted) {
+      fprintf(stderr, "%s: %s\n", path, SDL_GetError());
+      return 1;
+    }
+
+    Image image{};
+    strcpy(image.entry.name, path);
+    image.entry.format = (uint32_t)PACK_FORMAT;
+    image.entry.flags = blend ? (uint32_t)PAK_BLEND : 0u;
+    image.entry.width = (uint32_t)converted->w;
+    image.entry.height = (uint32_t)converted->h;
+    image.entry.pitch = (uint32_t)converted->pitch;
+    image.entry.offset = offset;
+    image.entry.size = (uint64_t)converted->pitch * (uint64_t)converted->h;
+    image.surface = converted;
+    offset = AlignUp(offset + image.entry.size);
+    images.push_back(image);
+  }
+
+  // Written next to the target and renamed, so an interrupted build never
+  // leaves a half-written archive behind.
+  const std::string output = argv[1];
+  const std::string temp = output + ".tmp";
+  FILE *out = fopen(temp.c_str(), "wb");
+  if (!out) {
+    fprintf(stderr, "%s: cannot open for writing\n", temp.c_str());
+    return 1;
+  }
+
+  bool ok = true;
+  const PakHeader header = {PAK_MAGIC, PAK_VERSION, (uint32_t)images.size(), 0};
+  ok = ok && fwrite(&header, sizeof(header), 1, out) == 1;
+  for (const Image &image : images)
+    ok = ok && fwrite(&image.entry, sizeof(PakEntry), 1, out) == 1;
+  uint64_t written = sizeof(PakHeader) + sizeof(PakEntry) * images.size();
+  for (const Image &image : images) {
+    ok = ok && WritePadding(out, written, image.entry.offset);
+    ok = ok && fwrite(image.surface->pixels, 1, (size_t)image.entry.size,
+                      out) == image.entry.size;
+    written = image.entry.offset + image.entry.size;
+    SDL_DestroySurface(image.surface);
+  }
+  ok = fclose(out) == 0 && ok;
+
+  if (ok)
+    remove(output.c_str()); // rename doesn't replace on Windows
+  if (!ok || rename(temp.c_str(), output.c_str()) != 0) {
+    fprintf(stderr, "%s: write failed\n", output.c_str());
+    remove(temp.c_str());
+    return 1;
+  }
+  printf("Packed %zu images into %s (%llu bytes)\n", images.size(),
+         output.c_str(), (unsigned long long)written);
+  return 0;
+}
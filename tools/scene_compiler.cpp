@@ -0,0 +1,56 @@
+// Compiles level text (see src/Level.h) into a binary scene, so loading
+// maps the file and creates its entities from the packed records instead
+// of parsing every line.
+//
+//   scene_compiler <output.scene> <level.txt>
+#include "Level.h"
+#include <SDL3/SDL.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+int main(int argc, char *argv[]) {
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s <output.scene> <level.txt>\n", argv[0]);
+    return 1;
+  }
+  const char *input = argv[2];
+  size_t size = 0;
+  void *text = SDL_LoadFile(input, &size);
+  if (!text) {
+    fprintf(stderr, "%s: %s\n", input, SDL_GetError());
+    return 1;
+  }
+  // Both log why they failed.
+  LevelData data;
+  const bool parsed =
+      ParseLevel(std::string((const char *)text, size), input, data);
+  SDL_free(text);
+  std::vector<uint8_t> bytes;
+  if (!parsed || !WriteScene(data, input, bytes))
+    return 1;
+
+  // Written next to the target and renamed, so an interrupted build never
+  // leaves a half-written scene behind.
+  const std::string output = argv[1];
+  const std::string temp = output + ".tmp";
+  FILE *out = fopen(temp.c_str(), "wb");
+  if (!out) {
+    fprintf(stderr, "%s: cannot open for writing\n", temp.c_str());
+    return 1;
+  }
+  bool ok = fwrite(bytes.data(), 1, bytes.size(), out) == bytes.size();
+  ok = fclose(out) == 0 && ok;
+
+  if (ok)
+    remove(output.c_str()); // rename doesn't replace on Windows
+  if (!ok || rename(temp.c_str(), output.c_str()) != 0) {
+    fprintf(stderr, "%s: write failed\n", output.c_str());
+    remove(temp.c_str());
+    return 1;
+  }
+  printf("Compiled %zu entities and %zu tile rectangles into %s (%zu bytes)\n",
+         data.entities.size(), data.tiles.size(), output.c_str(),
+         bytes.size());
+  return 0;
+}